@@ -34,6 +34,7 @@ static void machine_user_break(int signo)
     }
 
     machine_interactive = true;
+    machine_instrumented = true;
 }
 
 static void termination_signals_handler(int signo)
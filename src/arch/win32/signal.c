@@ -36,6 +36,7 @@ static BOOL machine_user_break(DWORD fdwCtrlType)
         }
 
         machine_interactive = true;
+        machine_instrumented = true;
 
         return true;
     }
@@ -23,6 +23,7 @@
 #include "cmd.h"
 #include "debug/breakpoint.h"
 #include "debug/debug.h"
+#include "device/cpu/instr_stats.h"
 #include "device/cpu/mips_r4000/cpu.h"
 #include "device/cpu/mips_r4000/debug.h"
 #include "device/cpu/riscv_rv32ima/cpu.h"
@@ -31,6 +32,7 @@
 #include "env.h"
 #include "fault.h"
 #include "main.h"
+#include "profile.h"
 #include "utils.h"
 
 static cmd_t *system_cmds;
@@ -321,9 +323,115 @@ static bool system_stat(token_t *parm, void *data)
 {
     ASSERT(parm != NULL);
     dbg_print_devices_stat(DEVICE_FILTER_ALL);
+
+    if (instr_stats_enabled) {
+        instr_stats_print();
+    }
+
     return true;
 }
 
+/** Istat command implementation
+ *
+ * Report the instruction statistics.
+ *
+ */
+static bool system_istat(token_t *parm, void *data)
+{
+    ASSERT(parm != NULL);
+
+    if (parm_type(parm) == tt_end) {
+        instr_stats_print();
+        return true;
+    }
+
+    const char *op = parm_str_next(&parm);
+
+    if (strcmp(op, "print") == 0) {
+        instr_stats_print();
+        return true;
+    }
+
+    if ((strcmp(op, "csv") == 0) || (strcmp(op, "json") == 0)) {
+        bool json = (strcmp(op, "json") == 0);
+
+        if (parm_type(parm) == tt_str) {
+            return instr_stats_write(parm_str(parm), json);
+        }
+
+        if (parm_type(parm) != tt_end) {
+            error("File name expected");
+            return false;
+        }
+
+        return instr_stats_write(NULL, json);
+    }
+
+    if (strcmp(op, "reset") == 0) {
+        instr_stats_reset();
+        return true;
+    }
+
+    error("Unknown operation (supported operations: print, csv, json, reset)");
+    return false;
+}
+
+/** Profile command implementation
+ *
+ * Report the sampled profile.
+ *
+ */
+static bool system_profile(token_t *parm, void *data)
+{
+    ASSERT(parm != NULL);
+
+    const char *op = parm_str_next(&parm);
+
+    if (strcmp(op, "flat") == 0) {
+        unsigned int count = PROFILE_DEFAULT_FLAT_COUNT;
+
+        if (parm_type(parm) == tt_uint) {
+            count = parm_uint(parm);
+        } else if (parm_type(parm) != tt_end) {
+            error("Number of functions expected");
+            return false;
+        }
+
+        profile_print_flat(count);
+        return true;
+    }
+
+    if (strcmp(op, "folded") == 0) {
+        if (parm_type(parm) == tt_str) {
+            return profile_write_folded(parm_str(parm));
+        }
+
+        if (parm_type(parm) != tt_end) {
+            error("File name expected");
+            return false;
+        }
+
+        return profile_write_folded(NULL);
+    }
+
+    if (strcmp(op, "symbols") == 0) {
+        if (parm_type(parm) != tt_str) {
+            error("File name expected");
+            return false;
+        }
+
+        return profile_load_symbols(parm_str(parm));
+    }
+
+    if (strcmp(op, "reset") == 0) {
+        profile_reset();
+        return true;
+    }
+
+    error("Unknown operation (supported operations: flat, folded, symbols, reset)");
+    return false;
+}
+
 /** Dump memory command implementation
  *
  * Dump physical memory.
@@ -913,6 +1021,24 @@ static cmd_t system_cmds_array[] = {
             "Print system statistics",
             "Print system statistics",
             NOCMD },
+    { "profile",
+            system_profile,
+            DEFAULT,
+            DEFAULT,
+            "Report the sampled profile",
+            "Print the flat profile, write the folded stacks, "
+            "load the symbols from an ELF file or discard the samples",
+            REQ STR "op/flat, folded, symbols or reset" NEXT
+                    OPT VAR "arg/function count or file name" END },
+    { "istat",
+            system_istat,
+            DEFAULT,
+            DEFAULT,
+            "Report the instruction statistics",
+            "Print the instruction statistics, write them "
+            "as CSV or JSON or zero the counters",
+            OPT STR "op/print, csv, json or reset" NEXT
+                    OPT STR "file/output file" END },
     { "echo",
             system_echo,
             DEFAULT,
@@ -41,12 +41,27 @@
 #include "../device/drvcpu.h"
 #include "../fault.h"
 #include "../main.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "breakpoint.h"
 #include "gdb.h"
 
+/** Size of the hash table of the code breakpoint addresses (power of two) */
+#define CODE_BREAKPOINT_HASH_SIZE 256
+
 list_t physmem_breakpoints = LIST_INITIALIZER;
 
+/** Number of the code breakpoints of all the processors */
+static size_t code_breakpoint_count = 0;
+
+/** Numbers of the code breakpoints by the hash of their address
+ *
+ * The processors which are not going to execute an instruction
+ * with a hashed address do not search their breakpoints.
+ *
+ */
+static unsigned int code_breakpoint_hash[CODE_BREAKPOINT_HASH_SIZE];
+
 /************************************************************************/
 /* Memory breakpoints                                                   */
 /************************************************************************/
@@ -71,7 +86,7 @@ static physmem_breakpoint_t *physmem_breakpoint_init(ptr36_t address,
     item_init(&breakpoint->item);
     breakpoint->kind = kind;
     breakpoint->addr = address;
-    breakpoint->size = size;
+    breakpoint->size = MAX(size, 1);
     breakpoint->hits = 0;
     breakpoint->access_flags = access_flags;
 
@@ -94,6 +109,7 @@ void physmem_breakpoint_add(ptr36_t address, len36_t length,
     physmem_breakpoint_t *breakpoint = physmem_breakpoint_init(address, length, kind, access_flags);
 
     list_append(&physmem_breakpoints, &breakpoint->item);
+    physmem_mark_breakpoint(breakpoint->addr, breakpoint->size, true);
 }
 
 /** Deactivate memory breakpoint with specified address
@@ -109,6 +125,7 @@ bool physmem_breakpoint_remove(ptr36_t address)
 
     while (breakpoint != NULL) {
         if (breakpoint->addr == address) {
+            physmem_mark_breakpoint(breakpoint->addr, breakpoint->size, false);
             list_remove(&physmem_breakpoints, &breakpoint->item);
             safe_free(breakpoint);
 
@@ -139,6 +156,7 @@ void physmem_breakpoint_remove_filtered(breakpoint_filter_t filter)
             continue;
         }
 
+        physmem_mark_breakpoint(removed->addr, removed->size, false);
         list_remove(&physmem_breakpoints, &removed->item);
         safe_free(removed);
     }
@@ -221,6 +239,50 @@ breakpoint_t *breakpoint_init(ptr64_t address, breakpoint_kind_t kind)
     return breakpoint;
 }
 
+/** Index of a code breakpoint address in the hash table
+ *
+ */
+static size_t breakpoint_hash_index(ptr64_t address)
+{
+    return ((address.ptr >> 2) ^ (address.ptr >> 12)) & (CODE_BREAKPOINT_HASH_SIZE - 1);
+}
+
+/** Activate a code breakpoint
+ *
+ * @param breakpoints List of code breakpoints of some processor.
+ * @param breakpoint  Initialized code breakpoint.
+ *
+ */
+void breakpoint_add(list_t *breakpoints, breakpoint_t *breakpoint)
+{
+    ASSERT(breakpoints != NULL);
+    ASSERT(breakpoint != NULL);
+
+    list_append(breakpoints, &breakpoint->item);
+
+    code_breakpoint_hash[breakpoint_hash_index(breakpoint->pc)]++;
+    code_breakpoint_count++;
+}
+
+/** Deactivate and deallocate a code breakpoint
+ *
+ * @param breakpoints List of code breakpoints of some processor.
+ * @param breakpoint  Code breakpoint from the list.
+ *
+ */
+void breakpoint_remove(list_t *breakpoints, breakpoint_t *breakpoint)
+{
+    ASSERT(breakpoints != NULL);
+    ASSERT(breakpoint != NULL);
+    ASSERT(code_breakpoint_count > 0);
+
+    code_breakpoint_hash[breakpoint_hash_index(breakpoint->pc)]--;
+    code_breakpoint_count--;
+
+    list_remove(breakpoints, &breakpoint->item);
+    safe_free(breakpoint);
+}
+
 /** Fires given breakpoint
  *
  * @param breakpoint Breakpoint structure to be fired
@@ -310,10 +372,18 @@ breakpoint_t *breakpoint_find_by_address(list_t breakpoints,
 bool breakpoint_check_for_code_breakpoints(void)
 {
     bool hit = false;
-    device_t *dev = NULL;
 
-    while (dev_next(&dev, DEVICE_FILTER_R4K_PROCESSOR)) {
-        r4k_cpu_t *cpu = get_r4k(dev);
+    if (code_breakpoint_count == 0) {
+        return hit;
+    }
+
+    const device_array_t *r4k_devices = dev_array(DEVICE_FILTER_R4K_PROCESSOR);
+    for (size_t i = 0; i < r4k_devices->count; i++) {
+        r4k_cpu_t *cpu = get_r4k(r4k_devices->devices[i]);
+
+        if (code_breakpoint_hash[breakpoint_hash_index(cpu->pc)] == 0) {
+            continue;
+        }
 
         if (breakpoint_hit_by_address(cpu->bps, cpu->pc)) {
             hit = true;
@@ -324,11 +394,17 @@ bool breakpoint_check_for_code_breakpoints(void)
         return hit;
     }
 
-    while (dev_next(&dev, DEVICE_FILTER_RV_PROCESSOR)) {
-        const rv_cpu_t *cpu = get_rv(dev);
+    const device_array_t *rv_devices = dev_array(DEVICE_FILTER_RV_PROCESSOR);
+    for (size_t i = 0; i < rv_devices->count; i++) {
+        const rv_cpu_t *cpu = get_rv(rv_devices->devices[i]);
 
         ptr64_t addr = { 0 };
         addr.lo = cpu->pc;
+
+        if (code_breakpoint_hash[breakpoint_hash_index(addr)] == 0) {
+            continue;
+        }
+
         if (breakpoint_hit_by_address(cpu->bps, addr)) {
             hit = true;
         }
@@ -336,3 +412,11 @@ bool breakpoint_check_for_code_breakpoints(void)
 
     return hit;
 }
+
+/** Check whether any processor has a code breakpoint
+ *
+ */
+bool breakpoint_any_code_breakpoint(void)
+{
+    return code_breakpoint_count > 0;
+}
@@ -77,8 +77,11 @@ extern void physmem_breakpoint_print_list(void);
 /* Code breakpoints interface */
 
 extern breakpoint_t *breakpoint_init(ptr64_t address, breakpoint_kind_t kind);
+extern void breakpoint_add(list_t *breakpoints, breakpoint_t *breakpoint);
+extern void breakpoint_remove(list_t *breakpoints, breakpoint_t *breakpoint);
 extern breakpoint_t *breakpoint_find_by_address(list_t breakpoints,
         ptr64_t address, breakpoint_filter_t filter);
 extern bool breakpoint_check_for_code_breakpoints(void);
+extern bool breakpoint_any_code_breakpoint(void);
 
 #endif
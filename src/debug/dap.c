@@ -189,7 +189,7 @@ static void dap_breakpoint_add(const uint32_t addr)
     }
 
     breakpoint_t *inserted_breakpoint = breakpoint_init(virt_address, BREAKPOINT_KIND_SIMULATOR);
-    list_append(&cpu->bps, &inserted_breakpoint->item);
+    breakpoint_add(&cpu->bps, inserted_breakpoint);
     alert("Added DAP breakpoint at address 0x%x.", addr);
 }
 
@@ -203,12 +203,11 @@ static void dap_breakpoint_remove(const uint32_t addr)
     r4k_cpu_t *cpu = get_cpu(cpuno_global)->data;
 
     breakpoint_t *breakpoint = breakpoint_find_by_address(cpu->bps, virt_address, BREAKPOINT_FILTER_SIMULATOR);
-    if (breakpoint != NULL) {
+    if (breakpoint == NULL) {
         return;
     }
 
-    list_remove(&cpu->bps, &breakpoint->item);
-    safe_free(breakpoint)
+    breakpoint_remove(&cpu->bps, breakpoint);
 }
 
 void dap_process(void)
@@ -733,7 +733,7 @@ static void gdb_insert_code_breakpoint(r4k_cpu_t *cpu, ptr64_t addr)
     /* Breakpoint not found, thus insert it now. */
     breakpoint_t *inserted_breakpoint = breakpoint_init(addr, BREAKPOINT_KIND_DEBUGGER);
 
-    list_append(&cpu->bps, &inserted_breakpoint->item);
+    breakpoint_add(&cpu->bps, inserted_breakpoint);
 }
 
 /** Deactivate code breakpoint
@@ -749,8 +749,7 @@ static void gdb_remove_code_breakpoint(r4k_cpu_t *cpu, ptr64_t addr)
         return;
     }
 
-    list_remove(&cpu->bps, &breakpoint->item);
-    safe_free(breakpoint);
+    breakpoint_remove(&cpu->bps, breakpoint);
 }
 
 /** Handle code or memory breakpoint commands from the debugger
@@ -868,8 +867,7 @@ static void gdb_remote_done(bool fail, bool remote_request)
         breakpoint_t *removed = breakpoint;
         breakpoint = (breakpoint_t *) breakpoint->item.next;
 
-        list_remove(&cpu->bps, &removed->item);
-        safe_free(removed);
+        breakpoint_remove(&cpu->bps, removed);
     }
 
     physmem_breakpoint_remove_filtered(BREAKPOINT_FILTER_DEBUGGER);
@@ -0,0 +1,282 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Cache of decoded instruction pages
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "../../assert.h"
+#include "../../fault.h"
+#include "../../physmem.h"
+#include "../../utils.h"
+#include "instr_cache.h"
+
+/** Minimal number of hash buckets */
+#define MIN_BUCKET_COUNT 64
+
+unsigned int instr_cache_capacity = DEFAULT_INSTR_CACHE_CAPACITY;
+_Thread_local unsigned int instr_cache_generation = 0;
+
+/** Last generation assigned to any thread */
+static unsigned int last_generation = 0;
+
+/** Number of the calls of instr_cache_invalidate() */
+static unsigned int invalidations = 0;
+
+/** Invalidations already noticed by the current thread */
+static _Thread_local unsigned int thread_invalidations = 0;
+
+/** Start a new generation of the cache of the current thread
+ *
+ */
+static void next_generation(void)
+{
+    instr_cache_generation = __atomic_add_fetch(&last_generation, 1, __ATOMIC_RELAXED);
+}
+
+/** Change the maximal number of cached pages
+ *
+ * Caches holding more pages shrink lazily on the next insertion.
+ *
+ * @return true if successful
+ *
+ */
+bool instr_cache_set_capacity(unsigned int capacity)
+{
+    if (capacity == 0) {
+        error("Cache capacity has to be at least one page");
+        return false;
+    }
+
+    instr_cache_capacity = capacity;
+    return true;
+}
+
+static size_t bucket_index(instr_cache_t *cache, ptr36_t addr)
+{
+    ASSERT(IS_POWER_OF_2(cache->bucket_count));
+    return (size_t) ADDR2FRAME(addr) & (cache->bucket_count - 1);
+}
+
+/** Resize the hash table so that it has at least as many buckets as items
+ *
+ */
+static void rehash(instr_cache_t *cache, size_t bucket_count)
+{
+    safe_free(cache->buckets);
+
+    cache->bucket_count = bucket_count;
+    cache->buckets = safe_malloc(bucket_count * sizeof(instr_cache_item_t *));
+    for (size_t i = 0; i < bucket_count; i++) {
+        cache->buckets[i] = NULL;
+    }
+
+    instr_cache_item_t *it;
+    for_each(cache->items, it, instr_cache_item_t)
+    {
+        size_t index = bucket_index(cache, it->addr);
+        it->hash_next = cache->buckets[index];
+        cache->buckets[index] = it;
+    }
+}
+
+static void unhash(instr_cache_t *cache, instr_cache_item_t *cache_item)
+{
+    instr_cache_item_t **link = &cache->buckets[bucket_index(cache, cache_item->addr)];
+    while (*link != cache_item) {
+        ASSERT(*link != NULL);
+        link = &(*link)->hash_next;
+    }
+
+    *link = cache_item->hash_next;
+}
+
+/** Evict a single page using the second-chance policy
+ *
+ */
+static void evict(instr_cache_t *cache)
+{
+    while (true) {
+        instr_cache_item_t *victim = (instr_cache_item_t *) cache->items.head;
+        ASSERT(victim != NULL);
+
+        list_remove(&cache->items, &victim->item);
+
+        if (victim->referenced) {
+            victim->referenced = false;
+            list_append(&cache->items, &victim->item);
+            continue;
+        }
+
+        unhash(cache, victim);
+        cache->count--;
+        next_generation();
+        safe_free(victim->stats);
+        safe_free(victim);
+        return;
+    }
+}
+
+/** Look up a page in the cache
+ *
+ * @param cache Cache to search.
+ * @param addr  Any physical address within the page.
+ *
+ * @return The cached page or NULL if the page is not cached.
+ *
+ */
+instr_cache_item_t *instr_cache_find(instr_cache_t *cache, ptr36_t addr)
+{
+    if (cache->count == 0) {
+        return NULL;
+    }
+
+    ptr36_t page = ALIGN_DOWN(addr, FRAME_SIZE);
+
+    instr_cache_item_t *it = cache->buckets[bucket_index(cache, page)];
+    while (it != NULL) {
+        if (it->addr == page) {
+            it->referenced = true;
+            return it;
+        }
+        it = it->hash_next;
+    }
+
+    return NULL;
+}
+
+/** Insert a page into the cache
+ *
+ * Pages are evicted if the cache is full. The item has to be
+ * allocated by safe_malloc, the cache takes ownership of it.
+ *
+ * @param cache      Cache to insert to.
+ * @param cache_item Item to insert.
+ * @param addr       Any physical address within the page.
+ *
+ */
+void instr_cache_insert(instr_cache_t *cache, instr_cache_item_t *cache_item,
+        ptr36_t addr)
+{
+    ASSERT(instr_cache_find(cache, addr) == NULL);
+
+    while (cache->count >= instr_cache_capacity) {
+        evict(cache);
+    }
+
+    item_init(&cache_item->item);
+    cache_item->addr = ALIGN_DOWN(addr, FRAME_SIZE);
+    cache_item->referenced = false;
+    cache_item->stats = NULL;
+
+    list_append(&cache->items, &cache_item->item);
+    cache->count++;
+
+    if (cache->count > cache->bucket_count) {
+        rehash(cache, MAX(2 * cache->bucket_count, MIN_BUCKET_COUNT));
+    } else {
+        size_t index = bucket_index(cache, cache_item->addr);
+        cache_item->hash_next = cache->buckets[index];
+        cache->buckets[index] = cache_item;
+    }
+}
+
+/** Remove and free all cached pages
+ *
+ */
+void instr_cache_flush(instr_cache_t *cache)
+{
+    while (!is_empty(&cache->items)) {
+        instr_cache_item_t *cache_item = (instr_cache_item_t *) cache->items.head;
+        list_remove(&cache->items, &cache_item->item);
+        safe_free(cache_item->stats);
+        safe_free(cache_item);
+    }
+
+    safe_free(cache->buckets);
+    cache->bucket_count = 0;
+    cache->count = 0;
+
+    next_generation();
+}
+
+/** Prepare the statistics of a page being decoded
+ *
+ * @param cache_item Page being decoded.
+ * @param count      Number of the instructions of the page.
+ *
+ * @return Slots for the statistics of the decoded instructions or NULL
+ *         if the instruction statistics are disabled.
+ *
+ */
+instr_stats_t **instr_cache_item_stats(instr_cache_item_t *cache_item,
+        size_t count)
+{
+    if (!instr_stats_enabled) {
+        safe_free(cache_item->stats);
+        return NULL;
+    }
+
+    if (cache_item->stats == NULL) {
+        cache_item->stats = safe_malloc(count * sizeof(instr_stats_t *));
+    }
+
+    return cache_item->stats;
+}
+
+/** Forget the pages of the last instruction fetches of all processors
+ *
+ * Has to be called whenever the physical memory frames change.
+ *
+ */
+void instr_cache_invalidate(void)
+{
+    invalidations++;
+    next_generation();
+}
+
+/** Initialize the cache generation of a new thread
+ *
+ */
+void instr_cache_thread_init(void)
+{
+    thread_invalidations = invalidations;
+    next_generation();
+}
+
+/** Notice the invalidations done by the main thread
+ *
+ * Has to be called by the other threads before they step
+ * a processor, the physical memory frames may only change
+ * while they are not stepping any.
+ *
+ */
+void instr_cache_thread_sync(void)
+{
+    if (thread_invalidations != invalidations) {
+        thread_invalidations = invalidations;
+        next_generation();
+    }
+}
+
+/** Remember the page of the last instruction fetch
+ *
+ * @param fetch_page Fetch page of the processor.
+ * @param page       Cached page containing the fetched instruction.
+ * @param virt       Virtual address of the fetched instruction.
+ *
+ */
+void instr_fetch_page_set(instr_fetch_page_t *fetch_page,
+        instr_cache_item_t *page, uint64_t virt)
+{
+    fetch_page->page = page;
+    fetch_page->frame = physmem_find_frame(page->addr);
+    fetch_page->virt = ALIGN_DOWN(virt, FRAME_SIZE);
+    fetch_page->generation = instr_cache_generation;
+
+    ASSERT(fetch_page->frame != NULL);
+}
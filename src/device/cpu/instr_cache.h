@@ -0,0 +1,134 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Cache of decoded instruction pages
+ *
+ */
+
+#ifndef INSTR_CACHE_H_
+#define INSTR_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../../list.h"
+#include "../../main.h"
+#include "../../physmem.h"
+#include "instr_stats.h"
+
+/** Default number of pages kept in each decoded instruction cache */
+#define DEFAULT_INSTR_CACHE_CAPACITY 2048
+
+/** Header of a cached page of decoded instructions
+ *
+ * Has to be the first member of the architecture-specific
+ * cache item, the rest of the item holds the decoded page.
+ *
+ */
+typedef struct instr_cache_item {
+    /** Link in the eviction queue */
+    item_t item;
+
+    /** Next item in the same hash bucket */
+    struct instr_cache_item *hash_next;
+
+    /** Physical address of the page */
+    ptr36_t addr;
+
+    /** Referenced since the last eviction pass */
+    bool referenced;
+
+    /** Statistics of the decoded instructions (NULL if not counted) */
+    instr_stats_t **stats;
+} instr_cache_item_t;
+
+/** Decoded instruction cache
+ *
+ * Pages are indexed by a hash of the physical frame number and
+ * evicted using the second-chance (CLOCK) policy once the cache
+ * holds more than instr_cache_capacity pages.
+ *
+ */
+typedef struct {
+    /** Eviction queue (oldest first) */
+    list_t items;
+
+    /** Hash buckets (power of 2 count) */
+    instr_cache_item_t **buckets;
+    size_t bucket_count;
+
+    /** Number of cached pages */
+    size_t count;
+} instr_cache_t;
+
+#define INSTR_CACHE_INITIALIZER \
+    { \
+        .items = LIST_INITIALIZER, \
+        .buckets = NULL, \
+        .bucket_count = 0, \
+        .count = 0 \
+    }
+
+/** Page of the last instruction fetch of a processor
+ *
+ * Allows to skip the address translation and the cache lookup
+ * while the processor executes instructions from the same page.
+ * The architecture-specific code has to check that the translation
+ * context of the processor did not change.
+ *
+ */
+typedef struct {
+    /** Cached page (NULL if not valid) */
+    instr_cache_item_t *page;
+
+    /** Frame of the cached page */
+    frame_t *frame;
+
+    /** Virtual address of the page */
+    uint64_t virt;
+
+    /** Value of instr_cache_generation when the page was remembered */
+    unsigned int generation;
+} instr_fetch_page_t;
+
+/** Check whether an instruction can be fetched from the remembered page
+ *
+ * The page has to be still cached and its content must not have been
+ * modified since it was decoded.
+ *
+ */
+#define instr_fetch_page_hit(fp, addr) \
+    (((fp)->page != NULL) \
+            && ((fp)->virt == ALIGN_DOWN((uint64_t) (addr), FRAME_SIZE)) \
+            && ((fp)->generation == instr_cache_generation) \
+            && (frame_valid((fp)->frame)))
+
+/** Maximal number of pages per cache */
+extern unsigned int instr_cache_capacity;
+
+/** Changes whenever a cached page of the current thread might be released
+ *
+ * The caches are kept per thread. The generations are unique among
+ * the threads, so that the pages remembered by a processor stepped
+ * by another thread before are not used.
+ *
+ */
+extern _Thread_local unsigned int instr_cache_generation;
+
+extern bool instr_cache_set_capacity(unsigned int capacity);
+
+extern instr_cache_item_t *instr_cache_find(instr_cache_t *cache, ptr36_t addr);
+extern void instr_cache_insert(instr_cache_t *cache, instr_cache_item_t *cache_item,
+        ptr36_t addr);
+extern void instr_cache_flush(instr_cache_t *cache);
+extern instr_stats_t **instr_cache_item_stats(instr_cache_item_t *cache_item,
+        size_t count);
+extern void instr_cache_invalidate(void);
+extern void instr_cache_thread_init(void);
+extern void instr_cache_thread_sync(void);
+
+extern void instr_fetch_page_set(instr_fetch_page_t *fetch_page,
+        instr_cache_item_t *page, uint64_t virt);
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Execution statistics of the instruction implementations
+ *
+ *  While the statistics are enabled, the pages of the decoded instruction
+ *  caches are decoded to counting wrappers of the instruction
+ *  implementations, so the processors check nothing per instruction
+ *  when the statistics are disabled. The statistics are kept per
+ *  implementation (an opcode histogram of the decoded instructions).
+ *
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../physmem.h"
+#include "../../utils.h"
+#include "instr_stats.h"
+
+/** Initial number of the table slots (has to be a power of two) */
+#define INSTR_STATS_INITIAL_SLOTS 256
+
+bool instr_stats_enabled = false;
+
+/** Statistics of the implementations (open addressing) */
+static instr_stats_t **slots = NULL;
+static size_t slot_count = 0;
+static size_t slot_used = 0;
+
+/** Guards the table against the decoding by the parallel threads */
+static pthread_mutex_t table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Change the istat variable
+ *
+ * The decoded pages are invalidated, so that they are decoded
+ * again with or without the counting implementations.
+ *
+ * @return true if successful
+ *
+ */
+bool instr_stats_set_enabled(bool enabled)
+{
+    if (enabled != instr_stats_enabled) {
+        instr_stats_enabled = enabled;
+        physmem_invalidate_all();
+    }
+
+    return true;
+}
+
+static size_t slot_index(const instr_stats_arch_t *arch, instr_stats_fnc_t fnc)
+{
+    uint64_t hash = (((uint64_t) (uintptr_t) fnc) ^ ((uint64_t) (uintptr_t) arch))
+            * UINT64_C(0x9e3779b97f4a7c15);
+    return (size_t) (hash >> 32) & (slot_count - 1);
+}
+
+/** Find the slot of an implementation or an empty one
+ *
+ */
+static instr_stats_t **slot_find(const instr_stats_arch_t *arch,
+        instr_stats_fnc_t fnc)
+{
+    size_t index = slot_index(arch, fnc);
+
+    while ((slots[index] != NULL)
+            && ((slots[index]->fnc != fnc) || (slots[index]->arch != arch))) {
+        index = (index + 1) & (slot_count - 1);
+    }
+
+    return &slots[index];
+}
+
+/** Double the number of the table slots
+ *
+ */
+static void slots_grow(void)
+{
+    instr_stats_t **old_slots = slots;
+    size_t old_count = slot_count;
+
+    slot_count = (old_count == 0) ? INSTR_STATS_INITIAL_SLOTS : 2 * old_count;
+    slots = safe_malloc(slot_count * sizeof(instr_stats_t *));
+    memset(slots, 0, slot_count * sizeof(instr_stats_t *));
+
+    for (size_t i = 0; i < old_count; i++) {
+        if (old_slots[i] != NULL) {
+            *slot_find(old_slots[i]->arch, old_slots[i]->fnc) = old_slots[i];
+        }
+    }
+
+    safe_free(old_slots);
+}
+
+/** Get the statistics of an instruction implementation
+ *
+ * Called when a page is decoded with the statistics enabled.
+ *
+ * @param arch        Architecture of the instruction.
+ * @param fnc         Instruction implementation.
+ * @param access_size Bytes of memory accessed by the instruction.
+ *
+ * @return Statistics of the implementation.
+ *
+ */
+instr_stats_t *instr_stats_get(const instr_stats_arch_t *arch,
+        instr_stats_fnc_t fnc, unsigned int access_size)
+{
+    pthread_mutex_lock(&table_mutex);
+
+    /* Keep the table at most half full */
+    if (2 * (slot_used + 1) > slot_count) {
+        slots_grow();
+    }
+
+    instr_stats_t **slot = slot_find(arch, fnc);
+    if (*slot == NULL) {
+        instr_stats_t *stats = safe_malloc_t(instr_stats_t);
+        stats->arch = arch;
+        stats->fnc = fnc;
+        stats->name = arch->instr_name(fnc);
+        stats->access_size = access_size;
+        stats->executed = 0;
+        stats->exceptions = 0;
+        stats->bytes = 0;
+
+        *slot = stats;
+        slot_used++;
+    }
+
+    instr_stats_t *stats = *slot;
+    pthread_mutex_unlock(&table_mutex);
+
+    return stats;
+}
+
+/** Zero all the counters
+ *
+ * The statistics are kept, the decoded pages refer to them.
+ *
+ */
+void instr_stats_reset(void)
+{
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i] != NULL) {
+            slots[i]->executed = 0;
+            slots[i]->exceptions = 0;
+            slots[i]->bytes = 0;
+        }
+    }
+}
+
+/** Order the entries by decreasing execution count
+ *
+ */
+static int entry_compare(const void *a, const void *b)
+{
+    const instr_stats_t *sa = *(const instr_stats_t *const *) a;
+    const instr_stats_t *sb = *(const instr_stats_t *const *) b;
+
+    if (sa->executed != sb->executed) {
+        return (sa->executed > sb->executed) ? -1 : 1;
+    }
+
+    int cmp = strcmp(sa->arch->name, sb->arch->name);
+    if (cmp != 0) {
+        return cmp;
+    }
+
+    return strcmp(sa->name, sb->name);
+}
+
+/** Collect the executed instructions
+ *
+ * @param count Number of the returned entries.
+ * @param total Total number of the executed instructions.
+ *
+ * @return Entries sorted by decreasing execution count.
+ *
+ */
+static const instr_stats_t **entries_collect(size_t *count, uint64_t *total)
+{
+    const instr_stats_t **entries = safe_malloc(MAX(slot_used, 1) * sizeof(instr_stats_t *));
+    size_t entry_count = 0;
+
+    *total = 0;
+
+    for (size_t i = 0; i < slot_count; i++) {
+        const instr_stats_t *stats = slots[i];
+        if ((stats == NULL) || (stats->executed == 0)) {
+            continue;
+        }
+
+        entries[entry_count] = stats;
+        entry_count++;
+
+        *total += stats->executed;
+    }
+
+    qsort(entries, entry_count, sizeof(instr_stats_t *), entry_compare);
+
+    *count = entry_count;
+    return entries;
+}
+
+/** Print the statistics of the executed instructions
+ *
+ */
+void instr_stats_print(void)
+{
+    size_t entry_count;
+    uint64_t total;
+    const instr_stats_t **entries = entries_collect(&entry_count, &total);
+
+    printf("Statistics of %" PRIu64 " executed instructions\n", total);
+
+    if (entry_count > 0) {
+        printf("  Executed  Percent  Exceptions       Bytes  Instruction\n");
+    }
+
+    for (size_t i = 0; i < entry_count; i++) {
+        const instr_stats_t *stats = entries[i];
+
+        printf("%10" PRIu64 "  %6.2f%%  %10" PRIu64 "  %10" PRIu64 "  %s %s\n",
+                stats->executed, 100.0 * stats->executed / total,
+                stats->exceptions, stats->bytes, stats->arch->name,
+                stats->name);
+    }
+
+    safe_free(entries);
+}
+
+/** Write the statistics of the executed instructions
+ *
+ * @param filename Output file, NULL for the standard output.
+ * @param json     Write JSON instead of CSV.
+ *
+ * @return False if the file cannot be written.
+ *
+ */
+bool instr_stats_write(const char *filename, bool json)
+{
+    FILE *file = stdout;
+
+    if (filename != NULL) {
+        file = try_fopen(filename, "w");
+        if (file == NULL) {
+            return false;
+        }
+    }
+
+    size_t entry_count;
+    uint64_t total;
+    const instr_stats_t **entries = entries_collect(&entry_count, &total);
+
+    if (json) {
+        fprintf(file, "[");
+    } else {
+        fprintf(file, "arch,instruction,executed,exceptions,bytes\n");
+    }
+
+    for (size_t i = 0; i < entry_count; i++) {
+        const instr_stats_t *stats = entries[i];
+
+        if (json) {
+            fprintf(file, "%s\n  {\"arch\": \"%s\", \"instruction\": \"%s\", "
+                    "\"executed\": %" PRIu64 ", \"exceptions\": %" PRIu64 ", "
+                    "\"bytes\": %" PRIu64 "}",
+                    (i == 0) ? "" : ",", stats->arch->name, stats->name,
+                    stats->executed, stats->exceptions, stats->bytes);
+        } else {
+            fprintf(file, "%s,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                    stats->arch->name, stats->name, stats->executed,
+                    stats->exceptions, stats->bytes);
+        }
+    }
+
+    if (json) {
+        fprintf(file, "%s]\n", (entry_count == 0) ? "" : "\n");
+    }
+
+    safe_free(entries);
+
+    if (filename != NULL) {
+        safe_fclose(file, filename);
+    }
+
+    return true;
+}
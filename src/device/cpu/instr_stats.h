@@ -0,0 +1,84 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Execution statistics of the instruction implementations
+ *
+ */
+
+#ifndef INSTR_STATS_H_
+#define INSTR_STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../../utils.h"
+
+/** Instruction implementation of any architecture
+ *
+ * Has to be converted back to the architecture-specific
+ * type before it is called.
+ *
+ */
+typedef void (*instr_stats_fnc_t)(void);
+
+/** Architecture of the counted instructions */
+typedef struct {
+    /** Name of the architecture in the reports */
+    const char *name;
+
+    /** Canonical mnemonic of an instruction implementation */
+    const char *(*instr_name)(instr_stats_fnc_t fnc);
+} instr_stats_arch_t;
+
+/** Execution statistics of an instruction implementation
+ *
+ * The statistics are never freed, the pages decoded
+ * with the statistics enabled refer to them.
+ *
+ */
+typedef struct {
+    const instr_stats_arch_t *arch;
+    instr_stats_fnc_t fnc;
+
+    /** Mnemonic of the implementation in the reports */
+    const char *name;
+
+    /** Bytes of memory accessed by a single execution */
+    unsigned int access_size;
+
+    uint64_t executed;
+    uint64_t exceptions;
+    uint64_t bytes;
+} instr_stats_t;
+
+/** The pages are decoded with the counting instruction implementations */
+extern bool instr_stats_enabled;
+
+extern bool instr_stats_set_enabled(bool enabled);
+
+extern instr_stats_t *instr_stats_get(const instr_stats_arch_t *arch,
+        instr_stats_fnc_t fnc, unsigned int access_size);
+
+/** Account a single execution of an instruction
+ *
+ * The counters are not atomic, the statistics
+ * of the parallel simulation are approximate.
+ *
+ */
+static inline void instr_stats_count(instr_stats_t *stats, bool exception)
+{
+    stats->executed++;
+
+    if (exception) {
+        stats->exceptions++;
+    } else {
+        stats->bytes += stats->access_size;
+    }
+}
+
+extern void instr_stats_reset(void);
+extern void instr_stats_print(void);
+extern bool instr_stats_write(const char *filename, bool json);
+
+#endif
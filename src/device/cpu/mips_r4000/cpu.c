@@ -25,8 +25,12 @@
 #include "../../../main.h"
 #include "../../../physmem.h"
 #include "../../../text.h"
+#include "../../../trace.h"
 #include "../../../utils.h"
 #include "../../device.h"
+#include "../../parallel.h"
+#include "../instr_cache.h"
+#include "../instr_stats.h"
 #include "cpu.h"
 #include "debug.h"
 
@@ -299,12 +303,78 @@ static shift_tab_t shift_tab_right_store[] = {
     { UINT32_C(0x00ffffff), 24 }
 };
 
+/** Empty TLB hash chain */
+#define TLB_HASH_NONE UINT8_MAX
+
+/** Hash of the VPN2 of a virtual address masked by a TLB entry mask */
+static inline unsigned int tlb_hash_vpn2(uint32_t vpn2)
+{
+    vpn2 >>= 13;
+    return (vpn2 ^ (vpn2 >> 6)) & (TLB_HASH_SIZE - 1);
+}
+
+/** Rebuild the TLB index and flush the micro-TLBs
+ *
+ * Has to be called whenever a TLB entry changes.
+ *
+ */
+static void tlb_rebuild_index(r4k_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    cpu->tlb_mask_count = 0;
+    memset(cpu->tlb_hash, TLB_HASH_NONE, sizeof(cpu->tlb_hash));
+
+    for (unsigned int i = 0; i < TLB_ENTRIES; i++) {
+        tlb_entry_t *entry = &cpu->tlb[i];
+
+        unsigned int m;
+        for (m = 0; m < cpu->tlb_mask_count; m++) {
+            if (cpu->tlb_masks[m] == entry->mask) {
+                break;
+            }
+        }
+
+        if (m == cpu->tlb_mask_count) {
+            cpu->tlb_masks[m] = entry->mask;
+            cpu->tlb_mask_count++;
+        }
+
+        unsigned int bucket = tlb_hash_vpn2(entry->vpn2);
+        cpu->tlb_hash_next[i] = cpu->tlb_hash[bucket];
+        cpu->tlb_hash[bucket] = i;
+    }
+
+    memset(cpu->tlb_micro_fetch, 0, sizeof(cpu->tlb_micro_fetch));
+    memset(cpu->tlb_micro_data, 0, sizeof(cpu->tlb_micro_data));
+}
+
+/** Update the TLB hint after a hit of the given entry
+ *
+ * The hint keeps the distance of the hit entry from the previous
+ * hint, which determines the entry found first if several entries
+ * match the same address.
+ *
+ */
+static inline void tlb_update_hint(r4k_cpu_t *cpu, unsigned int index)
+{
+    cpu->tlb_hint = (index + TLB_ENTRIES - cpu->tlb_hint) % TLB_ENTRIES;
+}
+
 /** Address traslation through the TLB table
+ *
+ * Recent translations are looked up in the micro-TLB of the
+ * access mode first. Otherwise the entries matching the address
+ * are found through the hashed index for each page mask in use.
+ * Only translations matched by a single entry are kept in the
+ * micro-TLBs, so the result of the lookup does not depend
+ * on the TLB hint in that case.
  *
  * See tlb_look_t definition
  *
  */
-static tlb_look_t tlb_look(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr)
+static tlb_look_t tlb_look(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
+        acc_mode_t mode)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
@@ -314,45 +384,91 @@ static tlb_look_t tlb_look(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr)
         return TLBL_OK;
     }
 
-    unsigned int hint = cpu->tlb_hint;
-    unsigned int i;
+    bool wr = (mode == AM_WRITE);
+    uint8_t asid = cp0_entryhi_asid(cpu);
+    uint32_t vpn = virt.lo >> 12;
 
-    /* Look for the TBL hit */
-    for (i = 0; i < TLB_ENTRIES; i++) {
-        tlb_entry_t *entry = &cpu->tlb[(i + hint) % TLB_ENTRIES];
+    /* Micro-TLB hit? */
+    tlb_micro_entry_t *micro = (mode == AM_FETCH)
+            ? &cpu->tlb_micro_fetch[vpn & (TLB_MICRO_ENTRIES - 1)]
+            : &cpu->tlb_micro_data[vpn & (TLB_MICRO_ENTRIES - 1)];
 
-        /* TLB hit? */
-        if ((virt.lo & entry->mask) == entry->vpn2) {
-            /* Test ASID */
-            if ((!entry->global) && (entry->asid != cp0_entryhi_asid(cpu))) {
+    if ((micro->valid) && (micro->vpn == vpn) && (micro->asid == asid)
+            && ((!wr) || (micro->dirty))) {
+        *phys = micro->frame | (virt.lo & UINT32_C(0x00000fff));
+        tlb_update_hint(cpu, micro->index);
+        return TLBL_OK;
+    }
+
+    /* Look for the TLB hit nearest to the hint */
+    unsigned int found = TLB_ENTRIES;
+    unsigned int distance = TLB_ENTRIES;
+    unsigned int matches = 0;
+
+    for (unsigned int m = 0; m < cpu->tlb_mask_count; m++) {
+        uint32_t mask = cpu->tlb_masks[m];
+        uint32_t vpn2 = virt.lo & mask;
+        unsigned int i;
+
+        for (i = cpu->tlb_hash[tlb_hash_vpn2(vpn2)]; i != TLB_HASH_NONE;
+                i = cpu->tlb_hash_next[i]) {
+            tlb_entry_t *entry = &cpu->tlb[i];
+
+            if ((entry->mask != mask) || (entry->vpn2 != vpn2)) {
                 continue;
             }
 
-            /* Calculate subpage */
-            ptr36_t smask = (ptr36_t) (entry->mask >> 1) | TLB_PHYSMASK;
-            unsigned int subpage = ((virt.lo & entry->mask) < (virt.lo & smask)) ? 1 : 0;
-
-            /* Test valid & dirty */
-            if (!entry->pg[subpage].valid) {
-                return TLBL_INVALID;
+            /* Test ASID */
+            if ((!entry->global) && (entry->asid != asid)) {
+                continue;
             }
 
-            if ((wr) && (!entry->pg[subpage].dirty)) {
-                return TLBL_MODIFIED;
+            unsigned int dist = (i + TLB_ENTRIES - cpu->tlb_hint) % TLB_ENTRIES;
+            if (dist < distance) {
+                distance = dist;
+                found = i;
             }
 
-            /* Make address */
-            ptr36_t amask = virt.lo & (~smask);
-            *phys = amask | (entry->pg[subpage].pfn & smask);
+            matches++;
+        }
+    }
+
+    if (matches == 0) {
+        return TLBL_REFILL;
+    }
 
-            /* Update optimization hint */
-            cpu->tlb_hint = i;
+    tlb_entry_t *entry = &cpu->tlb[found];
 
-            return TLBL_OK;
-        }
+    /* Calculate subpage */
+    ptr36_t smask = (ptr36_t) (entry->mask >> 1) | TLB_PHYSMASK;
+    unsigned int subpage = ((virt.lo & entry->mask) < (virt.lo & smask)) ? 1 : 0;
+
+    /* Test valid & dirty */
+    if (!entry->pg[subpage].valid) {
+        return TLBL_INVALID;
+    }
+
+    if ((wr) && (!entry->pg[subpage].dirty)) {
+        return TLBL_MODIFIED;
+    }
+
+    /* Make address */
+    ptr36_t amask = virt.lo & (~smask);
+    *phys = amask | (entry->pg[subpage].pfn & smask);
+
+    /* Update optimization hint */
+    tlb_update_hint(cpu, found);
+
+    if (matches == 1) {
+        micro->valid = true;
+        micro->dirty = entry->pg[subpage].dirty;
+        micro->asid = asid;
+        micro->index = found;
+        micro->vpn = vpn;
+        micro->frame = *phys & ~((ptr36_t) UINT32_C(0x00000fff));
     }
 
-    return TLBL_REFILL;
+    return TLBL_OK;
 }
 
 /** Fill up cp0 registers with specified address
@@ -394,13 +510,13 @@ static void fill_addr_error(r4k_cpu_t *cpu, ptr64_t addr, bool noisy)
 /** Search through TLB and generates apropriate exception (32 bits)
  *
  */
-static r4k_exc_t tlb_hit32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr,
-        bool noisy)
+static r4k_exc_t tlb_hit32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
 
-    switch (tlb_look(cpu, virt, phys, wr)) {
+    switch (tlb_look(cpu, virt, phys, mode)) {
     case TLBL_OK:
         break;
     case TLBL_REFILL:
@@ -432,8 +548,8 @@ static r4k_exc_t tlb_hit32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr,
 /** Search through TLB and generates apropriate exception (64 bits)
  *
  */
-static r4k_exc_t tlb_hit64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr,
-        bool noisy)
+static r4k_exc_t tlb_hit64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
@@ -447,14 +563,14 @@ static r4k_exc_t tlb_hit64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr,
  *
  */
 static r4k_exc_t convert_addr_user32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
-        bool wr, bool noisy)
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
     ASSERT(CPU_USER_MODE(cpu));
 
     if ((virt.lo & USEG_MASK) == USEG_BITS) {
-        return tlb_hit32(cpu, virt, phys, wr, noisy);
+        return tlb_hit32(cpu, virt, phys, mode, noisy);
     }
 
     fill_addr_error(cpu, virt, noisy);
@@ -465,14 +581,14 @@ static r4k_exc_t convert_addr_user32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys
  *
  */
 static r4k_exc_t convert_addr_user64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
-        bool wr, bool noisy)
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
     ASSERT(CPU_USER_MODE(cpu));
 
     if ((virt.ptr & XUSEG_MASK) == XUSEG_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     fill_addr_error(cpu, virt, noisy);
@@ -483,18 +599,18 @@ static r4k_exc_t convert_addr_user64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys
  *
  */
 static r4k_exc_t convert_addr_supervisor32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
-        bool wr, bool noisy)
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
     ASSERT(CPU_SUPERVISOR_MODE(cpu));
 
     if ((virt.lo & SUSEG_MASK) == SUSEG_BITS) {
-        return tlb_hit32(cpu, virt, phys, wr, noisy);
+        return tlb_hit32(cpu, virt, phys, mode, noisy);
     }
 
     if ((virt.lo & SSEG_MASK) == SSEG_BITS) {
-        return tlb_hit32(cpu, virt, phys, wr, noisy);
+        return tlb_hit32(cpu, virt, phys, mode, noisy);
     }
 
     fill_addr_error(cpu, virt, noisy);
@@ -505,22 +621,22 @@ static r4k_exc_t convert_addr_supervisor32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t
  *
  */
 static r4k_exc_t convert_addr_supervisor64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
-        bool wr, bool noisy)
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
     ASSERT(CPU_SUPERVISOR_MODE(cpu));
 
     if ((virt.ptr & XSUSEG_MASK) == XSUSEG_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     if ((virt.ptr & XSSEG_MASK) == XSSEG_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     if ((virt.ptr & CSSEG_MASK) == CSSEG_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     fill_addr_error(cpu, virt, noisy);
@@ -531,7 +647,7 @@ static r4k_exc_t convert_addr_supervisor64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t
  *
  */
 static r4k_exc_t convert_addr_kernel32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
-        bool wr, bool noisy)
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
@@ -539,9 +655,11 @@ static r4k_exc_t convert_addr_kernel32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *ph
 
     if ((virt.lo & KUSEG_MASK) == KUSEG_BITS) {
         if (!cp0_status_erl(cpu)) {
-            return tlb_hit32(cpu, virt, phys, wr, noisy);
+            return tlb_hit32(cpu, virt, phys, mode, noisy);
         }
 
+        /* Unmapped with the error level set */
+        *phys = virt.lo;
         return r4k_excNone;
     }
 
@@ -556,11 +674,11 @@ static r4k_exc_t convert_addr_kernel32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *ph
     }
 
     if ((virt.lo & KSSEG_MASK) == KSSEG_BITS) {
-        return tlb_hit32(cpu, virt, phys, wr, noisy);
+        return tlb_hit32(cpu, virt, phys, mode, noisy);
     }
 
     if ((virt.lo & KSEG3_MASK) == KSEG3_BITS) {
-        return tlb_hit32(cpu, virt, phys, wr, noisy);
+        return tlb_hit32(cpu, virt, phys, mode, noisy);
     }
 
     fill_addr_error(cpu, virt, noisy);
@@ -571,7 +689,7 @@ static r4k_exc_t convert_addr_kernel32(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *ph
  *
  */
 static r4k_exc_t convert_addr_kernel64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
-        bool wr, bool noisy)
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
@@ -579,14 +697,16 @@ static r4k_exc_t convert_addr_kernel64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *ph
 
     if ((virt.ptr & XKSUSEG_MASK) == XKSUSEG_BITS) {
         if (!cp0_status_erl(cpu)) {
-            return tlb_hit64(cpu, virt, phys, wr, noisy);
+            return tlb_hit64(cpu, virt, phys, mode, noisy);
         }
 
+        /* Unmapped with the error level set */
+        *phys = virt.lo;
         return r4k_excNone;
     }
 
     if ((virt.ptr & XKSSEG_MASK) == XKSSEG_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     if ((virt.ptr & XKPHYS_MASK) == XKPHYS_BITS) {
@@ -594,7 +714,7 @@ static r4k_exc_t convert_addr_kernel64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *ph
     }
 
     if ((virt.ptr & XKSEG_MASK) == XKSEG_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     if ((virt.ptr & CKSEG0_MASK) == CKSEG0_BITS) {
@@ -608,11 +728,11 @@ static r4k_exc_t convert_addr_kernel64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *ph
     }
 
     if ((virt.lo & CKSSEG_MASK) == CKSSEG_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     if ((virt.lo & CKSEG3_MASK) == CKSEG3_BITS) {
-        return tlb_hit64(cpu, virt, phys, wr, noisy);
+        return tlb_hit64(cpu, virt, phys, mode, noisy);
     }
 
     fill_addr_error(cpu, virt, noisy);
@@ -621,13 +741,13 @@ static r4k_exc_t convert_addr_kernel64(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *ph
 
 /** The conversion of virtual addresses
  *
- * @param write Write access.
+ * @param mode  Memory access mode
  * @param noisy Fill apropriate processor registers
  *              if the address is incorrect.
  *
  */
-r4k_exc_t r4k_convert_addr(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool write,
-        bool noisy)
+static r4k_exc_t convert_addr(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys,
+        acc_mode_t mode, bool noisy)
 {
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
@@ -642,30 +762,30 @@ r4k_exc_t r4k_convert_addr(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wri
 
     if (CPU_64BIT_MODE(cpu)) {
         if (CPU_USER_MODE(cpu)) {
-            return convert_addr_user64(cpu, virt, phys, write, noisy);
+            return convert_addr_user64(cpu, virt, phys, mode, noisy);
         }
 
         if (CPU_SUPERVISOR_MODE(cpu)) {
-            return convert_addr_supervisor64(cpu, virt, phys, write, noisy);
+            return convert_addr_supervisor64(cpu, virt, phys, mode, noisy);
         }
 
         if (CPU_KERNEL_MODE(cpu)) {
-            convert_addr_kernel64(cpu, virt, phys, write, noisy);
+            convert_addr_kernel64(cpu, virt, phys, mode, noisy);
         }
 
         fill_addr_error(cpu, virt, noisy);
         return r4k_excAddrError;
     } else {
         if (CPU_USER_MODE(cpu)) {
-            return convert_addr_user32(cpu, virt, phys, write, noisy);
+            return convert_addr_user32(cpu, virt, phys, mode, noisy);
         }
 
         if (CPU_SUPERVISOR_MODE(cpu)) {
-            return convert_addr_supervisor32(cpu, virt, phys, write, noisy);
+            return convert_addr_supervisor32(cpu, virt, phys, mode, noisy);
         }
 
         if (CPU_KERNEL_MODE(cpu)) {
-            return convert_addr_kernel32(cpu, virt, phys, write, noisy);
+            return convert_addr_kernel32(cpu, virt, phys, mode, noisy);
         }
 
         fill_addr_error(cpu, virt, noisy);
@@ -673,6 +793,19 @@ r4k_exc_t r4k_convert_addr(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wri
     }
 }
 
+/** The conversion of virtual addresses of data accesses
+ *
+ * @param write Write access.
+ * @param noisy Fill apropriate processor registers
+ *              if the address is incorrect.
+ *
+ */
+r4k_exc_t r4k_convert_addr(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool write,
+        bool noisy)
+{
+    return convert_addr(cpu, virt, phys, write ? AM_WRITE : AM_READ, noisy);
+}
+
 /** Test for correct alignment (16 bits)
  *
  * Fill BadVAddr if the alignment is not correct.
@@ -743,7 +876,7 @@ static r4k_exc_t access_mem(r4k_cpu_t *cpu, acc_mode_t mode, ptr64_t virt,
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
 
-    r4k_exc_t res = r4k_convert_addr(cpu, virt, phys, mode == AM_WRITE, noisy);
+    r4k_exc_t res = convert_addr(cpu, virt, phys, mode, noisy);
 
     /* Check for watched address */
     if (((cp0_watchlo_r(cpu)) && (mode == AM_READ))
@@ -794,7 +927,7 @@ static r4k_exc_t cpu_read_mem8(r4k_cpu_t *cpu, ptr64_t addr, uint8_t *val, bool
         ASSERT(false);
     }
 
-    *val = physmem_read8(cpu->procno, phys, true);
+    *val = physmem_fast_read8(cpu->procno, phys);
     return res;
 }
 
@@ -833,7 +966,7 @@ static r4k_exc_t cpu_read_mem16(r4k_cpu_t *cpu, ptr64_t addr, uint16_t *val, boo
         ASSERT(false);
     }
 
-    *val = physmem_read16(cpu->procno, phys, true);
+    *val = physmem_fast_read16(cpu->procno, phys);
     return res;
 }
 
@@ -872,7 +1005,7 @@ r4k_exc_t r4k_read_mem32(r4k_cpu_t *cpu, ptr64_t addr, uint32_t *val, bool noisy
         ASSERT(false);
     }
 
-    *val = physmem_read32(cpu->procno, phys, true);
+    *val = physmem_fast_read32(cpu->procno, phys);
     return res;
 }
 
@@ -911,7 +1044,7 @@ static r4k_exc_t cpu_read_mem64(r4k_cpu_t *cpu, ptr64_t addr, uint64_t *val, boo
         ASSERT(false);
     }
 
-    *val = physmem_read64(cpu->procno, phys, true);
+    *val = physmem_fast_read64(cpu->procno, phys);
     return res;
 }
 
@@ -939,7 +1072,12 @@ static r4k_exc_t cpu_write_mem8(r4k_cpu_t *cpu, ptr64_t addr, uint8_t value, boo
         ASSERT(false);
     }
 
-    physmem_write8(cpu->procno, phys, value, true);
+    physmem_fast_write8(cpu->procno, phys, value);
+
+    if ((trace_enabled) && (noisy)) {
+        trace_store(cpu->procno, addr.ptr, 1, value);
+    }
+
     return res;
 }
 
@@ -978,7 +1116,12 @@ static r4k_exc_t cpu_write_mem16(r4k_cpu_t *cpu, ptr64_t addr, uint16_t value,
         ASSERT(false);
     }
 
-    physmem_write16(cpu->procno, phys, value, true);
+    physmem_fast_write16(cpu->procno, phys, value);
+
+    if ((trace_enabled) && (noisy)) {
+        trace_store(cpu->procno, addr.ptr, 2, value);
+    }
+
     return res;
 }
 
@@ -1017,7 +1160,12 @@ static r4k_exc_t cpu_write_mem32(r4k_cpu_t *cpu, ptr64_t addr, uint32_t value,
         ASSERT(false);
     }
 
-    physmem_write32(cpu->procno, phys, value, true);
+    physmem_fast_write32(cpu->procno, phys, value);
+
+    if ((trace_enabled) && (noisy)) {
+        trace_store(cpu->procno, addr.ptr, 4, value);
+    }
+
     return res;
 }
 
@@ -1056,7 +1204,112 @@ static r4k_exc_t cpu_write_mem64(r4k_cpu_t *cpu, ptr64_t addr, uint64_t value,
         ASSERT(false);
     }
 
-    physmem_write64(cpu->procno, phys, value, true);
+    physmem_fast_write64(cpu->procno, phys, value);
+
+    if ((trace_enabled) && (noisy)) {
+        trace_store(cpu->procno, addr.ptr, 8, value);
+    }
+
+    return res;
+}
+
+/** Perform conditional write operation to the virtual memory (32 bits)
+ *
+ * The value is written only if the memory still holds the expected value
+ * (the value loaded by LL). The value is compared only when the processors
+ * run in parallel, otherwise the LL-SC tracking catches all the writes.
+ *
+ */
+static r4k_exc_t cpu_cas_mem32(r4k_cpu_t *cpu, ptr64_t addr, uint32_t expected,
+        uint32_t value, bool *written)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(written != NULL);
+
+    *written = true;
+
+    if (!parallel_running) {
+        return cpu_write_mem32(cpu, addr, value, true);
+    }
+
+    r4k_exc_t res = align_test32(cpu, addr, true);
+    switch (res) {
+    case r4k_excNone:
+        break;
+    case r4k_excAddrError:
+        return r4k_excAdES;
+    default:
+        ASSERT(false);
+    }
+
+    ptr36_t phys;
+    res = access_mem(cpu, AM_WRITE, addr, &phys, true);
+    switch (res) {
+    case r4k_excNone:
+        break;
+    case r4k_excAddrError:
+        return r4k_excAdES;
+    case r4k_excTLB:
+        return r4k_excTLBS;
+    case r4k_excTLBR:
+        return r4k_excTLBSR;
+    case r4k_excMod:
+        return r4k_excMod;
+    default:
+        ASSERT(false);
+    }
+
+    *written = physmem_cas32(cpu->procno, phys, expected, value);
+    return res;
+}
+
+/** Perform conditional write operation to the virtual memory (64 bits)
+ *
+ * The value is written only if the memory still holds the expected value
+ * (the value loaded by LL). The value is compared only when the processors
+ * run in parallel, otherwise the LL-SC tracking catches all the writes.
+ *
+ */
+static r4k_exc_t cpu_cas_mem64(r4k_cpu_t *cpu, ptr64_t addr, uint64_t expected,
+        uint64_t value, bool *written)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(written != NULL);
+
+    *written = true;
+
+    if (!parallel_running) {
+        return cpu_write_mem64(cpu, addr, value, true);
+    }
+
+    r4k_exc_t res = align_test64(cpu, addr, true);
+    switch (res) {
+    case r4k_excNone:
+        break;
+    case r4k_excAddrError:
+        return r4k_excAdES;
+    default:
+        ASSERT(false);
+    }
+
+    ptr36_t phys;
+    res = access_mem(cpu, AM_WRITE, addr, &phys, true);
+    switch (res) {
+    case r4k_excNone:
+        break;
+    case r4k_excAddrError:
+        return r4k_excAdES;
+    case r4k_excTLB:
+        return r4k_excTLBS;
+    case r4k_excTLBR:
+        return r4k_excTLBSR;
+    case r4k_excMod:
+        return r4k_excMod;
+    default:
+        ASSERT(false);
+    }
+
+    *written = physmem_cas64(cpu->procno, phys, expected, value);
     return res;
 }
 
@@ -1159,6 +1412,7 @@ static r4k_exc_t TLBW(r4k_cpu_t *cpu, bool random)
         } else {
             /* Fill TLB */
             tlb_entry_t *entry = &cpu->tlb[index];
+            cpu->tlb_generation++;
 
             entry->mask = cp0_entryhi_vpn2_mask & ~cp0_pagemask(cpu).val;
             entry->vpn2 = cp0_entryhi(cpu).val & entry->mask;
@@ -1174,6 +1428,8 @@ static r4k_exc_t TLBW(r4k_cpu_t *cpu, bool random)
             entry->pg[1].cohh = cp0_entrylo1_c(cpu);
             entry->pg[1].dirty = cp0_entrylo1_d(cpu);
             entry->pg[1].valid = cp0_entrylo1_v(cpu);
+
+            tlb_rebuild_index(cpu);
         }
 
         return r4k_excNone;
@@ -2637,6 +2893,7 @@ void r4k_init(r4k_cpu_t *cpu, unsigned int procno)
 
     /* Initially set all members to zero */
     memset(cpu, 0, sizeof(r4k_cpu_t));
+    tlb_rebuild_index(cpu);
 
     cpu->procno = procno;
     r4k_set_pc(cpu, start_address);
@@ -2836,58 +3093,289 @@ static r4k_instr_fnc_t decode(r4k_instr_t instr)
     return fnc;
 }
 
+/** Pre-decode MIPS R4000 instruction
+ *
+ */
+static void predecode(r4k_decoded_instr_t *decoded, r4k_instr_t instr)
+{
+    decoded->fnc = decode(instr);
+    decoded->imm = sign_extend_16_64(instr.i.imm);
+    decoded->raw = instr;
+    decoded->rs = instr.r.rs;
+    decoded->rt = instr.r.rt;
+    decoded->rd = instr.r.rd;
+    decoded->sa = instr.r.sa;
+}
+
 typedef struct {
-    item_t item;
-    ptr36_t addr;
-    r4k_instr_fnc_t instrs[FRAME_SIZE / sizeof(r4k_instr_t)];
+    instr_cache_item_t header;
+    r4k_decoded_instr_t instrs[FRAME_SIZE / sizeof(r4k_instr_t)];
 } cache_item_t;
 
 #define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(r4k_instr_t))
 
-static void cache_item_init(cache_item_t *cache_item)
-{
-    item_init(&cache_item->item);
-    cache_item->addr = 0;
-    // Skip instrs init
-}
+_Thread_local instr_cache_t r4k_instruction_cache = INSTR_CACHE_INITIALIZER;
+
+/** Bytes of memory accessed by the load and store instructions */
+static const uint8_t access_size_map[64] = {
+    [r4k_opcLDL] = 8,
+    [r4k_opcLDR] = 8,
+    [r4k_opcLB] = 1,
+    [r4k_opcLH] = 2,
+    [r4k_opcLWL] = 4,
+    [r4k_opcLW] = 4,
+    [r4k_opcLBU] = 1,
+    [r4k_opcLHU] = 2,
+    [r4k_opcLWR] = 4,
+    [r4k_opcLWU] = 4,
+    [r4k_opcSB] = 1,
+    [r4k_opcSH] = 2,
+    [r4k_opcSWL] = 4,
+    [r4k_opcSW] = 4,
+    [r4k_opcSDL] = 8,
+    [r4k_opcSDR] = 8,
+    [r4k_opcSWR] = 4,
+    [r4k_opcLL] = 4,
+    [r4k_opcLWC1] = 4,
+    [r4k_opcLDD] = 8,
+    [r4k_opcLDC1] = 8,
+    [r4k_opcLD] = 8,
+    [r4k_opcSC] = 4,
+    [r4k_opcSWC1] = 4,
+    [r4k_opcSCD] = 8,
+    [r4k_opcSDC1] = 8,
+    [r4k_opcSD] = 8
+};
+
+#define INSTR_NAME(name) { instr_ ## name, #name }
+
+/** Canonical mnemonics of the instruction implementations */
+static const struct {
+    r4k_instr_fnc_t fnc;
+    const char *name;
+} instr_names[] = {
+    INSTR_NAME(_reserved),
+    INSTR_NAME(_warning),
+    INSTR_NAME(_xcrd),
+    INSTR_NAME(_xhlt),
+    INSTR_NAME(_xint),
+    INSTR_NAME(_xrd),
+    INSTR_NAME(_xtr0),
+    INSTR_NAME(_xtrc),
+    INSTR_NAME(_xval),
+    INSTR_NAME(add),
+    INSTR_NAME(addi),
+    INSTR_NAME(addiu),
+    INSTR_NAME(addu),
+    INSTR_NAME(and),
+    INSTR_NAME(andi),
+    INSTR_NAME(bc0f),
+    INSTR_NAME(bc0fl),
+    INSTR_NAME(bc0t),
+    INSTR_NAME(bc0tl),
+    INSTR_NAME(bc1f),
+    INSTR_NAME(bc1fl),
+    INSTR_NAME(bc1t),
+    INSTR_NAME(bc1tl),
+    INSTR_NAME(bc2f),
+    INSTR_NAME(bc2fl),
+    INSTR_NAME(bc2t),
+    INSTR_NAME(bc2tl),
+    INSTR_NAME(beq),
+    INSTR_NAME(beql),
+    INSTR_NAME(bgez),
+    INSTR_NAME(bgezal),
+    INSTR_NAME(bgezall),
+    INSTR_NAME(bgezl),
+    INSTR_NAME(bgtz),
+    INSTR_NAME(bgtzl),
+    INSTR_NAME(blez),
+    INSTR_NAME(blezl),
+    INSTR_NAME(bltz),
+    INSTR_NAME(bltzal),
+    INSTR_NAME(bltzall),
+    INSTR_NAME(bltzl),
+    INSTR_NAME(bne),
+    INSTR_NAME(bnel),
+    INSTR_NAME(break),
+    INSTR_NAME(cache),
+    INSTR_NAME(cfc1),
+    INSTR_NAME(cfc2),
+    INSTR_NAME(ctc1),
+    INSTR_NAME(ctc2),
+    INSTR_NAME(dadd),
+    INSTR_NAME(daddi),
+    INSTR_NAME(daddiu),
+    INSTR_NAME(daddu),
+    INSTR_NAME(ddiv),
+    INSTR_NAME(ddivu),
+    INSTR_NAME(div),
+    INSTR_NAME(divu),
+    INSTR_NAME(dmfc0),
+    INSTR_NAME(dmfc1),
+    INSTR_NAME(dmtc0),
+    INSTR_NAME(dmtc1),
+    INSTR_NAME(dmult),
+    INSTR_NAME(dmultu),
+    INSTR_NAME(dsll),
+    INSTR_NAME(dsll32),
+    INSTR_NAME(dsllv),
+    INSTR_NAME(dsra),
+    INSTR_NAME(dsra32),
+    INSTR_NAME(dsrav),
+    INSTR_NAME(dsrl),
+    INSTR_NAME(dsrl32),
+    INSTR_NAME(dsrlv),
+    INSTR_NAME(dsub),
+    INSTR_NAME(dsubu),
+    INSTR_NAME(eret),
+    INSTR_NAME(j),
+    INSTR_NAME(jal),
+    INSTR_NAME(jalr),
+    INSTR_NAME(jr),
+    INSTR_NAME(lb),
+    INSTR_NAME(lbu),
+    INSTR_NAME(ld),
+    INSTR_NAME(ldc1),
+    INSTR_NAME(ldc2),
+    INSTR_NAME(ldl),
+    INSTR_NAME(ldr),
+    INSTR_NAME(lh),
+    INSTR_NAME(lhu),
+    INSTR_NAME(ll),
+    INSTR_NAME(lld),
+    INSTR_NAME(lui),
+    INSTR_NAME(lw),
+    INSTR_NAME(lwc1),
+    INSTR_NAME(lwc2),
+    INSTR_NAME(lwl),
+    INSTR_NAME(lwr),
+    INSTR_NAME(lwu),
+    INSTR_NAME(mfc0),
+    INSTR_NAME(mfc1),
+    INSTR_NAME(mfc2),
+    INSTR_NAME(mfhi),
+    INSTR_NAME(mflo),
+    INSTR_NAME(mtc0),
+    INSTR_NAME(mtc1),
+    INSTR_NAME(mthi),
+    INSTR_NAME(mtlo),
+    INSTR_NAME(mult),
+    INSTR_NAME(multu),
+    INSTR_NAME(nor),
+    INSTR_NAME(or),
+    INSTR_NAME(ori),
+    INSTR_NAME(sb),
+    INSTR_NAME(sc),
+    INSTR_NAME(scd),
+    INSTR_NAME(sd),
+    INSTR_NAME(sdc1),
+    INSTR_NAME(sdc2),
+    INSTR_NAME(sdl),
+    INSTR_NAME(sdr),
+    INSTR_NAME(sh),
+    INSTR_NAME(sll),
+    INSTR_NAME(sllv),
+    INSTR_NAME(slt),
+    INSTR_NAME(slti),
+    INSTR_NAME(sltiu),
+    INSTR_NAME(sltu),
+    INSTR_NAME(sra),
+    INSTR_NAME(srav),
+    INSTR_NAME(srl),
+    INSTR_NAME(srlv),
+    INSTR_NAME(sub),
+    INSTR_NAME(subu),
+    INSTR_NAME(sw),
+    INSTR_NAME(swc1),
+    INSTR_NAME(swc2),
+    INSTR_NAME(swl),
+    INSTR_NAME(swr),
+    INSTR_NAME(sync),
+    INSTR_NAME(syscall),
+    INSTR_NAME(teq),
+    INSTR_NAME(teqi),
+    INSTR_NAME(tge),
+    INSTR_NAME(tgei),
+    INSTR_NAME(tgeiu),
+    INSTR_NAME(tgeu),
+    INSTR_NAME(tlbp),
+    INSTR_NAME(tlbr),
+    INSTR_NAME(tlbwi),
+    INSTR_NAME(tlbwr),
+    INSTR_NAME(tlt),
+    INSTR_NAME(tlti),
+    INSTR_NAME(tltiu),
+    INSTR_NAME(tltu),
+    INSTR_NAME(tne),
+    INSTR_NAME(tnei),
+    INSTR_NAME(xor),
+    INSTR_NAME(xori)
+};
 
-list_t r4k_instruction_cache = LIST_INITIALIZER;
+#undef INSTR_NAME
 
-static bool cache_hit(ptr36_t phys, cache_item_t **cache_item)
+static const char *stats_instr_name(instr_stats_fnc_t fnc)
 {
-    ptr36_t target_page = ALIGN_DOWN(phys, FRAME_SIZE);
-    cache_item_t *c;
-    for_each(r4k_instruction_cache, c, cache_item_t)
-    {
-        if (c->addr == target_page) {
-            *cache_item = c;
-            return true;
+    for (size_t i = 0; i < sizeof(instr_names) / sizeof(instr_names[0]); i++) {
+        if ((instr_stats_fnc_t) instr_names[i].fnc == fnc) {
+            return instr_names[i].name;
         }
     }
-    return false;
+
+    return "unknown";
+}
+
+static const instr_stats_arch_t stats_arch = {
+    .name = "r4k",
+    .instr_name = stats_instr_name
+};
+
+/** Execute an instruction of a page decoded with the statistics enabled
+ *
+ */
+static r4k_exc_t instr_counted(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
+{
+    const cache_item_t *cache_item = (const cache_item_t *) cpu->fetch_page.page;
+    instr_stats_t *stats = cache_item->header.stats[instr - cache_item->instrs];
+
+    r4k_exc_t exc = ((r4k_instr_fnc_t) stats->fnc)(cpu, instr);
+    instr_stats_count(stats, (exc != r4k_excNone) && (exc != r4k_excJump));
+
+    return exc;
 }
 
 static void cache_item_page_decode(r4k_cpu_t *cpu, cache_item_t *cache_item)
 {
+    instr_stats_t **stats = instr_cache_item_stats(&cache_item->header,
+            FRAME_SIZE / sizeof(r4k_instr_t));
+
     for (size_t i = 0; i < FRAME_SIZE / sizeof(r4k_instr_t); ++i) {
-        ptr36_t addr = cache_item->addr + (i * sizeof(r4k_instr_t));
+        ptr36_t addr = cache_item->header.addr + (i * sizeof(r4k_instr_t));
         r4k_instr_t instr_data = (r4k_instr_t) physmem_read32(cpu->procno, addr, false);
-        cache_item->instrs[i] = decode(instr_data);
+        predecode(&cache_item->instrs[i], instr_data);
+
+        if (stats != NULL) {
+            stats[i] = instr_stats_get(&stats_arch,
+                    (instr_stats_fnc_t) cache_item->instrs[i].fnc,
+                    access_size_map[instr_data.r.opcode]);
+            cache_item->instrs[i].fnc = instr_counted;
+        }
     }
 }
 
 static void update_cache_item(r4k_cpu_t *cpu, cache_item_t *cache_item)
 {
-    frame_t *frame = physmem_find_frame(cache_item->addr);
+    frame_t *frame = physmem_find_frame(cache_item->header.addr);
     ASSERT(frame != NULL);
 
-    if (frame->valid) {
+    if (frame_valid(frame)) {
         return;
     }
 
+    frame_validate(frame);
     cache_item_page_decode(cpu, cache_item);
 
-    frame->valid = true;
     return;
 }
 
@@ -2900,44 +3388,86 @@ static cache_item_t *cache_try_add(r4k_cpu_t *cpu, ptr36_t phys)
 
     cache_item_t *cache_item = safe_malloc(sizeof(cache_item_t));
 
-    cache_item_init(cache_item);
-    cache_item->addr = ALIGN_DOWN(phys, FRAME_SIZE);
-
-    list_push(&r4k_instruction_cache, &cache_item->item);
+    instr_cache_insert(&r4k_instruction_cache, &cache_item->header, phys);
 
+    frame_validate(frame);
     cache_item_page_decode(cpu, cache_item);
-
-    frame->valid = true;
     return cache_item;
 }
 
-static r4k_instr_fnc_t fetch_instr(r4k_cpu_t *cpu, ptr36_t phys)
+/** Remember the page of the current instruction fetch
+ *
+ * The page is reused by the following fetches until the PC leaves it
+ * or the translation context (Status, EntryHi, TLB) changes.
+ *
+ */
+static void remember_fetch_page(r4k_cpu_t *cpu, cache_item_t *cache_item)
 {
-    cache_item_t *cache_item = NULL;
-
-    if (cache_hit(phys, &cache_item)) {
-        ASSERT(cache_item != NULL);
-        update_cache_item(cpu, cache_item);
+    instr_fetch_page_set(&cpu->fetch_page, &cache_item->header, cpu->pc.ptr);
+    cpu->fetch_status = cp0_status(cpu).val;
+    cpu->fetch_entryhi = cp0_entryhi(cpu).val;
+    cpu->fetch_tlb_generation = cpu->tlb_generation;
+}
 
-        // Move item to front of list on hit
-        if (r4k_instruction_cache.head != &cache_item->item) {
-            list_remove(&r4k_instruction_cache, &cache_item->item);
-            list_push(&r4k_instruction_cache, &cache_item->item);
-        }
+/** Fetch the instruction on PC from the page of the previous fetch
+ *
+ * @return The instruction or NULL if the address translation
+ *         could not be skipped.
+ *
+ */
+static const r4k_decoded_instr_t *fetch_from_last_page(r4k_cpu_t *cpu)
+{
+    if (!instr_fetch_page_hit(&cpu->fetch_page, cpu->pc.ptr)) {
+        return NULL;
+    }
 
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    if ((cpu->fetch_status != cp0_status(cpu).val)
+            || (cpu->fetch_entryhi != cp0_entryhi(cpu).val)
+            || (cpu->fetch_tlb_generation != cpu->tlb_generation)) {
+        return NULL;
     }
 
-    cache_item = cache_try_add(cpu, phys);
+    cache_item_t *cache_item = (cache_item_t *) cpu->fetch_page.page;
+    return &cache_item->instrs[PHYS2CACHEINSTR(cpu->pc.ptr)];
+}
+
+static const r4k_decoded_instr_t *fetch_instr(r4k_cpu_t *cpu, ptr36_t phys)
+{
+    cache_item_t *cache_item = (cache_item_t *) instr_cache_find(&r4k_instruction_cache, phys);
+
+    if (cache_item != NULL) {
+        update_cache_item(cpu, cache_item);
+    } else {
+        cache_item = cache_try_add(cpu, phys);
+    }
 
     if (cache_item != NULL) {
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+        remember_fetch_page(cpu, cache_item);
+        return &cache_item->instrs[PHYS2CACHEINSTR(phys)];
     }
 
     alert("Trying to fetch instructions from outside of physical memory");
     return NULL;
 }
 
+/** Record the executed instruction in the binary trace
+ *
+ */
+static void trace_execute(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
+{
+    uint64_t regs[R4K_REG_COUNT + 2];
+
+    for (unsigned int i = 0; i < R4K_REG_COUNT; i++) {
+        regs[i] = cpu->regs[i].val;
+    }
+
+    regs[R4K_REG_COUNT] = cpu->loreg.val;
+    regs[R4K_REG_COUNT + 1] = cpu->hireg.val;
+
+    trace_instr(TRACE_ARCH_R4K, cpu->procno, cpu->pc.ptr, instr->raw.val,
+            regs, R4K_REG_COUNT + 2);
+}
+
 /** Change the processor state according to the exception type
  *
  */
@@ -3023,52 +3553,65 @@ static void handle_exception(r4k_cpu_t *cpu, r4k_exc_t res)
 }
 
 /** Execute one CPU instruction
+ *
+ * Always inlined into execute_plain and execute_instrumented,
+ * so that the plain variant contains no tracing hooks.
+ *
+ * @param instrumented Call the tracing hooks.
  *
  */
-static r4k_exc_t execute(r4k_cpu_t *cpu)
+static ALWAYS_INLINE r4k_exc_t execute(r4k_cpu_t *cpu, bool instrumented)
 {
     ASSERT(cpu != NULL);
 
     /* Instruction fetch */
 
-    ptr36_t phys;
-    r4k_exc_t res = r4k_convert_addr(cpu, cpu->pc, &phys, false, true);
+    const r4k_decoded_instr_t *instr = fetch_from_last_page(cpu);
 
-    switch (res) {
-    case r4k_excNone:
-        break;
-    case r4k_excAddrError:
-        if (cpu->branch == BRANCH_NONE) {
-            cpu->excaddr = cpu->pc;
-        }
-        return r4k_excAdEL;
-    case r4k_excTLB:
-        if (cpu->branch == BRANCH_NONE) {
-            cpu->excaddr = cpu->pc;
-        }
-        return r4k_excTLBL;
-    case r4k_excTLBR:
-        if (cpu->branch == BRANCH_NONE) {
-            cpu->excaddr = cpu->pc;
+    if (instr == NULL) {
+        ptr36_t phys;
+        r4k_exc_t res = convert_addr(cpu, cpu->pc, &phys, AM_FETCH, true);
+
+        switch (res) {
+        case r4k_excNone:
+            break;
+        case r4k_excAddrError:
+            if (cpu->branch == BRANCH_NONE) {
+                cpu->excaddr = cpu->pc;
+            }
+            return r4k_excAdEL;
+        case r4k_excTLB:
+            if (cpu->branch == BRANCH_NONE) {
+                cpu->excaddr = cpu->pc;
+            }
+            return r4k_excTLBL;
+        case r4k_excTLBR:
+            if (cpu->branch == BRANCH_NONE) {
+                cpu->excaddr = cpu->pc;
+            }
+            return r4k_excTLBLR;
+        default:
+            ASSERT(false);
         }
-        return r4k_excTLBLR;
-    default:
-        ASSERT(false);
-    }
 
-    r4k_instr_fnc_t fnc = fetch_instr(cpu, phys);
+        instr = fetch_instr(cpu, phys);
 
-    if (fnc == NULL) {
-        return r4k_excAdEL;
+        if (instr == NULL) {
+            return r4k_excAdEL;
+        }
     }
 
-    r4k_instr_t instr = (r4k_instr_t) physmem_read32(cpu->procno, phys, false);
-
     /* Execute instruction */
-    r4k_exc_t exc = fnc(cpu, instr);
+    r4k_exc_t exc = instr->fnc(cpu, instr);
 
-    if (machine_trace) {
-        r4k_idump(cpu, cpu->pc, instr, true);
+    if (instrumented) {
+        if (machine_trace) {
+            r4k_idump(cpu, cpu->pc, instr->raw, true);
+        }
+
+        if (trace_enabled) {
+            trace_execute(cpu, instr);
+        }
     }
 
     /* Branch test */
@@ -3100,6 +3643,22 @@ static r4k_exc_t execute(r4k_cpu_t *cpu)
     return exc;
 }
 
+/** Execute one CPU instruction without the tracing hooks
+ *
+ */
+static r4k_exc_t execute_plain(r4k_cpu_t *cpu)
+{
+    return execute(cpu, false);
+}
+
+/** Execute one CPU instruction with the tracing hooks
+ *
+ */
+static r4k_exc_t execute_instrumented(r4k_cpu_t *cpu)
+{
+    return execute(cpu, true);
+}
+
 /** CPU management
  *
  */
@@ -3107,8 +3666,8 @@ static void manage(r4k_cpu_t *cpu, r4k_exc_t exc, ptr64_t old_pc)
 {
     ASSERT(cpu != NULL);
 
-    /* Test for interrupt request */
-    if ((exc == r4k_excNone) && (!cp0_status_exl(cpu)) && (!cp0_status_erl(cpu)) && (cp0_status_ie(cpu)) && ((cp0_cause(cpu).val & cp0_status(cpu).val) & cp0_cause_ip_mask) != 0) {
+    /* Test for interrupt request (pending interrupts are rare, test them first) */
+    if ((((cp0_cause(cpu).val & cp0_status(cpu).val) & cp0_cause_ip_mask) != 0) && (exc == r4k_excNone) && (!cp0_status_exl(cpu)) && (!cp0_status_erl(cpu)) && (cp0_status_ie(cpu))) {
         exc = r4k_excInt;
     }
 
@@ -3176,7 +3735,11 @@ void r4k_step(r4k_cpu_t *cpu)
     ptr64_t old_pc = cpu->pc;
 
     if (!cpu->stdby) {
-        exc = execute(cpu);
+        if (machine_instrumented) {
+            exc = execute_instrumented(cpu);
+        } else {
+            exc = execute_plain(cpu);
+        }
     }
 
     /* Processor management */
@@ -3189,8 +3752,7 @@ void r4k_step(r4k_cpu_t *cpu)
 bool r4k_sc_access(r4k_cpu_t *cpu, ptr36_t addr, int size)
 {
     // MIPS R4K SC fails on write to whole cache line
-    // We allow only aligned accesses so this works
-    bool hit = cpu->lladdr == ALIGN_DOWN(addr, 64);
+    bool hit = AREAS_OVERLAP(ALIGN_DOWN(cpu->lladdr, 64), 64, addr, size);
     if (hit) {
         cpu->llbit = false;
     }
@@ -3200,9 +3762,5 @@ bool r4k_sc_access(r4k_cpu_t *cpu, ptr36_t addr, int size)
 void r4k_done(r4k_cpu_t *cpu)
 {
     // Clean whole cache
-    while (!is_empty(&r4k_instruction_cache)) {
-        cache_item_t *cache_item = (cache_item_t *) (r4k_instruction_cache.head);
-        list_remove(&r4k_instruction_cache, &cache_item->item);
-        safe_free(cache_item);
-    }
+    instr_cache_flush(&r4k_instruction_cache);
 }
@@ -21,11 +21,14 @@
 #include "../../../list.h"
 #include "../../../physmem.h"
 #include "../../../utils.h"
+#include "../instr_cache.h"
 
 #define R4K_REG_COUNT 32
 #define R4K_REG_VARIANTS 3
 
 #define TLB_ENTRIES 48
+#define TLB_HASH_SIZE 64
+#define TLB_MICRO_ENTRIES 16
 #define INTR_COUNT 8
 #define TLB_PHYSMASK UINT64_C(0x780000000)
 
@@ -495,6 +498,16 @@ typedef struct {
     tlb_rec_t pg[2]; /**< Subpages */
 } tlb_entry_t;
 
+/** Recently used translation of a 4 KB page */
+typedef struct {
+    bool valid; /**< The entry holds a translation */
+    bool dirty; /**< Writes are permitted */
+    uint8_t asid; /**< Address Space ID of the translation */
+    uint8_t index; /**< Index of the TLB entry */
+    uint32_t vpn; /**< Virtual page no (shifted >> 12) */
+    ptr36_t frame; /**< Physical address of the page */
+} tlb_micro_entry_t;
+
 typedef enum {
     BRANCH_NONE = 0,
     BRANCH_PASSED = 1,
@@ -574,8 +587,37 @@ static_assert(sizeof(r4k_instr_t) == 4, "wrong r4k_instr_t size!");
 struct frame;
 struct r4k_cpu;
 
+struct r4k_decoded_instr;
+
 /** Instruction implementation */
-typedef r4k_exc_t (*r4k_instr_fnc_t)(struct r4k_cpu *, r4k_instr_t);
+typedef r4k_exc_t (*r4k_instr_fnc_t)(struct r4k_cpu *,
+        const struct r4k_decoded_instr *);
+
+/** Pre-decoded instruction
+ *
+ * Filled when a code page is decoded, so that the instruction
+ * implementations do not need to extract the operand fields
+ * on every execution.
+ *
+ */
+typedef struct r4k_decoded_instr {
+    /** Instruction implementation */
+    r4k_instr_fnc_t fnc;
+
+    /** Sign-extended 16-bit immediate */
+    uint64_t imm;
+
+    /** Raw instruction */
+    r4k_instr_t raw;
+
+    /** Register fields */
+    uint8_t rs;
+    uint8_t rt;
+    uint8_t rd;
+
+    /** Shift amount */
+    uint8_t sa;
+} r4k_decoded_instr_t;
 
 /** Main processor structure */
 typedef struct r4k_cpu {
@@ -597,6 +639,23 @@ typedef struct r4k_cpu {
     /* TLB structures */
     tlb_entry_t tlb[TLB_ENTRIES];
     unsigned int tlb_hint;
+    unsigned int tlb_generation; /**< Changes on every TLB write */
+
+    /* TLB entries hashed by VPN2 for each distinct page mask */
+    uint32_t tlb_masks[TLB_ENTRIES];
+    unsigned int tlb_mask_count;
+    uint8_t tlb_hash[TLB_HASH_SIZE];
+    uint8_t tlb_hash_next[TLB_ENTRIES];
+
+    /* Micro-TLBs of instruction fetches and data accesses */
+    tlb_micro_entry_t tlb_micro_fetch[TLB_MICRO_ENTRIES];
+    tlb_micro_entry_t tlb_micro_data[TLB_MICRO_ENTRIES];
+
+    /* Page of the last instruction fetch and its translation context */
+    instr_fetch_page_t fetch_page;
+    uint64_t fetch_status;
+    uint64_t fetch_entryhi;
+    unsigned int fetch_tlb_generation;
 
     /* Old registers (for debug info) */
     reg64_t old_regs[R4K_REG_COUNT];
@@ -610,6 +669,7 @@ typedef struct r4k_cpu {
     /* LL and SC track support */
     bool llbit; /**< Track the address flag */
     ptr36_t lladdr; /**< Physical tracked address */
+    uint64_t llval; /**< Loaded value (compared by SC in parallel mode) */
 
     /* Watch support */
     ptr36_t waddr;
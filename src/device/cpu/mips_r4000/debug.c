@@ -311,14 +311,15 @@ static void idump_common(ptr64_t addr, r4k_instr_t instr, string_t *s_opc,
 
 /** Dump instruction mnemonics
  *
- * @param cpu     If not NULL, then the dump is processor-dependent
+ * @param has_cpu If true, then the dump is processor-dependent
  *                (with processor number).
+ * @param procno  Processor number.
  * @param addr    Virtual address of the instruction.
  * @param instr   Instruction to dump.
- * @param modregs If true, then modified registers are also dumped.
  *
  */
-void r4k_idump(r4k_cpu_t *cpu, ptr64_t addr, r4k_instr_t instr, bool modregs)
+static void idump(bool has_cpu, unsigned int procno, ptr64_t addr,
+        r4k_instr_t instr)
 {
     string_t s_cpu;
     string_t s_addr;
@@ -332,14 +333,14 @@ void r4k_idump(r4k_cpu_t *cpu, ptr64_t addr, r4k_instr_t instr, bool modregs)
     string_init(&s_mnemonics);
     string_init(&s_comments);
 
-    if (cpu != NULL) {
-        string_printf(&s_cpu, "cpu%u", cpu->procno);
+    if (has_cpu) {
+        string_printf(&s_cpu, "cpu%u", procno);
     }
 
     string_printf(&s_addr, "%#018" PRIx64, addr.ptr);
     idump_common(addr, instr, &s_opc, &s_mnemonics, &s_comments);
 
-    if (cpu != NULL) {
+    if (has_cpu) {
         printf("%-5s ", s_cpu.str);
     }
 
@@ -362,6 +363,31 @@ void r4k_idump(r4k_cpu_t *cpu, ptr64_t addr, r4k_instr_t instr, bool modregs)
     string_done(&s_comments);
 }
 
+/** Dump instruction mnemonics
+ *
+ * @param cpu     If not NULL, then the dump is processor-dependent
+ *                (with processor number).
+ * @param addr    Virtual address of the instruction.
+ * @param instr   Instruction to dump.
+ * @param modregs If true, then modified registers are also dumped.
+ *
+ */
+void r4k_idump(r4k_cpu_t *cpu, ptr64_t addr, r4k_instr_t instr, bool modregs)
+{
+    idump(cpu != NULL, (cpu != NULL) ? cpu->procno : 0, addr, instr);
+}
+
+/** Dump instruction mnemonics of a given processor
+ *
+ * Used when the processor itself is not available
+ * (e.g. when decoding a binary trace).
+ *
+ */
+void r4k_idump_procno(unsigned int procno, ptr64_t addr, r4k_instr_t instr)
+{
+    idump(true, procno, addr, instr);
+}
+
 /** Dump instruction mnemonics
  *
  * @param addr  Physical address of the instruction.
@@ -24,6 +24,7 @@ extern void r4k_cp0_dump(r4k_cpu_t *cpu, unsigned int reg);
 
 extern void r4k_idump_phys(ptr36_t addr, r4k_instr_t instr);
 extern void r4k_idump(r4k_cpu_t *cpu, ptr64_t addr, r4k_instr_t instr, bool modregs);
+extern void r4k_idump_procno(unsigned int procno, ptr64_t addr, r4k_instr_t instr);
 
 extern char *r4k_modified_regs_dump(r4k_cpu_t *cpu);
 
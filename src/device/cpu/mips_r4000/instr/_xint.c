@@ -1,8 +1,9 @@
-static r4k_exc_t instr__xint(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr__xint(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (input_is_terminal() || machine_allow_interactive_without_tty) {
         alert("XINT: Interactive mode");
         machine_interactive = true;
+        machine_instrumented = true;
     } else {
         alert("XINT: Machine halt when no tty available.");
         machine_halt = true;
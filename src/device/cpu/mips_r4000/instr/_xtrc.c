@@ -1,4 +1,4 @@
-static r4k_exc_t instr__xtrc(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr__xtrc(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (!machine_specific_instructions) {
         return instr__reserved(cpu, instr);
@@ -17,7 +17,13 @@ static r4k_exc_t instr__xtrc(r4k_cpu_t *cpu, r4k_instr_t instr)
     cpu->old_loreg = cpu->loreg;
     cpu->old_hireg = cpu->hireg;
 
+    /* The plain execution does not dump the instruction itself */
+    if (!machine_instrumented) {
+        r4k_idump(cpu, cpu->pc, instr->raw, true);
+    }
+
     machine_trace = true;
+    machine_instrumented = true;
 
     return r4k_excNone;
 }
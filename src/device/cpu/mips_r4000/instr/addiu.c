@@ -1,9 +1,9 @@
-static r4k_exc_t instr_addiu(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_addiu(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint32_t rs = cpu->regs[instr.i.rs].lo;
-    uint32_t imm = sign_extend_16_32(instr.i.imm);
+    uint32_t rs = cpu->regs[instr->rs].lo;
+    uint32_t imm = ((uint32_t) instr->imm);
 
-    cpu->regs[instr.i.rt].val = sign_extend_32_64(rs + imm);
+    cpu->regs[instr->rt].val = sign_extend_32_64(rs + imm);
     return r4k_excNone;
 }
 
@@ -1,9 +1,9 @@
-static r4k_exc_t instr_andi(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_andi(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint64_t rs = cpu->regs[instr.i.rs].val;
-    uint64_t imm = instr.i.imm;
+    uint64_t rs = cpu->regs[instr->rs].val;
+    uint64_t imm = (uint16_t) instr->imm;
 
-    cpu->regs[instr.i.rt].val = rs & imm;
+    cpu->regs[instr->rt].val = rs & imm;
     return r4k_excNone;
 }
 
@@ -1,8 +1,8 @@
-static r4k_exc_t instr_bc1t(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_bc1t(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (cp0_status_cu1(cpu)) {
         /* Ignore (always true) */
-        cpu->pc_next.ptr += (((int64_t) sign_extend_16_64(instr.i.imm)) << TARGET_SHIFT);
+        cpu->pc_next.ptr += (((int64_t) instr->imm) << TARGET_SHIFT);
         cpu->branch = BRANCH_COND;
         return r4k_excJump;
     }
@@ -1,15 +1,15 @@
-static r4k_exc_t instr_beql(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_beql(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     bool cond;
 
     if (CPU_64BIT_MODE(cpu)) {
-        cond = (cpu->regs[instr.i.rs].val == cpu->regs[instr.i.rt].val);
+        cond = (cpu->regs[instr->rs].val == cpu->regs[instr->rt].val);
     } else {
-        cond = (cpu->regs[instr.i.rs].lo == cpu->regs[instr.i.rt].lo);
+        cond = (cpu->regs[instr->rs].lo == cpu->regs[instr->rt].lo);
     }
 
     if (cond) {
-        cpu->pc_next.ptr += (((int64_t) sign_extend_16_64(instr.i.imm)) << TARGET_SHIFT);
+        cpu->pc_next.ptr += (((int64_t) instr->imm) << TARGET_SHIFT);
         cpu->branch = BRANCH_COND;
         return r4k_excJump;
     }
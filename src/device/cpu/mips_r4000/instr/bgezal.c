@@ -1,17 +1,17 @@
-static r4k_exc_t instr_bgezal(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_bgezal(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     bool cond;
 
     if (CPU_64BIT_MODE(cpu)) {
-        cond = ((cpu->regs[instr.i.rs].val & SBIT64) == 0);
+        cond = ((cpu->regs[instr->rs].val & SBIT64) == 0);
     } else {
-        cond = ((cpu->regs[instr.i.rs].lo & SBIT32) == 0);
+        cond = ((cpu->regs[instr->rs].lo & SBIT32) == 0);
     }
 
     cpu->regs[31].val = cpu->pc.ptr + 8;
 
     if (cond) {
-        cpu->pc_next.ptr += (((int64_t) sign_extend_16_64(instr.i.imm)) << TARGET_SHIFT);
+        cpu->pc_next.ptr += (((int64_t) instr->imm) << TARGET_SHIFT);
         cpu->branch = BRANCH_COND;
         return r4k_excJump;
     }
@@ -1,15 +1,15 @@
-static r4k_exc_t instr_bgtzl(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_bgtzl(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     bool cond;
 
     if (CPU_64BIT_MODE(cpu)) {
-        cond = (((int64_t) cpu->regs[instr.i.rs].val) > 0);
+        cond = (((int64_t) cpu->regs[instr->rs].val) > 0);
     } else {
-        cond = (((int32_t) cpu->regs[instr.i.rs].lo) > 0);
+        cond = (((int32_t) cpu->regs[instr->rs].lo) > 0);
     }
 
     if (cond) {
-        cpu->pc_next.ptr += (((int64_t) sign_extend_16_64(instr.i.imm)) << TARGET_SHIFT);
+        cpu->pc_next.ptr += (((int64_t) instr->imm) << TARGET_SHIFT);
         cpu->branch = BRANCH_COND;
         return r4k_excJump;
     }
@@ -1,4 +1,4 @@
-static r4k_exc_t instr_cache(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_cache(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     ASSERT(false);
     return r4k_excNone;
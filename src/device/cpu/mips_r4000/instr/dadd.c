@@ -1,15 +1,15 @@
-static r4k_exc_t instr_dadd(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_dadd(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
-        uint64_t rs = cpu->regs[instr.r.rs].val;
-        uint64_t rt = cpu->regs[instr.r.rt].val;
+        uint64_t rs = cpu->regs[instr->rs].val;
+        uint64_t rt = cpu->regs[instr->rt].val;
         uint64_t sum = rs + rt;
 
         if (!((rs ^ rt) & SBIT64) && ((rs ^ sum) & SBIT64)) {
             return r4k_excOv;
         }
 
-        cpu->regs[instr.r.rd].val = sum;
+        cpu->regs[instr->rd].val = sum;
     } else {
         return r4k_excRI;
     }
@@ -1,15 +1,15 @@
-static r4k_exc_t instr_daddi(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_daddi(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
-        uint64_t rs = cpu->regs[instr.i.rs].val;
-        uint64_t imm = sign_extend_16_64(instr.i.imm);
+        uint64_t rs = cpu->regs[instr->rs].val;
+        uint64_t imm = instr->imm;
         uint64_t sum = rs + imm;
 
         if (!((rs ^ imm) & SBIT64) && ((rs ^ sum) & SBIT64)) {
             return r4k_excOv;
         }
 
-        cpu->regs[instr.i.rt].val = sum;
+        cpu->regs[instr->rt].val = sum;
     } else {
         return r4k_excRI;
     }
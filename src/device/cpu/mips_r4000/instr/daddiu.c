@@ -1,10 +1,10 @@
-static r4k_exc_t instr_daddiu(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_daddiu(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
-        uint64_t rs = cpu->regs[instr.i.rs].val;
-        uint64_t imm = sign_extend_16_64(instr.i.imm);
+        uint64_t rs = cpu->regs[instr->rs].val;
+        uint64_t imm = instr->imm;
 
-        cpu->regs[instr.i.rt].val = rs + imm;
+        cpu->regs[instr->rt].val = rs + imm;
     } else {
         return r4k_excRI;
     }
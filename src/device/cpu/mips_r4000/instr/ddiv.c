@@ -1,13 +1,13 @@
-static r4k_exc_t instr_ddiv(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_ddiv(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
-        uint64_t rt = cpu->regs[instr.r.rt].val;
+        uint64_t rt = cpu->regs[instr->rt].val;
 
         if (rt == 0) {
             cpu->loreg.val = 0;
             cpu->hireg.val = 0;
         } else {
-            uint64_t rs = cpu->regs[instr.r.rs].val;
+            uint64_t rs = cpu->regs[instr->rs].val;
 
             cpu->loreg.val = (uint64_t) (((int64_t) rs) / ((int64_t) rt));
             cpu->hireg.val = (uint64_t) (((int64_t) rs) % ((int64_t) rt));
@@ -1,12 +1,12 @@
-static r4k_exc_t instr_div(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_div(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint32_t rt = cpu->regs[instr.r.rt].lo;
+    uint32_t rt = cpu->regs[instr->rt].lo;
 
     if (rt == 0) {
         cpu->loreg.val = 0;
         cpu->hireg.val = 0;
     } else {
-        uint32_t rs = cpu->regs[instr.r.rs].lo;
+        uint32_t rs = cpu->regs[instr->rs].lo;
 
         cpu->loreg.val = sign_extend_32_64((uint32_t) (((int32_t) rs) / ((int32_t) rt)));
         cpu->hireg.val = sign_extend_32_64((uint32_t) (((int32_t) rs) % ((int32_t) rt)));
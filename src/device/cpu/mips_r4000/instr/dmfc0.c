@@ -1,8 +1,8 @@
-static r4k_exc_t instr_dmfc0(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_dmfc0(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
         if (CP0_USABLE(cpu)) {
-            cpu->regs[instr.r.rt].val = cpu->cp0[instr.r.rd].val;
+            cpu->regs[instr->rt].val = cpu->cp0[instr->rd].val;
             return r4k_excNone;
         }
 
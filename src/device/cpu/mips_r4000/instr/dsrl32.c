@@ -1,8 +1,8 @@
-static r4k_exc_t instr_dsrl32(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_dsrl32(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
-        uint64_t rt = cpu->regs[instr.r.rt].val;
-        cpu->regs[instr.r.rd].val = rt >> (instr.r.sa + 32);
+        uint64_t rt = cpu->regs[instr->rt].val;
+        cpu->regs[instr->rd].val = rt >> (instr->sa + 32);
     } else {
         return r4k_excRI;
     }
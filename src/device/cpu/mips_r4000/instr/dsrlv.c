@@ -1,10 +1,10 @@
-static r4k_exc_t instr_dsrlv(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_dsrlv(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
-        uint64_t rs = cpu->regs[instr.r.rs].val;
-        uint64_t rt = cpu->regs[instr.r.rt].val;
+        uint64_t rs = cpu->regs[instr->rs].val;
+        uint64_t rt = cpu->regs[instr->rt].val;
 
-        cpu->regs[instr.r.rd].val = rt >> (rs & UINT64_C(0x003f));
+        cpu->regs[instr->rd].val = rt >> (rs & UINT64_C(0x003f));
     } else {
         return r4k_excRI;
     }
@@ -1,6 +1,6 @@
-static r4k_exc_t instr_j(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_j(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    cpu->pc_next.ptr = (cpu->pc_next.ptr & TARGET_COMB) | (instr.j.target << TARGET_SHIFT);
+    cpu->pc_next.ptr = (cpu->pc_next.ptr & TARGET_COMB) | (instr->raw.j.target << TARGET_SHIFT);
     cpu->branch = BRANCH_COND;
     return r4k_excJump;
 }
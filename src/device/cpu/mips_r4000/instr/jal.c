@@ -1,7 +1,7 @@
-static r4k_exc_t instr_jal(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_jal(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     cpu->regs[31].val = cpu->pc.ptr + 8;
-    cpu->pc_next.ptr = (cpu->pc_next.ptr & TARGET_COMB) | (instr.j.target << TARGET_SHIFT);
+    cpu->pc_next.ptr = (cpu->pc_next.ptr & TARGET_COMB) | (instr->raw.j.target << TARGET_SHIFT);
     cpu->branch = BRANCH_COND;
     return r4k_excJump;
 }
@@ -1,6 +1,6 @@
-static r4k_exc_t instr_jr(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_jr(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    cpu->pc_next.ptr = cpu->regs[instr.r.rs].val;
+    cpu->pc_next.ptr = cpu->regs[instr->rs].val;
     cpu->branch = BRANCH_COND;
     return r4k_excJump;
 }
@@ -1,13 +1,13 @@
-static r4k_exc_t instr_ld(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_ld(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
         ptr64_t addr;
-        addr.ptr = cpu->regs[instr.i.rs].val + sign_extend_16_64(instr.i.imm);
+        addr.ptr = cpu->regs[instr->rs].val + instr->imm;
 
         uint64_t val;
         r4k_exc_t res = cpu_read_mem64(cpu, addr, &val, true);
         if (res == r4k_excNone) {
-            cpu->regs[instr.i.rt].val = val;
+            cpu->regs[instr->rt].val = val;
         }
 
         return res;
@@ -1,6 +1,6 @@
-static r4k_exc_t instr_lui(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_lui(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    cpu->regs[instr.i.rt].val = sign_extend_32_64(((uint32_t) instr.i.imm) << 16);
+    cpu->regs[instr->rt].val = sign_extend_32_64(((uint32_t) instr->imm) << 16);
 
     return r4k_excNone;
 }
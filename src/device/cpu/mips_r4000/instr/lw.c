@@ -1,12 +1,12 @@
-static r4k_exc_t instr_lw(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_lw(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     ptr64_t addr;
-    addr.ptr = cpu->regs[instr.i.rs].val + sign_extend_16_64(instr.i.imm);
+    addr.ptr = cpu->regs[instr->rs].val + instr->imm;
 
     uint32_t val;
     r4k_exc_t res = r4k_read_mem32(cpu, addr, &val, true);
     if (res == r4k_excNone) {
-        cpu->regs[instr.i.rt].val = sign_extend_32_64(val);
+        cpu->regs[instr->rt].val = sign_extend_32_64(val);
     }
 
     return res;
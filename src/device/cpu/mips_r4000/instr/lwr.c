@@ -1,7 +1,7 @@
-static r4k_exc_t instr_lwr(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_lwr(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     ptr64_t base;
-    base.ptr = cpu->regs[instr.i.rs].val + sign_extend_16_64(instr.i.imm);
+    base.ptr = cpu->regs[instr->rs].val + instr->imm;
 
     ptr64_t addr;
     addr.ptr = base.ptr & ((uint64_t) ~UINT64_C(0x03));
@@ -11,14 +11,14 @@ static r4k_exc_t instr_lwr(r4k_cpu_t *cpu, r4k_instr_t instr)
 
     if (res == r4k_excNone) {
         unsigned int index = base.ptr & 0x03U;
-        uint32_t comb = cpu->regs[instr.i.rt].lo & shift_tab_right[index].mask;
+        uint32_t comb = cpu->regs[instr->rt].lo & shift_tab_right[index].mask;
         comb |= (val >> shift_tab_right[index].shift)
                 & (~shift_tab_right[index].mask);
 
         if (index == 0) {
-            cpu->regs[instr.i.rt].val = sign_extend_32_64(comb);
+            cpu->regs[instr->rt].val = sign_extend_32_64(comb);
         } else {
-            cpu->regs[instr.i.rt].val = comb;
+            cpu->regs[instr->rt].val = comb;
         }
     }
 
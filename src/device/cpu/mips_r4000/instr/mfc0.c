@@ -1,7 +1,7 @@
-static r4k_exc_t instr_mfc0(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_mfc0(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CP0_USABLE(cpu)) {
-        cpu->regs[instr.r.rt].val = sign_extend_32_64(cpu->cp0[instr.r.rd].lo);
+        cpu->regs[instr->rt].val = sign_extend_32_64(cpu->cp0[instr->rd].lo);
         return r4k_excNone;
     }
 
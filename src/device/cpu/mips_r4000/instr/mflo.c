@@ -1,6 +1,6 @@
-static r4k_exc_t instr_mflo(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_mflo(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    cpu->regs[instr.r.rd].val = cpu->loreg.val;
+    cpu->regs[instr->rd].val = cpu->loreg.val;
     return r4k_excNone;
 }
 
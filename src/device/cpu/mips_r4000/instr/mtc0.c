@@ -1,9 +1,9 @@
-static r4k_exc_t instr_mtc0(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_mtc0(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CP0_USABLE(cpu)) {
-        reg64_t reg = cpu->regs[instr.r.rt];
+        reg64_t reg = cpu->regs[instr->rt];
 
-        switch (instr.r.rd) {
+        switch (instr->rd) {
         /* 0 */
         case cp0_Index:
             cp0_index(cpu).val = reg.val & UINT32_C(0x003f);
@@ -1,6 +1,6 @@
-static r4k_exc_t instr_mtlo(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_mtlo(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    cpu->loreg.val = cpu->regs[instr.r.rs].val;
+    cpu->loreg.val = cpu->regs[instr->rs].val;
     return r4k_excNone;
 }
 
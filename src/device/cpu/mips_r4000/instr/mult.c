@@ -1,7 +1,7 @@
-static r4k_exc_t instr_mult(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_mult(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint32_t rs = cpu->regs[instr.r.rs].lo;
-    uint32_t rt = cpu->regs[instr.r.rt].lo;
+    uint32_t rs = cpu->regs[instr->rs].lo;
+    uint32_t rt = cpu->regs[instr->rt].lo;
 
     /* Quick test */
     if ((rs == 0) || (rt == 0)) {
@@ -1,9 +1,9 @@
-static r4k_exc_t instr_nor(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_nor(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint64_t rs = cpu->regs[instr.r.rs].val;
-    uint64_t rt = cpu->regs[instr.r.rt].val;
+    uint64_t rs = cpu->regs[instr->rs].val;
+    uint64_t rt = cpu->regs[instr->rt].val;
 
-    cpu->regs[instr.r.rd].val = ~(rs | rt);
+    cpu->regs[instr->rd].val = ~(rs | rt);
     return r4k_excNone;
 }
 
@@ -1,10 +1,10 @@
-static r4k_exc_t instr_scd(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_scd(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_INSTRUCTION(cpu)) {
         if (!cpu->llbit) {
             /* If we are not tracking LLD-SCD,
                then SC has to fail */
-            cpu->regs[instr.i.rt].val = 0;
+            cpu->regs[instr->rt].val = 0;
             return r4k_excNone;
         }
 
@@ -12,14 +12,20 @@ static r4k_exc_t instr_scd(r4k_cpu_t *cpu, r4k_instr_t instr)
 
         /* Compute target address */
         ptr64_t addr;
-        addr.ptr = cpu->regs[instr.i.rs].val + sign_extend_16_64(instr.i.imm);
-
-        /* Perform the write operation */
-        r4k_exc_t res = cpu_write_mem64(cpu, addr, cpu->regs[instr.i.rt].val, true);
-        if (res == r4k_excNone) {
+        addr.ptr = cpu->regs[instr->rs].val + instr->imm;
+
+        /* Perform the write operation (in parallel mode only
+           if the memory still holds the loaded value) */
+        bool written;
+        r4k_exc_t res = cpu_cas_mem64(cpu, addr, cpu->llval,
+                cpu->regs[instr->rt].val, &written);
+        if ((res == r4k_excNone) && (!written)) {
+            /* Another processor has changed the memory */
+            cpu->regs[instr->rt].val = 0;
+        } else if (res == r4k_excNone) {
             /* The operation has been successful,
                write the result, but ... */
-            cpu->regs[instr.i.rt].val = 1;
+            cpu->regs[instr->rt].val = 1;
 
             /* ... we are too polite if LLD and SCD addresses differ.
                In such a case, the behaviour of SCD is undefined.
@@ -1,8 +1,8 @@
-static r4k_exc_t instr_sll(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_sll(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint32_t rt = cpu->regs[instr.r.rt].lo;
+    uint32_t rt = cpu->regs[instr->rt].lo;
 
-    cpu->regs[instr.r.rd].val = sign_extend_32_64(rt << instr.r.sa);
+    cpu->regs[instr->rd].val = sign_extend_32_64(rt << instr->sa);
 
     return r4k_excNone;
 }
@@ -1,15 +1,15 @@
-static r4k_exc_t instr_slt(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_slt(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_MODE(cpu)) {
-        uint64_t rs = cpu->regs[instr.r.rs].val;
-        uint64_t rt = cpu->regs[instr.r.rt].val;
+        uint64_t rs = cpu->regs[instr->rs].val;
+        uint64_t rt = cpu->regs[instr->rt].val;
 
-        cpu->regs[instr.r.rd].val = ((int64_t) rs) < ((int64_t) rt);
+        cpu->regs[instr->rd].val = ((int64_t) rs) < ((int64_t) rt);
     } else {
-        uint32_t rs = cpu->regs[instr.r.rs].lo;
-        uint32_t rt = cpu->regs[instr.r.rt].lo;
+        uint32_t rs = cpu->regs[instr->rs].lo;
+        uint32_t rt = cpu->regs[instr->rt].lo;
 
-        cpu->regs[instr.r.rd].val = ((int32_t) rs) < ((int32_t) rt);
+        cpu->regs[instr->rd].val = ((int32_t) rs) < ((int32_t) rt);
     }
 
     return r4k_excNone;
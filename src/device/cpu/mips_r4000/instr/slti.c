@@ -1,15 +1,15 @@
-static r4k_exc_t instr_slti(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_slti(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     if (CPU_64BIT_MODE(cpu)) {
-        uint64_t rs = cpu->regs[instr.i.rs].val;
-        uint64_t imm = sign_extend_16_64(instr.i.imm);
+        uint64_t rs = cpu->regs[instr->rs].val;
+        uint64_t imm = instr->imm;
 
-        cpu->regs[instr.i.rt].val = ((int64_t) rs) < ((int64_t) imm);
+        cpu->regs[instr->rt].val = ((int64_t) rs) < ((int64_t) imm);
     } else {
-        uint32_t rs = cpu->regs[instr.i.rs].lo;
-        uint32_t imm = sign_extend_16_32(instr.i.imm);
+        uint32_t rs = cpu->regs[instr->rs].lo;
+        uint32_t imm = ((uint32_t) instr->imm);
 
-        cpu->regs[instr.i.rt].val = ((int32_t) rs) < ((int32_t) imm);
+        cpu->regs[instr->rt].val = ((int32_t) rs) < ((int32_t) imm);
     }
 
     return r4k_excNone;
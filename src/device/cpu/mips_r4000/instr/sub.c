@@ -1,14 +1,14 @@
-static r4k_exc_t instr_sub(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_sub(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint32_t rs = cpu->regs[instr.r.rs].lo;
-    uint32_t rt = cpu->regs[instr.r.rt].lo;
+    uint32_t rs = cpu->regs[instr->rs].lo;
+    uint32_t rt = cpu->regs[instr->rt].lo;
     uint32_t dif = rs - rt;
 
     if (!((rs ^ rt) & SBIT32) && ((rs ^ dif) & SBIT32)) {
         return r4k_excOv;
     }
 
-    cpu->regs[instr.r.rd].val = sign_extend_32_64(dif);
+    cpu->regs[instr->rd].val = sign_extend_32_64(dif);
 
     return r4k_excNone;
 }
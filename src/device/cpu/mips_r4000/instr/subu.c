@@ -1,9 +1,9 @@
-static r4k_exc_t instr_subu(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_subu(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
-    uint32_t rs = cpu->regs[instr.r.rs].lo;
-    uint32_t rt = cpu->regs[instr.r.rt].lo;
+    uint32_t rs = cpu->regs[instr->rs].lo;
+    uint32_t rt = cpu->regs[instr->rt].lo;
 
-    cpu->regs[instr.r.rd].val = sign_extend_32_64(rs - rt);
+    cpu->regs[instr->rd].val = sign_extend_32_64(rs - rt);
 
     return r4k_excNone;
 }
@@ -1,9 +1,9 @@
-static r4k_exc_t instr_sw(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_sw(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     ptr64_t addr;
-    addr.ptr = cpu->regs[instr.i.rs].val + sign_extend_16_64(instr.i.imm);
+    addr.ptr = cpu->regs[instr->rs].val + instr->imm;
 
-    return cpu_write_mem32(cpu, addr, cpu->regs[instr.i.rt].lo,
+    return cpu_write_mem32(cpu, addr, cpu->regs[instr->rt].lo,
             true);
 }
 
@@ -1,7 +1,7 @@
-static r4k_exc_t instr_swl(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_swl(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     ptr64_t base;
-    base.ptr = cpu->regs[instr.i.rs].val + sign_extend_16_64(instr.i.imm);
+    base.ptr = cpu->regs[instr->rs].val + instr->imm;
 
     ptr64_t addr;
     addr.ptr = base.ptr & ((uint64_t) ~UINT64_C(0x03));
@@ -12,7 +12,7 @@ static r4k_exc_t instr_swl(r4k_cpu_t *cpu, r4k_instr_t instr)
     if (res == r4k_excNone) {
         unsigned int index = base.ptr & 0x03U;
         val &= shift_tab_left_store[index].mask;
-        val |= (cpu->regs[instr.i.rt].lo >> shift_tab_left_store[index].shift)
+        val |= (cpu->regs[instr->rt].lo >> shift_tab_left_store[index].shift)
                 & (~shift_tab_left_store[index].mask);
 
         res = cpu_write_mem32(cpu, addr, val, true);
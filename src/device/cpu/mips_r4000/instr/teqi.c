@@ -1,11 +1,11 @@
-static r4k_exc_t instr_teqi(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_teqi(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     bool cond;
 
     if (CPU_64BIT_MODE(cpu)) {
-        cond = (cpu->regs[instr.i.rs].val == sign_extend_16_64(instr.i.imm));
+        cond = (cpu->regs[instr->rs].val == instr->imm);
     } else {
-        cond = (cpu->regs[instr.i.rs].lo == sign_extend_16_32(instr.i.imm));
+        cond = (cpu->regs[instr->rs].lo == ((uint32_t) instr->imm));
     }
 
     if (cond) {
@@ -1,11 +1,11 @@
-static r4k_exc_t instr_tgei(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_tgei(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     bool cond;
 
     if (CPU_64BIT_MODE(cpu)) {
-        cond = (((int64_t) cpu->regs[instr.i.rs].val) >= ((int64_t) sign_extend_16_64(instr.i.imm)));
+        cond = (((int64_t) cpu->regs[instr->rs].val) >= ((int64_t) instr->imm));
     } else {
-        cond = (((int32_t) cpu->regs[instr.i.rs].lo) >= ((int32_t) sign_extend_16_32(instr.i.imm)));
+        cond = (((int32_t) cpu->regs[instr->rs].lo) >= ((int32_t) ((uint32_t) instr->imm)));
     }
 
     if (cond) {
@@ -1,11 +1,11 @@
-static r4k_exc_t instr_tlt(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_tlt(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     bool cond;
 
     if (CPU_64BIT_MODE(cpu)) {
-        cond = (((int64_t) cpu->regs[instr.r.rs].val) < ((int64_t) cpu->regs[instr.r.rt].val));
+        cond = (((int64_t) cpu->regs[instr->rs].val) < ((int64_t) cpu->regs[instr->rt].val));
     } else {
-        cond = (((int32_t) cpu->regs[instr.r.rs].lo) < ((int32_t) cpu->regs[instr.r.rt].lo));
+        cond = (((int32_t) cpu->regs[instr->rs].lo) < ((int32_t) cpu->regs[instr->rt].lo));
     }
 
     if (cond) {
@@ -1,11 +1,11 @@
-static r4k_exc_t instr_tne(r4k_cpu_t *cpu, r4k_instr_t instr)
+static r4k_exc_t instr_tne(r4k_cpu_t *cpu, const r4k_decoded_instr_t *instr)
 {
     bool cond;
 
     if (CPU_64BIT_MODE(cpu)) {
-        cond = (cpu->regs[instr.r.rs].val != cpu->regs[instr.r.rt].val);
+        cond = (cpu->regs[instr->rs].val != cpu->regs[instr->rt].val);
     } else {
-        cond = (cpu->regs[instr.r.rs].lo != cpu->regs[instr.r.rt].lo);
+        cond = (cpu->regs[instr->rs].lo != cpu->regs[instr->rt].lo);
     }
 
     if (cond) {
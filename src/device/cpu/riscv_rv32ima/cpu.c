@@ -15,12 +15,18 @@
 #include <string.h>
 
 #include "../../../assert.h"
+#include "../../../debug/breakpoint.h"
 #include "../../../list.h"
 #include "../../../main.h"
 #include "../../../physmem.h"
+#include "../../../trace.h"
 #include "../../../utils.h"
+#include "../../event.h"
+#include "../instr_cache.h"
+#include "../instr_stats.h"
 #include "cpu.h"
 #include "csr.h"
+#include "mnemonics.h"
 #include "tlb.h"
 #include "virt_mem.h"
 
@@ -31,44 +37,18 @@
 /// Caching of decoded instructions
 
 /**
- * @brief Item of a list of pages of cached instructions
+ * @brief Cached page of decoded instructions
  */
 typedef struct {
-    item_t item; // The list item
-    ptr36_t addr; // The base address of the page
+    instr_cache_item_t header; // The cache bookkeeping, has to be first
     rv_instr_func_t instrs[FRAME_SIZE / sizeof(rv_instr_t)]; // Decoded instructions (represented as function pointers)
+    rv_instr_t data[FRAME_SIZE / sizeof(rv_instr_t)]; // Raw instructions
+    uint16_t block_len[FRAME_SIZE / sizeof(rv_instr_t)]; // Instructions till the end of the block (within the page)
 } cache_item_t;
 
 #define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(rv_instr_t))
 
-static void cache_item_init(cache_item_t *cache_item)
-{
-    item_init(&cache_item->item);
-    cache_item->addr = 0;
-    // Skip instrs init
-}
-
-list_t rv_instruction_cache = LIST_INITIALIZER;
-
-/**
- * @brief Looks into cache for the instruction on the given physical address
- * @par phys The physical address to check
- * @par cache_item A pointer to a found cache_item_t will be stored here on success
- * @returns Whether the address is in the cache
- */
-static bool cache_hit(ptr36_t phys, cache_item_t **cache_item)
-{
-    ptr36_t target_page = ALIGN_DOWN(phys, FRAME_SIZE);
-    cache_item_t *c;
-    for_each(rv_instruction_cache, c, cache_item_t)
-    {
-        if (c->addr == target_page) {
-            *cache_item = c;
-            return true;
-        }
-    }
-    return false;
-}
+_Thread_local instr_cache_t rv_instruction_cache = INSTR_CACHE_INITIALIZER;
 
 static void init_regs(rv32_cpu_t *cpu)
 {
@@ -95,6 +75,7 @@ void rv32_cpu_init(rv32_cpu_t *cpu, unsigned int procno)
     rv32_init_csr(&cpu->csr, procno);
 
     rv32_tlb_init(&cpu->tlb, DEFAULT_RV_TLB_SIZE);
+    rv_data_tlb_clear(&cpu->data_tlb);
 
     cpu->priv_mode = rv_mmode;
 
@@ -110,11 +91,7 @@ void rv32_cpu_init(rv32_cpu_t *cpu, unsigned int procno)
 void rv32_cpu_done(rv32_cpu_t *cpu)
 {
     // Clean whole cache for simplicity whenever any cpu is done
-    while (!is_empty(&rv_instruction_cache)) {
-        cache_item_t *cache_item = (cache_item_t *) (rv_instruction_cache.head);
-        list_remove(&rv_instruction_cache, &cache_item->item);
-        safe_free(cache_item);
-    }
+    instr_cache_flush(&rv_instruction_cache);
 
     rv32_tlb_done(&cpu->tlb);
 }
@@ -287,6 +264,9 @@ static rv_exc_t rv_convert_addr(rv_cpu_t *cpu, uint32_t virt, ptr36_t *phys, boo
     ASSERT(phys != NULL);
     ASSERT(!(wr && fetch));
 
+    // No TLB entry is used unless the translation finds one
+    cpu->tlb.last_entry = NULL;
+
     bool use_sv32 = (sv32_effective_priv(cpu) <= rv_smode) && (!rv_csr_satp_is_bare(cpu)) && !(cpu->priv_mode == rv_mmode && fetch);
 
     if (!use_sv32) {
@@ -340,15 +320,164 @@ rv_exc_t rv32_convert_addr(rv32_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr,
 /** Then instruction implementations */
 #include "instr.c"
 
+/**
+ * @brief Bytes of memory accessed by the instruction
+ */
+static unsigned int access_size(rv_instr_t instr)
+{
+    switch (instr.r.opcode) {
+    case rv_opcLOAD:
+    case rv_opcSTORE:
+        return 1 << (instr.r.funct3 & 0x3);
+    case rv_opcAMO:
+        return (instr.r.funct3 == RV_AMO_64_WLEN) ? 8 : 4;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Canonical mnemonics of the instruction implementations
+ */
+static const struct {
+    rv_instr_func_t fnc;
+    const char *name;
+} instr_names[] = {
+    { rv_add_instr, "add" },
+    { rv_addi_instr, "addi" },
+    { rv_amoadd_w_instr, "amoadd.w" },
+    { rv_amoand_w_instr, "amoand.w" },
+    { rv_amomax_w_instr, "amomax.w" },
+    { rv_amomaxu_w_instr, "amomaxu.w" },
+    { rv_amomin_w_instr, "amomin.w" },
+    { rv_amominu_w_instr, "amominu.w" },
+    { rv_amoor_w_instr, "amoor.w" },
+    { rv_amoswap_w_instr, "amoswap.w" },
+    { rv_amoxor_w_instr, "amoxor.w" },
+    { rv_and_instr, "and" },
+    { rv_andi_instr, "andi" },
+    { rv_auipc_instr, "auipc" },
+    { rv_beq_instr, "beq" },
+    { rv_bge_instr, "bge" },
+    { rv_bgeu_instr, "bgeu" },
+    { rv_blt_instr, "blt" },
+    { rv_bltu_instr, "bltu" },
+    { rv_bne_instr, "bne" },
+    { rv_csrrc_instr, "csrrc" },
+    { rv_csrrci_instr, "csrrci" },
+    { rv_csrrs_instr, "csrrs" },
+    { rv_csrrsi_instr, "csrrsi" },
+    { rv_csrrw_instr, "csrrw" },
+    { rv_csrrwi_instr, "csrrwi" },
+    { rv_div_instr, "div" },
+    { rv_divu_instr, "divu" },
+    { rv_break_instr, "ebreak" },
+    { rv_call_instr, "ecall" },
+    { _rv32_csr_rd_instr, "ecsrd" },
+    { rv32_dump_instr, "edump" },
+    { rv_halt_instr, "ehalt" },
+    { rv_trace_reset_instr, "etracer" },
+    { rv_trace_set_instr, "etraces" },
+    { rv_fence_instr, "fence" },
+    { rv_illegal_instr, "illegal" },
+    { rv_jal_instr, "jal" },
+    { rv_jalr_instr, "jalr" },
+    { rv_lb_instr, "lb" },
+    { rv_lbu_instr, "lbu" },
+    { rv_lh_instr, "lh" },
+    { rv_lhu_instr, "lhu" },
+    { rv_lr_w_instr, "lr.w" },
+    { rv_lui_instr, "lui" },
+    { rv_lw_instr, "lw" },
+    { rv_mret_instr, "mret" },
+    { rv_mul_instr, "mul" },
+    { rv_mulh_instr, "mulh" },
+    { rv_mulhsu_instr, "mulhsu" },
+    { rv_mulhu_instr, "mulhu" },
+    { rv_or_instr, "or" },
+    { rv_ori_instr, "ori" },
+    { rv_rem_instr, "rem" },
+    { rv_remu_instr, "remu" },
+    { rv_sb_instr, "sb" },
+    { rv_sc_w_instr, "sc.w" },
+    { _rv32_sfence_instr, "sfence.vma" },
+    { rv_sh_instr, "sh" },
+    { rv_sll_instr, "sll" },
+    { rv_slli_instr, "slli" },
+    { rv_slt_instr, "slt" },
+    { rv_slti_instr, "slti" },
+    { rv_sltiu_instr, "sltiu" },
+    { rv_sltu_instr, "sltu" },
+    { rv_sra_instr, "sra" },
+    { rv_srai_instr, "srai" },
+    { rv_sret_instr, "sret" },
+    { rv_srl_instr, "srl" },
+    { rv_srli_instr, "srli" },
+    { rv_sub_instr, "sub" },
+    { rv_sw_instr, "sw" },
+    { rv_wfi_instr, "wfi" },
+    { rv_xor_instr, "xor" },
+    { rv_xori_instr, "xori" }
+};
+
+static const char *stats_instr_name(instr_stats_fnc_t fnc)
+{
+    for (size_t i = 0; i < sizeof(instr_names) / sizeof(instr_names[0]); i++) {
+        if ((instr_stats_fnc_t) instr_names[i].fnc == fnc) {
+            return instr_names[i].name;
+        }
+    }
+
+    return "unknown";
+}
+
+static const instr_stats_arch_t stats_arch = {
+    .name = "rv32",
+    .instr_name = stats_instr_name
+};
+
+/**
+ * @brief Executes an instruction of a page decoded with the statistics enabled
+ */
+static rv_exc_t instr_counted(rv_cpu_t *cpu, rv_instr_t instr)
+{
+    const cache_item_t *cache_item = (const cache_item_t *) cpu->fetch_page.page;
+    instr_stats_t *stats = cache_item->header.stats[PHYS2CACHEINSTR(cpu->pc)];
+
+    rv_exc_t ex = ((rv_instr_func_t) stats->fnc)(cpu, instr);
+    instr_stats_count(stats, ex != rv_exc_none);
+
+    return ex;
+}
+
 /**
  * @brief Fills the cache_item instrs field with decoded data based on the addr field
  */
 static void cache_item_page_decode(rv32_cpu_t *cpu, cache_item_t *cache_item)
 {
+    instr_stats_t **stats = instr_cache_item_stats(&cache_item->header,
+            FRAME_SIZE / sizeof(rv_instr_t));
+
     for (size_t i = 0; i < FRAME_SIZE / sizeof(rv_instr_t); ++i) {
-        ptr36_t addr = cache_item->addr + (i * sizeof(rv_instr_t));
+        ptr36_t addr = cache_item->header.addr + (i * sizeof(rv_instr_t));
         rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, addr, false);
         cache_item->instrs[i] = rv32_instr_decode(instr_data);
+        cache_item->data[i] = instr_data;
+
+        // Pages decoded with the statistics enabled count the executions
+        if (stats != NULL) {
+            stats[i] = instr_stats_get(&stats_arch,
+                    (instr_stats_fnc_t) cache_item->instrs[i],
+                    access_size(instr_data));
+            cache_item->instrs[i] = instr_counted;
+        }
+    }
+
+    // Blocks end by a block ending instruction or on the end of the page
+    size_t count = FRAME_SIZE / sizeof(rv_instr_t);
+    for (size_t i = count; i-- > 0;) {
+        bool last = (i == count - 1) || rv_instr_ends_block(cache_item->data[i]);
+        cache_item->block_len[i] = last ? 1 : cache_item->block_len[i + 1] + 1;
     }
 }
 
@@ -357,16 +486,16 @@ static void cache_item_page_decode(rv32_cpu_t *cpu, cache_item_t *cache_item)
  */
 static void update_cache_item(rv32_cpu_t *cpu, cache_item_t *cache_item)
 {
-    frame_t *frame = physmem_find_frame(cache_item->addr);
+    frame_t *frame = physmem_find_frame(cache_item->header.addr);
     ASSERT(frame != NULL);
 
-    if (frame->valid) {
+    if (frame_valid(frame)) {
         return;
     }
 
+    frame_validate(frame);
     cache_item_page_decode(cpu, cache_item);
 
-    frame->valid = true;
     return;
 }
 
@@ -384,17 +513,56 @@ static cache_item_t *cache_try_add(rv32_cpu_t *cpu, ptr36_t phys)
 
     cache_item_t *cache_item = safe_malloc(sizeof(cache_item_t));
 
-    cache_item_init(cache_item);
-    cache_item->addr = ALIGN_DOWN(phys, FRAME_SIZE);
-
-    list_push(&rv_instruction_cache, &cache_item->item);
+    instr_cache_insert(&rv_instruction_cache, &cache_item->header, phys);
 
+    frame_validate(frame);
     cache_item_page_decode(cpu, cache_item);
-
-    frame->valid = true;
     return cache_item;
 }
 
+/**
+ * @brief Remembers the page of the current instruction fetch
+ *
+ * The page is reused by the following fetches until the PC leaves it
+ * or the translation context of the CPU changes.
+ */
+static void remember_fetch_page(rv32_cpu_t *cpu, cache_item_t *cache_item)
+{
+    instr_fetch_page_set(&cpu->fetch_page, &cache_item->header, cpu->pc);
+    cpu->fetch_priv_mode = cpu->priv_mode;
+    cpu->fetch_satp = cpu->csr.satp;
+    cpu->fetch_mstatus = cpu->csr.mstatus;
+    cpu->fetch_tlb_generation = cpu->tlb.generation;
+}
+
+/**
+ * @brief Fetches the instruction on PC from the page of the previous fetch
+ *
+ * Skips the address translation and the cache lookup, memory breakpoints
+ * are not checked, so the fast path is used only for pages without any.
+ *
+ * @returns Whether the instruction was fetched
+ */
+static bool fetch_from_last_page(rv32_cpu_t *cpu, rv_instr_func_t *instr_func, rv_instr_t *instr_data)
+{
+    if (!instr_fetch_page_hit(&cpu->fetch_page, cpu->pc)) {
+        return false;
+    }
+
+    if ((cpu->fetch_priv_mode != cpu->priv_mode)
+            || (cpu->fetch_satp != cpu->csr.satp)
+            || (cpu->fetch_mstatus != cpu->csr.mstatus)
+            || (cpu->fetch_tlb_generation != cpu->tlb.generation)
+            || (cpu->fetch_page.frame->breakpoints > 0)) {
+        return false;
+    }
+
+    cache_item_t *cache_item = (cache_item_t *) cpu->fetch_page.page;
+    *instr_func = cache_item->instrs[PHYS2CACHEINSTR(cpu->pc)];
+    *instr_data = cache_item->data[PHYS2CACHEINSTR(cpu->pc)];
+    return true;
+}
+
 /**
  * @brief Fethes a decoded instruction from memory
  *
@@ -402,29 +570,20 @@ static cache_item_t *cache_try_add(rv32_cpu_t *cpu, ptr36_t phys)
  */
 static rv_instr_func_t fetch_instr(rv32_cpu_t *cpu, ptr36_t phys)
 {
-    cache_item_t *cache_item = NULL;
+    cache_item_t *cache_item = (cache_item_t *) instr_cache_find(&rv_instruction_cache, phys);
 
-    if (cache_hit(phys, &cache_item)) {
-        ASSERT(cache_item != NULL);
+    if (cache_item != NULL) {
         update_cache_item(cpu, cache_item);
-
-        // Move item to front of list on hit
-
-        if (rv_instruction_cache.head != &cache_item->item) {
-            list_remove(&rv_instruction_cache, &cache_item->item);
-            list_push(&rv_instruction_cache, &cache_item->item);
-        }
-
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    } else {
+        cache_item = cache_try_add(cpu, phys);
     }
 
-    cache_item = cache_try_add(cpu, phys);
-
     if (cache_item != NULL) {
+        remember_fetch_page(cpu, cache_item);
         return cache_item->instrs[PHYS2CACHEINSTR(phys)];
     }
     alert("Trying to fetch instructions from outside of physical memory");
-    return rv32_instr_decode((rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true));
+    return rv32_instr_decode((rv_instr_t) physmem_fast_read32(cpu->csr.mhartid, phys));
 }
 
 /**
@@ -571,6 +730,29 @@ static void handle_exception(rv_cpu_t *cpu, rv_exc_t ex)
     }
 }
 
+/**
+ * @brief Computes the effective mip, which includes the external SEIP and STIP
+ *
+ * Full explanation RISC-V Privileged spec section 3.1.9 Machine Interrupt Registers (mip and mie)
+ */
+static uint32_t effective_mip(rv_cpu_t *cpu)
+{
+    return cpu->csr.mip
+            | (cpu->csr.external_SEIP ? rv_csr_sei_mask : 0)
+            | (cpu->csr.external_STIP ? rv_csr_sti_mask : 0);
+}
+
+/**
+ * @brief Whether an enabled interrupt is pending
+ *
+ * The global interrupt enable bits are not considered, so the CPU
+ * does not necessarily trap if true, but it surely does not if false.
+ */
+static bool enabled_interrupt_pending(rv_cpu_t *cpu)
+{
+    return (effective_mip(cpu) & cpu->csr.mie) != 0;
+}
+
 /**
  * @brief Traps if an interrupt is pending and is enabled
  *
@@ -579,12 +761,7 @@ static void handle_exception(rv_cpu_t *cpu, rv_exc_t ex)
  */
 static void try_handle_interrupt(rv_cpu_t *cpu)
 {
-
-    // Effective mip includes the external SEIP
-    // Full explanation RISC-V Privileged spec section 3.1.9 Machine Interrupt Registers (mip and mie)
-    uint32_t mip = cpu->csr.mip
-            | (cpu->csr.external_SEIP ? rv_csr_sei_mask : 0)
-            | (cpu->csr.external_STIP ? rv_csr_sti_mask : 0);
+    uint32_t mip = effective_mip(cpu);
 
     // no interrupt pending
     if (mip == 0) {
@@ -631,55 +808,6 @@ static void try_handle_interrupt(rv_cpu_t *cpu)
 #undef trap_if_set
 }
 
-/**
- * @brief Increases the HPM counters based in the event specifying CSRs
- *
- * @param cpu The cpu on which these counters are
- * @param i The index of the HPM in range [0..29)
- */
-static void account_hmp(rv_cpu_t *cpu, int i)
-{
-    ASSERT((i >= 0 && i < 29));
-
-    uint32_t mask = (1 << (i + 3));
-    bool inhibited = cpu->csr.mcountinhibit & mask;
-
-    if (inhibited) {
-        return;
-    }
-
-    rv_csr_hpm_event_t event = cpu->csr.hpmevents[i];
-
-    switch (event) {
-    case (hpm_u_cycles): {
-        if (cpu->priv_mode == rv_umode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_s_cycles): {
-        if (cpu->priv_mode == rv_smode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_m_cycles): {
-        if (cpu->priv_mode == rv_mmode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_w_cycles): {
-        if (cpu->stdby) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    default:
-        break;
-    }
-}
-
 /**
  * @brief Raises and clears timer interrupts based on the content of the coresponding CSRs
  *
@@ -695,74 +823,110 @@ static void manage_timer_interrupts(rv32_cpu_t *cpu)
 
 /**
  * @brief Increase the counter CSRs and raise timer interrupts if desired
+ *
+ * @param cycles The number of cycles to account
+ * @param instructions_retired Whether an instruction was retired in each of the cycles
  */
-static void account(rv32_cpu_t *cpu, bool instruction_retired)
+static void account(rv32_cpu_t *cpu, uint64_t cycles, bool instructions_retired)
 {
     if (!(cpu->csr.mcountinhibit & 0b001)) {
-        cpu->csr.cycle++;
+        cpu->csr.cycle += cycles;
     }
 
     // mtime cannot be inhibited
-    uint64_t current_tick_time = current_timestamp();
-    cpu->csr.mtime += (current_tick_time - cpu->csr.last_tick_time);
-    cpu->csr.last_tick_time = current_tick_time;
+    rv_csr_mtime_account(&cpu->csr, cycles);
 
-    if (!(cpu->csr.mcountinhibit & 0b100) && instruction_retired) {
-        cpu->csr.instret++;
+    if (!(cpu->csr.mcountinhibit & 0b100) && instructions_retired) {
+        cpu->csr.instret += cycles;
     }
 
-    for (int i = 0; i < 29; ++i) {
-        account_hmp(cpu, i);
-    }
+    rv_csr_hpm_account(&cpu->csr, cpu->priv_mode, cpu->stdby, cycles);
 
     manage_timer_interrupts(cpu);
 }
 
 /**
- * @brief Execute the instruction that PC is pointing to and handle interrupts or exceptions
+ * @brief Record the executed instruction in the binary trace
  */
-static rv_exc_t execute(rv32_cpu_t *cpu)
+static void trace_execute(rv32_cpu_t *cpu, rv_instr_t instr_data)
 {
-    ptr36_t phys;
-    rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, &phys, false, true, true);
+    uint64_t regs[RV_REG_COUNT];
 
-    if (ex != rv_exc_none) {
-        cpu->pending_fetch_fault = true;
-        cpu->pending_fetch_fault_pc = cpu->pc;
-        return ex;
+    // x0 is zeroed only after the instruction
+    regs[0] = 0;
+    for (unsigned int i = 1; i < RV_REG_COUNT; i++) {
+        regs[i] = cpu->regs[i];
     }
 
-    rv_instr_func_t instr_func = fetch_instr(cpu, phys);
-    rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true);
+    trace_instr(TRACE_ARCH_RV32, cpu->csr.mhartid, cpu->pc, instr_data.val,
+            regs, RV_REG_COUNT);
+}
 
-    if (machine_trace) {
+/**
+ * @brief Execute the instruction that PC is pointing to and handle interrupts or exceptions
+ *
+ * Always inlined into execute_plain and execute_instrumented,
+ * so that the plain variant contains no tracing hooks.
+ *
+ * @param instrumented Call the tracing hooks
+ */
+static ALWAYS_INLINE rv_exc_t execute(rv32_cpu_t *cpu, bool instrumented)
+{
+    rv_instr_func_t instr_func;
+    rv_instr_t instr_data;
+
+    if (!fetch_from_last_page(cpu, &instr_func, &instr_data)) {
+        ptr36_t phys;
+        rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, &phys, false, true, true);
+
+        if (ex != rv_exc_none) {
+            cpu->pending_fetch_fault = true;
+            cpu->pending_fetch_fault_pc = cpu->pc;
+            return ex;
+        }
+
+        instr_func = fetch_instr(cpu, phys);
+        instr_data = (rv_instr_t) physmem_fast_read32(cpu->csr.mhartid, phys);
+    }
+
+    if ((instrumented) && (machine_trace)) {
         rv32_idump(cpu, cpu->pc, instr_data);
     }
 
-    ex = instr_func(cpu, instr_data);
+    rv_exc_t ex = instr_func(cpu, instr_data);
 
     if (ex == rv_exc_illegal_instruction) {
         cpu->csr.tval_next = instr_data.val;
     }
 
+    if ((instrumented) && (trace_enabled)) {
+        trace_execute(cpu, instr_data);
+    }
+
     return ex;
 }
 
 /**
- * @brief Simulate one step of the CPU
+ * @brief Execute the instruction without the tracing hooks
  */
-void rv32_cpu_step(rv32_cpu_t *cpu)
+static rv_exc_t execute_plain(rv32_cpu_t *cpu)
 {
-    ASSERT(cpu != NULL);
-
-    rv_exc_t ex = rv_exc_none;
-    bool instruction_retired = false;
+    return execute(cpu, false);
+}
 
-    if (!cpu->stdby) {
-        ex = execute(cpu);
-        instruction_retired = (ex == rv_exc_none);
-    }
+/**
+ * @brief Execute the instruction with the tracing hooks
+ */
+static rv_exc_t execute_instrumented(rv32_cpu_t *cpu)
+{
+    return execute(cpu, true);
+}
 
+/**
+ * @brief Handle interrupts or exceptions and account the executed instruction
+ */
+static void finish_step(rv32_cpu_t *cpu, rv_exc_t ex, bool instruction_retired)
+{
     if (ex != rv_exc_none) {
         handle_exception(cpu, ex);
     } else {
@@ -770,7 +934,7 @@ void rv32_cpu_step(rv32_cpu_t *cpu)
         try_handle_interrupt(cpu);
     }
 
-    account(cpu, instruction_retired);
+    account(cpu, 1, instruction_retired);
 
     if (!cpu->stdby) {
         cpu->pc = cpu->pc_next;
@@ -782,6 +946,162 @@ void rv32_cpu_step(rv32_cpu_t *cpu)
     cpu->csr.tval_next = 0;
 }
 
+/**
+ * @brief Limit the number of cycles so that no timer interrupt is raised before the last one
+ *
+ * @param limit The maximal number of cycles
+ * @returns The number of cycles up to the limit
+ */
+static uint64_t timer_cycles_left(rv32_cpu_t *cpu, uint64_t limit)
+{
+    // The scyclecmp timer interrupt
+    if (!(cpu->csr.mcountinhibit & 0b001) && ((uint32_t) cpu->csr.cycle < cpu->csr.scyclecmp)) {
+        limit = MIN(limit, cpu->csr.scyclecmp - (uint32_t) cpu->csr.cycle);
+    }
+
+    // The mtimecmp timer interrupt when mtime is derived from the cycles
+    return rv_csr_mtime_cycles_left(&cpu->csr, limit);
+}
+
+/**
+ * @brief Simulate one step of the CPU
+ */
+void rv32_cpu_step(rv32_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    rv_exc_t ex = rv_exc_none;
+    bool instruction_retired = false;
+
+    if (!cpu->stdby) {
+        ex = (machine_instrumented) ? execute_instrumented(cpu) : execute_plain(cpu);
+        instruction_retired = (ex == rv_exc_none);
+    } else {
+        rv_csr_mtime_skip(&cpu->csr);
+    }
+
+    finish_step(cpu, ex, instruction_retired);
+}
+
+/**
+ * @brief Simulate a block of instructions of the CPU at once
+ *
+ * Executes the instructions from PC up to the first one ending the block
+ * (see rv_instr_ends_block) or up to the end of the code page. Interrupts
+ * are checked and the counters are updated only once for the whole block,
+ * which gives the same result as stepping the instructions one by one as
+ * long as no enabled interrupt becomes pending within the block. The block
+ * is therefore shortened so that neither scyclecmp nor mtimecmp (when
+ * mtime is derived from the cycles) is reached within it and it ends early
+ * when a device raises an interrupt. Falls back to a single step if the
+ * block cannot be executed at once.
+ *
+ * Instruction tracing and code breakpoints are not supported.
+ *
+ * @param max_cycles The maximal number of cycles to simulate (at least 1)
+ * @returns The number of simulated cycles
+ */
+uint64_t rv32_cpu_step_block(rv32_cpu_t *cpu, uint64_t max_cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(max_cycles > 0);
+
+    rv_instr_func_t instr_func;
+    rv_instr_t instr_data;
+
+    if ((cpu->stdby)
+            || (!is_empty(&cpu->bps))
+            || (enabled_interrupt_pending(cpu))
+            || (!fetch_from_last_page(cpu, &instr_func, &instr_data))) {
+        rv32_cpu_step(cpu);
+        return 1;
+    }
+
+    cache_item_t *cache_item = (cache_item_t *) cpu->fetch_page.page;
+    size_t index = PHYS2CACHEINSTR(cpu->pc);
+    uint64_t count = MIN(cache_item->block_len[index], max_cycles);
+
+    count = timer_cycles_left(cpu, count);
+
+    for (uint64_t executed = 1;; executed++, index++) {
+        instr_func = cache_item->instrs[index];
+        instr_data = cache_item->data[index];
+
+        rv_exc_t ex = instr_func(cpu, instr_data);
+
+        // The last instruction is finished as if single stepped,
+        // devices accessed by it may halt the machine or enter
+        // the debugger
+        if ((ex != rv_exc_none)
+                || (executed == count)
+                || (!frame_valid(cpu->fetch_page.frame))
+                || (enabled_interrupt_pending(cpu))
+                || (machine_halt)
+                || (machine_instrumented)) {
+            if (ex == rv_exc_illegal_instruction) {
+                cpu->csr.tval_next = instr_data.val;
+            }
+
+            if (executed > 1) {
+                account(cpu, executed - 1, true);
+            }
+
+            finish_step(cpu, ex, ex == rv_exc_none);
+            machine_block_cycles = 0;
+            return executed;
+        }
+
+        cpu->pc = cpu->pc_next;
+        cpu->pc_next = cpu->pc + 4;
+
+        // x0 is always 0
+        cpu->regs[0] = 0;
+
+        // Devices observe the cycle of the next instruction
+        machine_block_cycles = executed;
+    }
+}
+
+/**
+ * @brief The number of the following cycles the CPU would only wait in WFI
+ *
+ * The CPU waits until an enabled interrupt becomes pending, which is
+ * either raised by a device or by one of the timers. Skipping mtime to
+ * mtimecmp in the skip mode of mtime is left to rv32_cpu_step.
+ *
+ * @param max_cycles The maximal number of cycles
+ * @returns The number of cycles (at most max_cycles) which can be skipped
+ *          by rv32_cpu_idle_skip or zero if the CPU has to be stepped
+ */
+uint64_t rv32_cpu_idle_cycles(rv32_cpu_t *cpu, uint64_t max_cycles)
+{
+    ASSERT(cpu != NULL);
+
+    if ((!cpu->stdby)
+            || (!is_empty(&cpu->bps))
+            || (enabled_interrupt_pending(cpu))
+            || ((cpu->csr.mtime_source == rv_mtime_skip) && (cpu->csr.mie & rv_csr_mti_mask))) {
+        return 0;
+    }
+
+    return timer_cycles_left(cpu, max_cycles);
+}
+
+/**
+ * @brief Skip the given number of cycles the CPU waits in WFI
+ *
+ * Has the same effect as stepping the CPU the given number of times,
+ * which must not exceed the number returned by rv32_cpu_idle_cycles.
+ */
+void rv32_cpu_idle_skip(rv32_cpu_t *cpu, uint64_t cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(cpu->stdby);
+    ASSERT(cycles > 0);
+
+    account(cpu, cycles, false);
+}
+
 /**
  * @brief Notify the CPU that an adress has been writen ti
  *
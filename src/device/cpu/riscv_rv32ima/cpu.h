@@ -18,7 +18,9 @@
 #include <stdint.h>
 
 #include "../../../main.h"
+#include "../instr_cache.h"
 #include "../riscv_rv_ima/csr.h"
+#include "../riscv_rv_ima/data_tlb.h"
 #include "../riscv_rv_ima/types.h"
 #include "tlb.h"
 
@@ -50,6 +52,7 @@ typedef struct rv32_cpu {
     // LR and SC
     bool reserved_valid; /** Is the current LR reservation valid */
     ptr36_t reserved_addr; /** physical address of the last LR */
+    uint64_t reserved_value; /** value loaded by the last LR (compared by SC when running in parallel) */
 
     /** Tells if the processor is executing or waiting */
     bool stdby;
@@ -57,6 +60,18 @@ typedef struct rv32_cpu {
     /** Translation Lookaside Buffer used for caching translated addresses */
     rv32_tlb_t tlb;
 
+    /** Page of the last instruction fetch
+     *  Valid only in the translation context it was remembered in
+     */
+    instr_fetch_page_t fetch_page;
+    rv_priv_mode_t fetch_priv_mode;
+    uxlen_t fetch_satp;
+    uint64_t fetch_mstatus;
+    unsigned int fetch_tlb_generation;
+
+    /** Host memory of the pages of the recent loads and stores */
+    rv_data_tlb_t data_tlb;
+
     /** breakpoints **/
     list_t bps;
 
@@ -70,6 +85,9 @@ extern void rv32_cpu_init(rv32_cpu_t *cpu, unsigned int procno);
 extern void rv32_cpu_done(rv32_cpu_t *cpu);
 extern void rv32_cpu_set_pc(rv32_cpu_t *cpu, uint32_t value);
 extern void rv32_cpu_step(rv32_cpu_t *cpu);
+extern uint64_t rv32_cpu_step_block(rv32_cpu_t *cpu, uint64_t max_cycles);
+extern uint64_t rv32_cpu_idle_cycles(rv32_cpu_t *cpu, uint64_t max_cycles);
+extern void rv32_cpu_idle_skip(rv32_cpu_t *cpu, uint64_t cycles);
 
 /** Interrupts */
 extern void rv32_interrupt_up(rv32_cpu_t *cpu, unsigned int no);
@@ -34,6 +34,11 @@ extern enum rv_priv_mode rv32_csr_min_priv_mode(csr_num_t csr)
     return rv_csr_min_priv_mode(csr);
 }
 
+extern bool rv32_csr_implemented(csr_num_t csr)
+{
+    return rv_csr_implemented(csr);
+}
+
 extern enum rv_exc rv32_csr_rw(rv_cpu_t *cpu, csr_num_t csr, uint32_t value, uint32_t *read_target, bool read)
 {
     return rv_csr_rw(cpu, csr, value, (uxlen_t *) read_target, read);
@@ -49,6 +54,11 @@ extern enum rv_exc rv32_csr_rc(rv_cpu_t *cpu, csr_num_t csr, uint32_t value, uin
     return rv_csr_rs(cpu, csr, value, (uxlen_t *) read_target, write);
 }
 
+extern void rv32_csr_set_mtime_source(rv_cpu_t *cpu, rv_mtime_source_t source, uint64_t period)
+{
+    rv_csr_set_mtime_source(&cpu->csr, source, period);
+}
+
 extern void rv32_csr_set_asid_len(rv_cpu_t *cpu, unsigned asid_len)
 {
     ASSERT(asid_len <= rv_asid_len);
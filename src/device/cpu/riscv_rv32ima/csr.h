@@ -21,6 +21,7 @@
 extern void rv32_init_csr(rv_csr_t *csr, unsigned int procno);
 
 extern enum rv_priv_mode rv32_csr_min_priv_mode(csr_num_t csr);
+extern bool rv32_csr_implemented(csr_num_t csr);
 
 extern enum rv_exc rv32_csr_rw(rv_cpu_t *cpu, csr_num_t csr, uint32_t value, uint32_t *read_target, bool read);
 extern enum rv_exc rv32_csr_rs(rv_cpu_t *cpu, csr_num_t csr, uint32_t value, uint32_t *read_target, bool write);
@@ -32,4 +33,10 @@ extern enum rv_exc rv32_csr_rc(rv_cpu_t *cpu, csr_num_t csr, uint32_t value, uin
  */
 extern void rv32_csr_set_asid_len(rv_cpu_t *cpu, unsigned asid_active_bits);
 
+/** Change the source of mtime
+ *  The period is the number of cycles between samples of the host time
+ *  or between ticks of mtime derived from the cycles
+ */
+extern void rv32_csr_set_mtime_source(rv_cpu_t *cpu, rv_mtime_source_t source, uint64_t period);
+
 #endif // RISCV_CSR_H_
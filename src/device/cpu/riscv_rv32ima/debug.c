@@ -444,9 +444,9 @@ static void idump_common(uint32_t addr, rv_instr_t instr, string_t *s_opc,
 }
 
 /**
- * @brief Dump the given instruction as if it lied the given address in the context of the given CPU
+ * @brief Dump the given instruction as if it lied the given address in the context of the given CPU number
  */
-void rv32_idump(rv32_cpu_t *cpu, uint32_t addr, rv_instr_t instr)
+static void idump(bool has_cpu, unsigned int procno, uint32_t addr, rv_instr_t instr)
 {
     string_t s_cpu;
     string_t s_addr;
@@ -460,15 +460,15 @@ void rv32_idump(rv32_cpu_t *cpu, uint32_t addr, rv_instr_t instr)
     string_init(&s_mnemonics);
     string_init(&s_comments);
 
-    if (cpu != NULL) {
-        string_printf(&s_cpu, "cpu%u", cpu->csr.mhartid);
+    if (has_cpu) {
+        string_printf(&s_cpu, "cpu%u", procno);
     }
 
     string_printf(&s_addr, "0x%08x", addr);
 
     idump_common(addr, instr, &s_opc, &s_mnemonics, &s_comments);
 
-    if (cpu != NULL) {
+    if (has_cpu) {
         printf("%-5s ", s_cpu.str);
     }
     if (iaddr) {
@@ -493,6 +493,22 @@ void rv32_idump(rv32_cpu_t *cpu, uint32_t addr, rv_instr_t instr)
     string_done(&s_comments);
 }
 
+/**
+ * @brief Dump the given instruction as if it lied the given address in the context of the given CPU
+ */
+void rv32_idump(rv32_cpu_t *cpu, uint32_t addr, rv_instr_t instr)
+{
+    idump(cpu != NULL, (cpu != NULL) ? cpu->csr.mhartid : 0, addr, instr);
+}
+
+/**
+ * @brief Dump the given instruction in the context of the given CPU number (when the CPU itself is not available)
+ */
+void rv32_idump_procno(unsigned int procno, uint32_t addr, rv_instr_t instr)
+{
+    idump(true, procno, addr, instr);
+}
+
 /**
  * @brief Dump the given instruction as if it lied on the given address from the global point of view
  */
@@ -661,7 +677,7 @@ bool rv32_csr_dump(rv32_cpu_t *cpu, csr_num_t csr)
     ASSERT((csr >= 0 && csr < 0x1000));
     ASSERT(cpu != NULL);
 
-    if (rv_csr_name_table[csr] == NULL) {
+    if ((!rv32_csr_implemented(csr)) || (rv_csr_name_table[csr] == NULL)) {
         printf("Invalid CSR!\n");
         return false;
     }
@@ -680,7 +696,7 @@ bool rv32_csr_dump_by_name(rv32_cpu_t *cpu, const char *name)
     ASSERT(cpu != NULL);
     for (int i = 0; i < 0x1000; ++i) {
 
-        if (rv_csr_name_table[i] == NULL) {
+        if ((!rv32_csr_implemented(i)) || (rv_csr_name_table[i] == NULL)) {
             continue;
         }
 
@@ -38,6 +38,7 @@ extern bool rv32_debug_change_regnames(rv_regname_type_t type);
 
 extern void rv32_reg_dump(rv_cpu_t *cpu);
 extern void rv32_idump(rv32_cpu_t *cpu, uint32_t addr, rv_instr_t instr);
+extern void rv32_idump_procno(unsigned int procno, uint32_t addr, rv_instr_t instr);
 extern void rv32_idump_phys(uint32_t addr, rv_instr_t instr);
 extern void rv32_csr_dump_all(rv_cpu_t *cpu);
 extern void rv32_csr_dump_mmode(rv_cpu_t *cpu);
@@ -142,8 +142,14 @@ extern rv_mnemonics_func_t rv_decode_mnemonics(rv_instr_t instr)
 
     // A-extension
 
-    IF_SAME_DECODE(lr);
-    IF_SAME_DECODE(sc);
+    if (instr_func == rv_lr_w_instr) {
+        return rv_lr_mnemonics;
+    }
+
+    if (instr_func == rv_sc_w_instr) {
+        return rv_sc_mnemonics;
+    }
+
     IF_SAME_DECODE(amoswap_w);
     IF_SAME_DECODE(amoadd_w);
     IF_SAME_DECODE(amoxor_w);
@@ -823,7 +829,7 @@ static void print_hpm(rv_cpu_t *cpu, int hpm, string_t *mnemonics, string_t *com
     string_t s;
     string_init(&s);
     string_printf(&s, "hpmcounter%i", hpm);
-    print_64_reg(cpu->csr.hpmcounters[hpm - 3], s.str, mnemonics);
+    print_64_reg(rv_csr_hpm_counter(&cpu->csr, hpm - 3), s.str, mnemonics);
 }
 
 static void print_hpm_event(rv_cpu_t *cpu, int hpm, string_t *mnemonics, string_t *comments)
@@ -7,6 +7,8 @@
 
 typedef struct rv32_tlb_entry {
     item_t item; // Item to be used in LRU or free-list
+    struct rv32_tlb_entry *next; // Next entry in the same hash bucket
+    uint64_t last_use; // Value of the use counter when last used
     sv32_pte_t pte;
     uint32_t vpn;
     unsigned asid;
@@ -14,6 +16,38 @@ typedef struct rv32_tlb_entry {
     bool megapage;
 } rv32_tlb_entry_t;
 
+/** Returns the hash bucket of the given virtual page number
+ *
+ * Pages and megapages are hashed separately, so that a lookup
+ * has to inspect exactly two buckets.
+ */
+static rv32_tlb_entry_t **get_bucket(rv32_tlb_t *tlb, uint32_t vpn, bool megapage)
+{
+    // Fibonacci hashing, using the upper bits of the product
+    uint32_t hash = (vpn * 2 + (megapage ? 1 : 0)) * UINT32_C(2654435769);
+    return &tlb->buckets[hash >> (32 - tlb->bucket_bits)];
+}
+
+static void index_entry(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
+{
+    rv32_tlb_entry_t **bucket = get_bucket(tlb, entry->vpn, entry->megapage);
+    entry->next = *bucket;
+    *bucket = entry;
+}
+
+static void unindex_entry(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
+{
+    rv32_tlb_entry_t **link = get_bucket(tlb, entry->vpn, entry->megapage);
+
+    while (*link != entry) {
+        ASSERT(*link != NULL);
+        link = &(*link)->next;
+    }
+
+    *link = entry->next;
+    entry->next = NULL;
+}
+
 /** Caches a mapping into the TLB */
 extern void rv32_tlb_add_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, sv32_pte_t pte, bool megapage, bool global)
 {
@@ -34,6 +68,9 @@ extern void rv32_tlb_add_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt,
         list_remove(&tlb->lru_list, popped_reused_item);
         // Safe cast because the item is the first field
         entry = (rv32_tlb_entry_t *) popped_reused_item;
+        unindex_entry(tlb, entry);
+        tlb->evictions++;
+        tlb->generation++;
     }
 
     ASSERT(entry != NULL);
@@ -43,13 +80,17 @@ extern void rv32_tlb_add_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt,
     entry->vpn = virt >> (megapage ? RV_MEGAPAGESIZE : RV_PAGESIZE);
     entry->asid = asid;
     entry->global = global;
+    entry->last_use = ++tlb->use_counter;
 
     // Push to front of LRU list
     list_push(&tlb->lru_list, &entry->item);
+    index_entry(tlb, entry);
+    tlb->last_entry = entry;
 }
 
 static void move_lru_entry_to_front(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
 {
+    entry->last_use = ++tlb->use_counter;
 
     // Fast path exit
     if (tlb->lru_list.head == &entry->item) {
@@ -63,51 +104,77 @@ static void move_lru_entry_to_front(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
     list_push(&tlb->lru_list, &entry->item);
 }
 
-/** Returns whether the given TLB entry holds a mapping of the specified virtual address */
-static bool entry_maps_virt(rv32_tlb_entry_t *entry, uint32_t virt)
-{
-    uint32_t vpn = virt >> RV_PAGESIZE;
-    uint32_t mvpn = virt >> RV_MEGAPAGESIZE;
-    return entry->vpn == (entry->megapage ? mvpn : vpn);
-}
-
-/** Retrieves a cached mapping
- * gives priority to megapage mappings
- */
-extern bool rv32_tlb_get_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, sv32_pte_t *pte, bool *megapage, bool noisy)
+/** Finds the most recently used entry mapping the address in one bucket */
+static rv32_tlb_entry_t *find_in_bucket(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, bool megapage, rv32_tlb_entry_t *found)
 {
+    uint32_t vpn = virt >> (megapage ? RV_MEGAPAGESIZE : RV_PAGESIZE);
 
-    rv32_tlb_entry_t *entry;
-
-    for_each(tlb->lru_list, entry, rv32_tlb_entry_t)
-    {
+    for (rv32_tlb_entry_t *entry = *get_bucket(tlb, vpn, megapage); entry != NULL; entry = entry->next) {
 
         // Skip non-global mappings with wrong asid
         if (!entry->global && entry->asid != asid) {
             continue;
         }
 
-        if (entry_maps_virt(entry, virt)) {
+        if (entry->megapage != megapage || entry->vpn != vpn) {
+            continue;
+        }
 
-            if (noisy) {
-                // Ensure LRU behavior, by moving the entry to the front of the LRU list on access
-                move_lru_entry_to_front(tlb, entry);
-            }
+        if (found == NULL || entry->last_use > found->last_use) {
+            found = entry;
+        }
+    }
 
-            *pte = entry->pte;
-            *megapage = entry->megapage;
+    return found;
+}
 
-            return true;
+/** Finds the most recently used entry mapping the address */
+static rv32_tlb_entry_t *find_entry(rv32_tlb_t *tlb, unsigned asid, uint32_t virt)
+{
+    rv32_tlb_entry_t *entry = find_in_bucket(tlb, asid, virt, false, NULL);
+    return find_in_bucket(tlb, asid, virt, true, entry);
+}
+
+/** Retrieves a cached mapping
+ * the most recently used one if several entries map the address
+ */
+extern bool rv32_tlb_get_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, sv32_pte_t *pte, bool *megapage, bool noisy)
+{
+    rv32_tlb_entry_t *entry = find_entry(tlb, asid, virt);
+
+    if (entry == NULL) {
+        if (noisy) {
+            tlb->misses++;
         }
+        return false;
+    }
+
+    if (noisy) {
+        // Ensure LRU behavior, by moving the entry to the front of the LRU list on access
+        move_lru_entry_to_front(tlb, entry);
+        tlb->hits++;
+        tlb->last_entry = entry;
     }
 
-    return false;
+    *pte = entry->pte;
+    *megapage = entry->megapage;
+
+    return true;
+}
+
+extern void rv32_tlb_touch(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
+{
+    ASSERT(entry->item.list == &tlb->lru_list);
+
+    move_lru_entry_to_front(tlb, entry);
+    tlb->hits++;
 }
 
 static void invalidate_tlb_entry(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
 {
     ASSERT(entry->item.list == &tlb->lru_list);
 
+    unindex_entry(tlb, entry);
     list_remove(&tlb->lru_list, &entry->item);
     list_push(&tlb->free_list, &entry->item);
 }
@@ -119,21 +186,32 @@ static bool is_entry_valid(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
 
 extern void rv32_tlb_remove_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt)
 {
+    tlb->generation++;
 
-    rv32_tlb_entry_t *entry;
+    rv32_tlb_entry_t *entry = find_entry(tlb, asid, virt);
 
-    for_each(tlb->lru_list, entry, rv32_tlb_entry_t)
-    {
+    if (entry != NULL) {
+        invalidate_tlb_entry(tlb, entry);
+    }
+}
 
-        // Skip non-global mappings with wrong asid
-        if (!entry->global && entry->asid != asid) {
-            continue;
-        }
+/** Invalidates the entries of one bucket which map the given address
+ * and are of the given asid unless any_asid is set
+ */
+static void flush_bucket(rv32_tlb_t *tlb, bool any_asid, unsigned asid, uint32_t virt, bool megapage)
+{
+    uint32_t vpn = virt >> (megapage ? RV_MEGAPAGESIZE : RV_PAGESIZE);
+    rv32_tlb_entry_t *entry = *get_bucket(tlb, vpn, megapage);
+
+    while (entry != NULL) {
+        rv32_tlb_entry_t *next = entry->next;
 
-        if (entry_maps_virt(entry, virt)) {
+        if (entry->megapage == megapage && entry->vpn == vpn
+                && (any_asid || (!entry->global && entry->asid == asid))) {
             invalidate_tlb_entry(tlb, entry);
-            return;
         }
+
+        entry = next;
     }
 }
 
@@ -142,6 +220,8 @@ extern void rv32_tlb_remove_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t vir
 // Invalidates all entries
 extern void rv32_tlb_flush(rv32_tlb_t *tlb)
 {
+    tlb->generation++;
+
     for (size_t i = 0; i < tlb->size; ++i) {
         if (is_entry_valid(tlb, &tlb->entries[i])) {
             invalidate_tlb_entry(tlb, &tlb->entries[i]);
@@ -152,6 +232,8 @@ extern void rv32_tlb_flush(rv32_tlb_t *tlb)
 // Invalidates all entries of the given asid
 extern void rv32_tlb_flush_by_asid(rv32_tlb_t *tlb, unsigned asid)
 {
+    tlb->generation++;
+
     for (size_t i = 0; i < tlb->size; ++i) {
 
         if (!is_entry_valid(tlb, &tlb->entries[i])) {
@@ -170,66 +252,27 @@ extern void rv32_tlb_flush_by_asid(rv32_tlb_t *tlb, unsigned asid)
 // Invalidates all entries that map the given virtual address
 extern void rv32_tlb_flush_by_addr(rv32_tlb_t *tlb, uint32_t virt)
 {
-    uint32_t vpn = virt >> RV_PAGESIZE;
-    uint32_t mvpn = virt >> RV_MEGAPAGESIZE;
-
-    for (size_t i = 0; i < tlb->size; ++i) {
+    tlb->generation++;
 
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
-            continue;
-        }
-
-        if (tlb->entries[i].megapage) {
-            if (tlb->entries[i].vpn == mvpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-        } else {
-            if (tlb->entries[i].vpn == vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-        }
-    }
+    flush_bucket(tlb, true, 0, virt, false);
+    flush_bucket(tlb, true, 0, virt, true);
 }
 
 // Invalidates all entries that map the given address and are of the given asid
 extern void rv32_tlb_flush_by_asid_and_addr(rv32_tlb_t *tlb, unsigned asid, uint32_t virt)
 {
-    uint32_t vpn = virt >> RV_PAGESIZE;
-    uint32_t mvpn = virt >> RV_MEGAPAGESIZE;
+    tlb->generation++;
 
-    for (size_t i = 0; i < tlb->size; ++i) {
-
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
-            continue;
-        }
-
-        if (tlb->entries[i].global) {
-            continue;
-        }
-
-        if (tlb->entries[i].asid != asid) {
-            continue;
-        }
-
-        if (tlb->entries[i].megapage) {
-            if (tlb->entries[i].vpn == mvpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-        } else {
-            if (tlb->entries[i].vpn == vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-        }
-    }
+    flush_bucket(tlb, false, asid, virt, false);
+    flush_bucket(tlb, false, asid, virt, true);
 }
 
-/** Initializes the TLB data structure */
-extern void rv32_tlb_init(rv32_tlb_t *tlb, size_t size)
+/** Allocates the entries and the hash index for the given size */
+static void allocate_entries(rv32_tlb_t *tlb, size_t size)
 {
-    ASSERT(size != 0);
-
     tlb->entries = safe_malloc(size * sizeof(rv32_tlb_entry_t));
     tlb->size = size;
+    tlb->last_entry = NULL;
     list_init(&tlb->lru_list);
     list_init(&tlb->free_list);
 
@@ -238,27 +281,45 @@ extern void rv32_tlb_init(rv32_tlb_t *tlb, size_t size)
     for (size_t i = 0; i < size; ++i) {
         list_append(&tlb->free_list, &tlb->entries[i].item);
     }
+
+    // At least twice as many buckets as entries
+    tlb->bucket_bits = 1;
+    while (((size_t) 1 << tlb->bucket_bits) < 2 * size) {
+        tlb->bucket_bits++;
+    }
+
+    size_t bucket_count = (size_t) 1 << tlb->bucket_bits;
+    tlb->buckets = safe_malloc(bucket_count * sizeof(rv32_tlb_entry_t *));
+    memset(tlb->buckets, 0, bucket_count * sizeof(rv32_tlb_entry_t *));
+}
+
+/** Initializes the TLB data structure */
+extern void rv32_tlb_init(rv32_tlb_t *tlb, size_t size)
+{
+    ASSERT(size != 0);
+
+    tlb->generation = 0;
+    tlb->use_counter = 0;
+    tlb->hits = 0;
+    tlb->misses = 0;
+    tlb->evictions = 0;
+
+    allocate_entries(tlb, size);
 }
 
 /** Cleans up the TLB structure */
 extern void rv32_tlb_done(rv32_tlb_t *tlb)
 {
     safe_free(tlb->entries);
+    safe_free(tlb->buckets);
 }
 
 extern bool rv32_tlb_resize(rv32_tlb_t *tlb, size_t size)
 {
-    safe_free(tlb->entries);
-    tlb->entries = safe_malloc(size * sizeof(rv32_tlb_entry_t));
-    tlb->size = size;
-    list_init(&tlb->lru_list);
-    list_init(&tlb->free_list);
+    tlb->generation++;
 
-    memset(tlb->entries, 0, size * sizeof(rv32_tlb_entry_t));
-
-    for (size_t i = 0; i < size; ++i) {
-        list_append(&tlb->free_list, &tlb->entries[i].item);
-    }
+    rv32_tlb_done(tlb);
+    allocate_entries(tlb, size);
 
     return true;
 }
@@ -301,5 +362,8 @@ extern void rv32_tlb_dump(rv32_tlb_t *tlb)
         printf("\t Empty\n");
     }
 
+    printf("TLB    hits: %" PRIu64 ", misses: %" PRIu64 ", evictions: %" PRIu64 "\n",
+            tlb->hits, tlb->misses, tlb->evictions);
+
     string_done(&s_text);
 }
@@ -16,10 +16,13 @@
 #include <string.h>
 
 #include "../../../assert.h"
+#include "../../../debug/breakpoint.h"
 #include "../../../list.h"
 #include "../../../main.h"
 #include "../../../physmem.h"
 #include "../../../utils.h"
+#include "../../event.h"
+#include "../instr_cache.h"
 #include "cpu.h"
 #include "csr.h"
 #include "tlb.h"
@@ -32,44 +35,18 @@
 /// Caching of decoded instructions
 
 /**
- * @brief Item of a list of pages of cached instructions
+ * @brief Cached page of decoded instructions
  */
 typedef struct {
-    item_t item; // The list item
-    ptr36_t addr; // The base address of the page
+    instr_cache_item_t header; // The cache bookkeeping, has to be first
     rv_instr_func_t instrs[FRAME_SIZE / sizeof(rv_instr_t)]; // Decoded instructions (represented as function pointers)
+    rv_instr_t data[FRAME_SIZE / sizeof(rv_instr_t)]; // Raw instructions
+    uint16_t block_len[FRAME_SIZE / sizeof(rv_instr_t)]; // Instructions till the end of the block (within the page)
 } cache_item_t;
 
 #define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(rv_instr_t))
 
-static void cache_item_init(cache_item_t *cache_item)
-{
-    item_init(&cache_item->item);
-    cache_item->addr = 0;
-    // Skip instrs init
-}
-
-list_t rv64_instruction_cache = LIST_INITIALIZER;
-
-/**
- * @brief Looks into cache for the instruction on the given physical address
- * @par phys The physical address to check
- * @par cache_item A pointer to a found cache_item_t will be stored here on success
- * @returns Whether the address is in the cache
- */
-static bool cache_hit(ptr36_t phys, cache_item_t **cache_item)
-{
-    ptr36_t target_page = ALIGN_DOWN(phys, FRAME_SIZE);
-    cache_item_t *c;
-    for_each(rv64_instruction_cache, c, cache_item_t)
-    {
-        if (c->addr == target_page) {
-            *cache_item = c;
-            return true;
-        }
-    }
-    return false;
-}
+_Thread_local instr_cache_t rv64_instruction_cache = INSTR_CACHE_INITIALIZER;
 
 static void init_regs(rv64_cpu_t *cpu)
 {
@@ -95,6 +72,7 @@ void rv64_cpu_init(rv64_cpu_t *cpu, unsigned int procno)
     rv64_init_csr(&cpu->csr, procno);
 
     rv64_tlb_init(&cpu->tlb, DEFAULT_RV64_TLB_SIZE);
+    rv_data_tlb_clear(&cpu->data_tlb);
 
     cpu->pending_fetch_fault = false;
 
@@ -107,11 +85,7 @@ void rv64_cpu_init(rv64_cpu_t *cpu, unsigned int procno)
 void rv64_cpu_done(rv64_cpu_t *cpu)
 {
     // Clean whole cache for simplicity whenever any cpu is done
-    while (!is_empty(&rv64_instruction_cache)) {
-        cache_item_t *cache_item = (cache_item_t *) (rv64_instruction_cache.head);
-        list_remove(&rv64_instruction_cache, &cache_item->item);
-        safe_free(cache_item);
-    }
+    instr_cache_flush(&rv64_instruction_cache);
 
     rv64_tlb_done(&cpu->tlb);
 }
@@ -344,6 +318,9 @@ static rv_exc_t rv_convert_addr(rv_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool
     // *phys = virt;
     // return rv64_exc_none;
 
+    // No TLB entry is used unless the translation finds one
+    cpu->tlb.last_entry = NULL;
+
     bool use_sv39 = (sv39_effective_priv(cpu) <= rv_smode) && (!rv_csr_satp_is_bare(cpu)) && !(cpu->priv_mode == rv_mmode && fetch);
 
     if (!use_sv39) {
@@ -401,9 +378,17 @@ rv_exc_t rv64_convert_addr(rv64_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr,
 static void cache_item_page_decode(rv64_cpu_t *cpu, cache_item_t *cache_item)
 {
     for (size_t i = 0; i < FRAME_SIZE / sizeof(rv_instr_t); ++i) {
-        ptr36_t addr = cache_item->addr + (i * sizeof(rv_instr_t));
+        ptr36_t addr = cache_item->header.addr + (i * sizeof(rv_instr_t));
         rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, addr, false);
         cache_item->instrs[i] = rv64_instr_decode(instr_data);
+        cache_item->data[i] = instr_data;
+    }
+
+    // Blocks end by a block ending instruction or on the end of the page
+    size_t count = FRAME_SIZE / sizeof(rv_instr_t);
+    for (size_t i = count; i-- > 0;) {
+        bool last = (i == count - 1) || rv_instr_ends_block(cache_item->data[i]);
+        cache_item->block_len[i] = last ? 1 : cache_item->block_len[i + 1] + 1;
     }
 }
 
@@ -412,16 +397,16 @@ static void cache_item_page_decode(rv64_cpu_t *cpu, cache_item_t *cache_item)
  */
 static void update_cache_item(rv64_cpu_t *cpu, cache_item_t *cache_item)
 {
-    frame_t *frame = physmem_find_frame(cache_item->addr);
+    frame_t *frame = physmem_find_frame(cache_item->header.addr);
     ASSERT(frame != NULL);
 
-    if (frame->valid) {
+    if (frame_valid(frame)) {
         return;
     }
 
+    frame_validate(frame);
     cache_item_page_decode(cpu, cache_item);
 
-    frame->valid = true;
     return;
 }
 
@@ -439,17 +424,56 @@ static cache_item_t *cache_try_add(rv64_cpu_t *cpu, ptr36_t phys)
 
     cache_item_t *cache_item = safe_malloc(sizeof(cache_item_t));
 
-    cache_item_init(cache_item);
-    cache_item->addr = ALIGN_DOWN(phys, FRAME_SIZE);
-
-    list_push(&rv64_instruction_cache, &cache_item->item);
+    instr_cache_insert(&rv64_instruction_cache, &cache_item->header, phys);
 
+    frame_validate(frame);
     cache_item_page_decode(cpu, cache_item);
-
-    frame->valid = true;
     return cache_item;
 }
 
+/**
+ * @brief Remembers the page of the current instruction fetch
+ *
+ * The page is reused by the following fetches until the PC leaves it
+ * or the translation context of the CPU changes.
+ */
+static void remember_fetch_page(rv64_cpu_t *cpu, cache_item_t *cache_item)
+{
+    instr_fetch_page_set(&cpu->fetch_page, &cache_item->header, cpu->pc);
+    cpu->fetch_priv_mode = cpu->priv_mode;
+    cpu->fetch_satp = cpu->csr.satp;
+    cpu->fetch_mstatus = cpu->csr.mstatus;
+    cpu->fetch_tlb_generation = cpu->tlb.generation;
+}
+
+/**
+ * @brief Fetches the instruction on PC from the page of the previous fetch
+ *
+ * Skips the address translation and the cache lookup, memory breakpoints
+ * are not checked, so the fast path is used only for pages without any.
+ *
+ * @returns Whether the instruction was fetched
+ */
+static bool fetch_from_last_page(rv64_cpu_t *cpu, rv_instr_func_t *instr_func, rv_instr_t *instr_data)
+{
+    if (!instr_fetch_page_hit(&cpu->fetch_page, cpu->pc)) {
+        return false;
+    }
+
+    if ((cpu->fetch_priv_mode != cpu->priv_mode)
+            || (cpu->fetch_satp != cpu->csr.satp)
+            || (cpu->fetch_mstatus != cpu->csr.mstatus)
+            || (cpu->fetch_tlb_generation != cpu->tlb.generation)
+            || (cpu->fetch_page.frame->breakpoints > 0)) {
+        return false;
+    }
+
+    cache_item_t *cache_item = (cache_item_t *) cpu->fetch_page.page;
+    *instr_func = cache_item->instrs[PHYS2CACHEINSTR(cpu->pc)];
+    *instr_data = cache_item->data[PHYS2CACHEINSTR(cpu->pc)];
+    return true;
+}
+
 /**
  * @brief Fethes a decoded instruction from memory
  *
@@ -457,29 +481,20 @@ static cache_item_t *cache_try_add(rv64_cpu_t *cpu, ptr36_t phys)
  */
 static rv_instr_func_t fetch_instr(rv64_cpu_t *cpu, ptr36_t phys)
 {
-    cache_item_t *cache_item = NULL;
+    cache_item_t *cache_item = (cache_item_t *) instr_cache_find(&rv64_instruction_cache, phys);
 
-    if (cache_hit(phys, &cache_item)) {
-        ASSERT(cache_item != NULL);
+    if (cache_item != NULL) {
         update_cache_item(cpu, cache_item);
-
-        // Move item to front of list on hit
-
-        if (rv64_instruction_cache.head != &cache_item->item) {
-            list_remove(&rv64_instruction_cache, &cache_item->item);
-            list_push(&rv64_instruction_cache, &cache_item->item);
-        }
-
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    } else {
+        cache_item = cache_try_add(cpu, phys);
     }
 
-    cache_item = cache_try_add(cpu, phys);
-
     if (cache_item != NULL) {
+        remember_fetch_page(cpu, cache_item);
         return cache_item->instrs[PHYS2CACHEINSTR(phys)];
     }
     alert("Trying to fetch instructions from outside of physical memory");
-    return rv64_instr_decode((rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true));
+    return rv64_instr_decode((rv_instr_t) physmem_fast_read32(cpu->csr.mhartid, phys));
 }
 
 /**
@@ -626,6 +641,29 @@ static void handle_exception(rv64_cpu_t *cpu, rv_exc_t ex)
     }
 }
 
+/**
+ * @brief Computes the effective mip, which includes the external SEIP and STIP
+ *
+ * Full explanation RISC-V Privileged spec section 3.1.9 Machine Interrupt Registers (mip and mie)
+ */
+static uint64_t effective_mip(rv64_cpu_t *cpu)
+{
+    return cpu->csr.mip
+            | (cpu->csr.external_SEIP ? rv_csr_sei_mask : 0)
+            | (cpu->csr.external_STIP ? rv_csr_sti_mask : 0);
+}
+
+/**
+ * @brief Whether an enabled interrupt is pending
+ *
+ * The global interrupt enable bits are not considered, so the CPU
+ * does not necessarily trap if true, but it surely does not if false.
+ */
+static bool enabled_interrupt_pending(rv64_cpu_t *cpu)
+{
+    return (effective_mip(cpu) & cpu->csr.mie) != 0;
+}
+
 /**
  * @brief Traps if an interrupt is pending and is enabled
  *
@@ -634,11 +672,7 @@ static void handle_exception(rv64_cpu_t *cpu, rv_exc_t ex)
  */
 static void try_handle_interrupt(rv64_cpu_t *cpu)
 {
-    // Effective mip includes the external SEIP
-    // Full explanation RISC-V Privileged spec section 3.1.9 Machine Interrupt Registers (mip and mie)
-    uint64_t mip = cpu->csr.mip
-            | (cpu->csr.external_SEIP ? rv_csr_sei_mask : 0)
-            | (cpu->csr.external_STIP ? rv_csr_sti_mask : 0);
+    uint64_t mip = effective_mip(cpu);
 
     // no interrupt pending
     if (mip == 0) {
@@ -698,55 +732,6 @@ static void try_handle_interrupt(rv64_cpu_t *cpu)
 #undef trap_if_set
 }
 
-/**
- * @brief Increases the HPM counters based in the event specifying CSRs
- *
- * @param cpu The cpu on which these counters are
- * @param i The index of the HPM in range [0..29)
- */
-static void account_hmp(rv64_cpu_t *cpu, int i)
-{
-    ASSERT((i >= 0 && i < 29));
-
-    uint64_t mask = (1 << (i + 3));
-    bool inhibited = cpu->csr.mcountinhibit & mask;
-
-    if (inhibited) {
-        return;
-    }
-
-    rv_csr_hpm_event_t event = cpu->csr.hpmevents[i];
-
-    switch (event) {
-    case (hpm_u_cycles): {
-        if (cpu->priv_mode == rv_umode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_s_cycles): {
-        if (cpu->priv_mode == rv_smode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_m_cycles): {
-        if (cpu->priv_mode == rv_mmode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_w_cycles): {
-        if (cpu->stdby) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    default:
-        break;
-    }
-}
-
 /**
  * @brief Raises and clears timer interrupts based on the content of the coresponding CSRs
  *
@@ -762,25 +747,24 @@ static void manage_timer_interrupts(rv64_cpu_t *cpu)
 
 /**
  * @brief Increase the counter CSRs and raise timer interrupts if desired
+ *
+ * @param cycles The number of cycles to account
+ * @param instructions_retired Whether an instruction was retired in each of the cycles
  */
-static void account(rv64_cpu_t *cpu, bool instruction_retired)
+static void account(rv64_cpu_t *cpu, uint64_t cycles, bool instructions_retired)
 {
     if (!(cpu->csr.mcountinhibit & 0b001)) {
-        cpu->csr.cycle++;
+        cpu->csr.cycle += cycles;
     }
 
     // mtime cannot be inhibited
-    uint64_t current_tick_time = current_timestamp();
-    cpu->csr.mtime += (current_tick_time - cpu->csr.last_tick_time);
-    cpu->csr.last_tick_time = current_tick_time;
+    rv_csr_mtime_account(&cpu->csr, cycles);
 
-    if (!(cpu->csr.mcountinhibit & 0b100) && instruction_retired) {
-        cpu->csr.instret++;
+    if (!(cpu->csr.mcountinhibit & 0b100) && instructions_retired) {
+        cpu->csr.instret += cycles;
     }
 
-    for (int i = 0; i < 29; ++i) {
-        account_hmp(cpu, i);
-    }
+    rv_csr_hpm_account(&cpu->csr, cpu->priv_mode, cpu->stdby, cycles);
 
     manage_timer_interrupts(cpu);
 }
@@ -790,25 +774,30 @@ static void account(rv64_cpu_t *cpu, bool instruction_retired)
  */
 static rv_exc_t execute(rv64_cpu_t *cpu)
 {
-    ptr36_t phys;
-    rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, &phys, false, true, true);
+    rv_instr_func_t instr_func;
+    rv_instr_t instr_data;
 
-    if (ex != rv_exc_none) {
-        cpu->pending_fetch_fault = true;
-        cpu->pending_fetch_fault_pc = cpu->pc;
+    if (!fetch_from_last_page(cpu, &instr_func, &instr_data)) {
+        ptr36_t phys;
+        rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, &phys, false, true, true);
 
-        return ex;
-    }
+        if (ex != rv_exc_none) {
+            cpu->pending_fetch_fault = true;
+            cpu->pending_fetch_fault_pc = cpu->pc;
 
-    rv_instr_func_t instr_func = fetch_instr(cpu, phys);
-    rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true);
+            return ex;
+        }
+
+        instr_func = fetch_instr(cpu, phys);
+        instr_data = (rv_instr_t) physmem_fast_read32(cpu->csr.mhartid, phys);
+    }
 
     // if (machine_trace) {
     //     rv64_idump(cpu, cpu->pc, instr_data);
     // }
 
     // TODO: Fix this ugly hack
-    ex = instr_func((void *) cpu, instr_data);
+    rv_exc_t ex = instr_func((void *) cpu, instr_data);
 
     if (ex == rv_exc_illegal_instruction) {
         cpu->csr.tval_next = instr_data.val;
@@ -817,6 +806,47 @@ static rv_exc_t execute(rv64_cpu_t *cpu)
     return ex;
 }
 
+/**
+ * @brief Handle interrupts or exceptions and account the executed instruction
+ */
+static void finish_step(rv64_cpu_t *cpu, rv_exc_t ex, bool instruction_retired)
+{
+    if (ex != rv_exc_none) {
+        handle_exception(cpu, ex);
+    } else {
+        // If any interrupts are pending, handle them
+        try_handle_interrupt(cpu);
+    }
+
+    account(cpu, 1, instruction_retired);
+
+    if (!cpu->stdby) {
+        cpu->pc = cpu->pc_next;
+        cpu->pc_next = cpu->pc + 4;
+    }
+
+    // x0 is always 0
+    cpu->regs[0] = 0;
+    cpu->csr.tval_next = 0;
+}
+
+/**
+ * @brief Limit the number of cycles so that no timer interrupt is raised before the last one
+ *
+ * @param limit The maximal number of cycles
+ * @returns The number of cycles up to the limit
+ */
+static uint64_t timer_cycles_left(rv64_cpu_t *cpu, uint64_t limit)
+{
+    // The scyclecmp timer interrupt
+    if (!(cpu->csr.mcountinhibit & 0b001) && (cpu->csr.cycle < cpu->csr.scyclecmp)) {
+        limit = MIN(limit, cpu->csr.scyclecmp - cpu->csr.cycle);
+    }
+
+    // The mtimecmp timer interrupt when mtime is derived from the cycles
+    return rv_csr_mtime_cycles_left(&cpu->csr, limit);
+}
+
 /**
  * @brief Simulate one step of the CPU
  */
@@ -830,25 +860,128 @@ void rv64_cpu_step(rv64_cpu_t *cpu)
     if (!cpu->stdby) {
         ex = execute(cpu);
         instruction_retired = (ex == rv_exc_none);
+    } else {
+        rv_csr_mtime_skip(&cpu->csr);
     }
 
-    if (ex != rv_exc_none) {
-        handle_exception(cpu, ex);
-    } else {
-        // If any interrupts are pending, handle them
-        try_handle_interrupt(cpu);
+    finish_step(cpu, ex, instruction_retired);
+}
+
+/**
+ * @brief Simulate a block of instructions of the CPU at once
+ *
+ * Executes the instructions from PC up to the first one ending the block
+ * (see rv_instr_ends_block) or up to the end of the code page. Interrupts
+ * are checked and the counters are updated only once for the whole block,
+ * which gives the same result as stepping the instructions one by one as
+ * long as no enabled interrupt becomes pending within the block. The block
+ * is therefore shortened so that neither scyclecmp nor mtimecmp (when
+ * mtime is derived from the cycles) is reached within it and it ends early
+ * when a device raises an interrupt. Falls back to a single step if the
+ * block cannot be executed at once.
+ *
+ * Instruction tracing and code breakpoints are not supported.
+ *
+ * @param max_cycles The maximal number of cycles to simulate (at least 1)
+ * @returns The number of simulated cycles
+ */
+uint64_t rv64_cpu_step_block(rv64_cpu_t *cpu, uint64_t max_cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(max_cycles > 0);
+
+    rv_instr_func_t instr_func;
+    rv_instr_t instr_data;
+
+    if ((cpu->stdby)
+            || (enabled_interrupt_pending(cpu))
+            || (!fetch_from_last_page(cpu, &instr_func, &instr_data))) {
+        rv64_cpu_step(cpu);
+        return 1;
     }
 
-    account(cpu, instruction_retired);
+    cache_item_t *cache_item = (cache_item_t *) cpu->fetch_page.page;
+    size_t index = PHYS2CACHEINSTR(cpu->pc);
+    uint64_t count = MIN(cache_item->block_len[index], max_cycles);
+
+    count = timer_cycles_left(cpu, count);
+
+    for (uint64_t executed = 1;; executed++, index++) {
+        instr_func = cache_item->instrs[index];
+        instr_data = cache_item->data[index];
+
+        rv_exc_t ex = instr_func((void *) cpu, instr_data);
+
+        // The last instruction is finished as if single stepped,
+        // devices accessed by it may halt the machine or enter
+        // the debugger
+        if ((ex != rv_exc_none)
+                || (executed == count)
+                || (!frame_valid(cpu->fetch_page.frame))
+                || (enabled_interrupt_pending(cpu))
+                || (machine_halt)
+                || (machine_instrumented)) {
+            if (ex == rv_exc_illegal_instruction) {
+                cpu->csr.tval_next = instr_data.val;
+            }
+
+            if (executed > 1) {
+                account(cpu, executed - 1, true);
+            }
+
+            finish_step(cpu, ex, ex == rv_exc_none);
+            machine_block_cycles = 0;
+            return executed;
+        }
 
-    if (!cpu->stdby) {
         cpu->pc = cpu->pc_next;
         cpu->pc_next = cpu->pc + 4;
+
+        // x0 is always 0
+        cpu->regs[0] = 0;
+
+        // Devices observe the cycle of the next instruction
+        machine_block_cycles = executed;
     }
+}
 
-    // x0 is always 0
-    cpu->regs[0] = 0;
-    cpu->csr.tval_next = 0;
+/**
+ * @brief The number of the following cycles the CPU would only wait in WFI
+ *
+ * The CPU waits until an enabled interrupt becomes pending, which is
+ * either raised by a device or by one of the timers. Skipping mtime to
+ * mtimecmp in the skip mode of mtime is left to rv64_cpu_step.
+ *
+ * @param max_cycles The maximal number of cycles
+ * @returns The number of cycles (at most max_cycles) which can be skipped
+ *          by rv64_cpu_idle_skip or zero if the CPU has to be stepped
+ */
+uint64_t rv64_cpu_idle_cycles(rv64_cpu_t *cpu, uint64_t max_cycles)
+{
+    ASSERT(cpu != NULL);
+
+    if ((!cpu->stdby)
+            || (enabled_interrupt_pending(cpu))
+            || ((cpu->csr.mtime_source == rv_mtime_skip) && (cpu->csr.mie & rv_csr_mti_mask))) {
+        return 0;
+    }
+
+    return timer_cycles_left(cpu, max_cycles);
+}
+
+/**
+ * @brief Skip the given number of cycles the CPU waits in WFI
+ *
+ * Has the same effect as stepping the CPU the given number of times,
+ * which must not exceed the number returned by rv64_cpu_idle_cycles.
+ */
+void rv64_cpu_idle_skip(rv64_cpu_t *cpu, uint64_t cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(cpu->stdby);
+    ASSERT(cycles > 0);
+
+    account(cpu, cycles, false);
 }
 
 /**
@@ -25,6 +25,7 @@
 extern void rv64_init_csr(rv_csr_t *csr, unsigned int procno);
 
 extern enum rv_priv_mode rv64_csr_min_priv_mode(csr_num_t csr);
+extern bool rv64_csr_implemented(csr_num_t csr);
 
 extern enum rv_exc rv64_csr_rw(rv_cpu_t *cpu, csr_num_t csr, uint64_t value, uint64_t *read_target, bool read);
 extern enum rv_exc rv64_csr_rs(rv_cpu_t *cpu, csr_num_t csr, uint64_t value, uint64_t *read_target, bool write);
@@ -36,4 +37,10 @@ extern enum rv_exc rv64_csr_rc(rv_cpu_t *cpu, csr_num_t csr, uint64_t value, uin
  */
 extern void rv64_csr_set_asid_len(rv_cpu_t *cpu, unsigned asid_active_bits);
 
+/** Change the source of mtime
+ *  The period is the number of cycles between samples of the host time
+ *  or between ticks of mtime derived from the cycles
+ */
+extern void rv64_csr_set_mtime_source(rv_cpu_t *cpu, rv_mtime_source_t source, uint64_t period);
+
 #endif
@@ -658,7 +658,7 @@ bool rv64_csr_dump(rv64_cpu_t *cpu, csr_num_t csr)
     ASSERT((csr >= 0 && csr < 0x1000));
     ASSERT(cpu != NULL);
 
-    if (rv64_csr_name_table[csr] == NULL) {
+    if ((!rv64_csr_implemented(csr)) || (rv64_csr_name_table[csr] == NULL)) {
         printf("Invalid CSR!\n");
         return false;
     }
@@ -677,7 +677,7 @@ bool rv64_csr_dump_by_name(rv64_cpu_t *cpu, const char *name)
     ASSERT(cpu != NULL);
     for (int i = 0; i < 0x1000; ++i) {
 
-        if (rv64_csr_name_table[i] == NULL) {
+        if ((!rv64_csr_implemented(i)) || (rv64_csr_name_table[i] == NULL)) {
             continue;
         }
 
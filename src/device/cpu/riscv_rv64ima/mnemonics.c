@@ -833,7 +833,7 @@ static void print_hpm(rv64_cpu_t *cpu, int hpm, string_t *mnemonics, string_t *c
     string_t s;
     string_init(&s);
     string_printf(&s, "hpmcounter%i", hpm);
-    print_64_reg(cpu->csr.hpmcounters[hpm - 3], s.str, mnemonics);
+    print_64_reg(rv_csr_hpm_counter(&cpu->csr, hpm - 3), s.str, mnemonics);
 }
 
 static void print_hpm_event(rv64_cpu_t *cpu, int hpm, string_t *mnemonics, string_t *comments)
@@ -8,6 +8,8 @@
 
 typedef struct rv64_tlb_entry {
     item_t item; // Item to be used in LRU or free-list
+    struct rv64_tlb_entry *next; // Next entry in the same hash bucket
+    uint64_t last_use; // Value of the use counter when last used
     sv39_pte_t pte;
     uint64_t vpn;
     unsigned asid;
@@ -15,9 +17,61 @@ typedef struct rv64_tlb_entry {
     sv39_page_type_t page_type;
 } rv64_tlb_entry_t;
 
+/** Number of the page types */
+#define PAGE_TYPE_COUNT 3
+
+/** Returns the number of the page offset bits of the given page type */
+static unsigned int page_shift(sv39_page_type_t page_type)
+{
+    switch (page_type) {
+    case megapage:
+        return RV64_MEGAPAGESIZE;
+    case gigapage:
+        return RV64_GIGAPAGESIZE;
+    default:
+        return RV64_PAGESIZE;
+    }
+}
+
+/** Returns the hash bucket of the given virtual page number
+ *
+ * Each page type is hashed separately, so that a lookup
+ * has to inspect exactly one bucket per page type.
+ */
+static rv64_tlb_entry_t **get_bucket(rv64_tlb_t *tlb, uint64_t vpn, sv39_page_type_t page_type)
+{
+    // Fibonacci hashing, using the upper bits of the product
+    uint64_t hash = (vpn * PAGE_TYPE_COUNT + page_type) * UINT64_C(11400714819323198485);
+    return &tlb->buckets[hash >> (64 - tlb->bucket_bits)];
+}
+
+static void index_entry(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
+{
+    rv64_tlb_entry_t **bucket = get_bucket(tlb, entry->vpn, entry->page_type);
+    entry->next = *bucket;
+    *bucket = entry;
+}
+
+static void unindex_entry(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
+{
+    rv64_tlb_entry_t **link = get_bucket(tlb, entry->vpn, entry->page_type);
+
+    while (*link != entry) {
+        ASSERT(*link != NULL);
+        link = &(*link)->next;
+    }
+
+    *link = entry->next;
+    entry->next = NULL;
+}
+
 /** Caches a mapping into the TLB */
 extern void rv64_tlb_add_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_pte_t pte, sv39_page_type_t page_type, bool global)
 {
+    if (page_type != page && page_type != megapage && page_type != gigapage) {
+        return;
+    }
+
     rv64_tlb_entry_t *entry = NULL;
 
     if (!is_empty(&tlb->free_list)) {
@@ -33,38 +87,30 @@ extern void rv64_tlb_add_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt,
         list_remove(&tlb->lru_list, popped_reused_item);
         // Safe cast because the item is the first field
         entry = (rv64_tlb_entry_t *) popped_reused_item;
+        unindex_entry(tlb, entry);
+        tlb->evictions++;
+        tlb->generation++;
     }
 
     ASSERT(entry != NULL);
 
-    uint64_t vpn;
-
-    switch (page_type) {
-    case page:
-        vpn = virt >> RV64_PAGESIZE;
-        break;
-    case megapage:
-        vpn = virt >> RV64_MEGAPAGESIZE;
-        break;
-    case gigapage:
-        vpn = virt >> RV64_GIGAPAGESIZE;
-        break;
-    default:
-        return;
-    }
-
     entry->pte = pte;
     entry->page_type = page_type;
-    entry->vpn = vpn;
+    entry->vpn = virt >> page_shift(page_type);
     entry->asid = asid;
     entry->global = global;
+    entry->last_use = ++tlb->use_counter;
 
     // Push to front of LRU list
     list_push(&tlb->lru_list, &entry->item);
+    index_entry(tlb, entry);
+    tlb->last_entry = entry;
 }
 
 static void move_lru_entry_to_front(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
 {
+    entry->last_use = ++tlb->use_counter;
+
     // Fast path exit
     if (tlb->lru_list.head == &entry->item) {
         return;
@@ -77,62 +123,78 @@ static void move_lru_entry_to_front(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
     list_push(&tlb->lru_list, &entry->item);
 }
 
-/** Returns whether the given TLB entry holds a mapping of the specified virtual address */
-static bool entry_maps_virt(rv64_tlb_entry_t *entry, uint64_t virt)
+/** Finds the most recently used entry mapping the address in one bucket */
+static rv64_tlb_entry_t *find_in_bucket(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_page_type_t page_type, rv64_tlb_entry_t *found)
 {
-    uint64_t vpn;
+    uint64_t vpn = virt >> page_shift(page_type);
 
-    switch (entry->page_type) {
-    case page:
-        vpn = virt >> RV64_PAGESIZE;
-        break;
-    case megapage:
-        vpn = virt >> RV64_MEGAPAGESIZE;
-        break;
-    case gigapage:
-        vpn = virt >> RV64_GIGAPAGESIZE;
-        break;
-    default:
-        return false;
+    for (rv64_tlb_entry_t *entry = *get_bucket(tlb, vpn, page_type); entry != NULL; entry = entry->next) {
+
+        // Skip non-global mappings with wrong asid
+        if (!entry->global && entry->asid != asid) {
+            continue;
+        }
+
+        if (entry->page_type != page_type || entry->vpn != vpn) {
+            continue;
+        }
+
+        if (found == NULL || entry->last_use > found->last_use) {
+            found = entry;
+        }
     }
 
-    return entry->vpn == vpn;
+    return found;
+}
+
+/** Finds the most recently used entry mapping the address */
+static rv64_tlb_entry_t *find_entry(rv64_tlb_t *tlb, unsigned asid, uint64_t virt)
+{
+    rv64_tlb_entry_t *entry = find_in_bucket(tlb, asid, virt, page, NULL);
+    entry = find_in_bucket(tlb, asid, virt, megapage, entry);
+    return find_in_bucket(tlb, asid, virt, gigapage, entry);
 }
 
 /** Retrieves a cached mapping
- * gives priority to megapage mappings
+ * the most recently used one if several entries map the address
  */
 extern bool rv64_tlb_get_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_pte_t *pte, sv39_page_type_t *page_type, bool noisy)
 {
-    rv64_tlb_entry_t *entry;
+    rv64_tlb_entry_t *entry = find_entry(tlb, asid, virt);
 
-    for_each(tlb->lru_list, entry, rv64_tlb_entry_t)
-    {
-        // Skip non-global mappings with wrong asid
-        if (!entry->global && entry->asid != asid) {
-            continue;
+    if (entry == NULL) {
+        if (noisy) {
+            tlb->misses++;
         }
+        return false;
+    }
 
-        if (entry_maps_virt(entry, virt)) {
-            if (noisy) {
-                // Ensure LRU behavior, by moving the entry to the front of the LRU list on access
-                move_lru_entry_to_front(tlb, entry);
-            }
+    if (noisy) {
+        // Ensure LRU behavior, by moving the entry to the front of the LRU list on access
+        move_lru_entry_to_front(tlb, entry);
+        tlb->hits++;
+        tlb->last_entry = entry;
+    }
 
-            *pte = entry->pte;
-            *page_type = entry->page_type;
+    *pte = entry->pte;
+    *page_type = entry->page_type;
 
-            return true;
-        }
-    }
+    return true;
+}
 
-    return false;
+extern void rv64_tlb_touch(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
+{
+    ASSERT(entry->item.list == &tlb->lru_list);
+
+    move_lru_entry_to_front(tlb, entry);
+    tlb->hits++;
 }
 
 static void invalidate_tlb_entry(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
 {
     ASSERT(entry->item.list == &tlb->lru_list);
 
+    unindex_entry(tlb, entry);
     list_remove(&tlb->lru_list, &entry->item);
     list_push(&tlb->free_list, &entry->item);
 }
@@ -144,19 +206,32 @@ static bool is_entry_valid(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
 
 extern void rv64_tlb_remove_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt)
 {
-    rv64_tlb_entry_t *entry;
+    tlb->generation++;
 
-    for_each(tlb->lru_list, entry, rv64_tlb_entry_t)
-    {
-        // Skip non-global mappings with wrong asid
-        if (!entry->global && entry->asid != asid) {
-            continue;
-        }
+    rv64_tlb_entry_t *entry = find_entry(tlb, asid, virt);
+
+    if (entry != NULL) {
+        invalidate_tlb_entry(tlb, entry);
+    }
+}
 
-        if (entry_maps_virt(entry, virt)) {
+/** Invalidates the entries of one bucket which map the given address
+ * and are of the given asid unless any_asid is set
+ */
+static void flush_bucket(rv64_tlb_t *tlb, bool any_asid, unsigned asid, uint64_t virt, sv39_page_type_t page_type)
+{
+    uint64_t vpn = virt >> page_shift(page_type);
+    rv64_tlb_entry_t *entry = *get_bucket(tlb, vpn, page_type);
+
+    while (entry != NULL) {
+        rv64_tlb_entry_t *next = entry->next;
+
+        if (entry->page_type == page_type && entry->vpn == vpn
+                && (any_asid || (!entry->global && entry->asid == asid))) {
             invalidate_tlb_entry(tlb, entry);
-            return;
         }
+
+        entry = next;
     }
 }
 
@@ -165,6 +240,8 @@ extern void rv64_tlb_remove_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t vir
 // Invalidates all entries
 extern void rv64_tlb_flush(rv64_tlb_t *tlb)
 {
+    tlb->generation++;
+
     for (size_t i = 0; i < tlb->size; ++i) {
         if (is_entry_valid(tlb, &tlb->entries[i])) {
             invalidate_tlb_entry(tlb, &tlb->entries[i]);
@@ -175,6 +252,8 @@ extern void rv64_tlb_flush(rv64_tlb_t *tlb)
 // Invalidates all entries of the given asid
 extern void rv64_tlb_flush_by_asid(rv64_tlb_t *tlb, unsigned asid)
 {
+    tlb->generation++;
+
     for (size_t i = 0; i < tlb->size; ++i) {
 
         if (!is_entry_valid(tlb, &tlb->entries[i])) {
@@ -193,82 +272,29 @@ extern void rv64_tlb_flush_by_asid(rv64_tlb_t *tlb, unsigned asid)
 // Invalidates all entries that map the given virtual address
 extern void rv64_tlb_flush_by_addr(rv64_tlb_t *tlb, uint64_t virt)
 {
-    uint64_t page_vpn = virt >> RV64_PAGESIZE;
-    uint64_t mega_vpn = virt >> RV64_MEGAPAGESIZE;
-    uint64_t giga_vpn = virt >> RV64_GIGAPAGESIZE;
+    tlb->generation++;
 
-    for (size_t i = 0; i < tlb->size; ++i) {
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
-            continue;
-        }
-
-        switch (tlb->entries[i].page_type) {
-        case page:
-            if (tlb->entries[i].vpn == page_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case megapage:
-            if (tlb->entries[i].vpn == mega_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case gigapage:
-            if (tlb->entries[i].vpn == giga_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        }
-    }
+    flush_bucket(tlb, true, 0, virt, page);
+    flush_bucket(tlb, true, 0, virt, megapage);
+    flush_bucket(tlb, true, 0, virt, gigapage);
 }
 
 // Invalidates all entries that map the given address and are of the given asid
 extern void rv64_tlb_flush_by_asid_and_addr(rv64_tlb_t *tlb, unsigned asid, uint64_t virt)
 {
-    uint64_t page_vpn = virt >> RV64_PAGESIZE;
-    uint64_t mega_vpn = virt >> RV64_MEGAPAGESIZE;
-    uint64_t giga_vpn = virt >> RV64_GIGAPAGESIZE;
-
-    for (size_t i = 0; i < tlb->size; ++i) {
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
-            continue;
-        }
-
-        if (tlb->entries[i].global) {
-            continue;
-        }
-
-        if (tlb->entries[i].asid != asid) {
-            continue;
-        }
+    tlb->generation++;
 
-        switch (tlb->entries[i].page_type) {
-        case page:
-            if (tlb->entries[i].vpn == page_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case megapage:
-            if (tlb->entries[i].vpn == mega_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case gigapage:
-            if (tlb->entries[i].vpn == giga_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        }
-    }
+    flush_bucket(tlb, false, asid, virt, page);
+    flush_bucket(tlb, false, asid, virt, megapage);
+    flush_bucket(tlb, false, asid, virt, gigapage);
 }
 
-/** Initializes the TLB data structure */
-extern void rv64_tlb_init(rv64_tlb_t *tlb, size_t size)
+/** Allocates the entries and the hash index for the given size */
+static void allocate_entries(rv64_tlb_t *tlb, size_t size)
 {
-    ASSERT(size != 0);
-
     tlb->entries = safe_malloc(size * sizeof(rv64_tlb_entry_t));
     tlb->size = size;
+    tlb->last_entry = NULL;
     list_init(&tlb->lru_list);
     list_init(&tlb->free_list);
 
@@ -277,51 +303,53 @@ extern void rv64_tlb_init(rv64_tlb_t *tlb, size_t size)
     for (size_t i = 0; i < size; ++i) {
         list_append(&tlb->free_list, &tlb->entries[i].item);
     }
+
+    // At least twice as many buckets as entries
+    tlb->bucket_bits = 1;
+    while (((size_t) 1 << tlb->bucket_bits) < 2 * size) {
+        tlb->bucket_bits++;
+    }
+
+    size_t bucket_count = (size_t) 1 << tlb->bucket_bits;
+    tlb->buckets = safe_malloc(bucket_count * sizeof(rv64_tlb_entry_t *));
+    memset(tlb->buckets, 0, bucket_count * sizeof(rv64_tlb_entry_t *));
+}
+
+/** Initializes the TLB data structure */
+extern void rv64_tlb_init(rv64_tlb_t *tlb, size_t size)
+{
+    ASSERT(size != 0);
+
+    tlb->generation = 0;
+    tlb->use_counter = 0;
+    tlb->hits = 0;
+    tlb->misses = 0;
+    tlb->evictions = 0;
+
+    allocate_entries(tlb, size);
 }
 
 /** Cleans up the TLB structure */
 extern void rv64_tlb_done(rv64_tlb_t *tlb)
 {
     safe_free(tlb->entries);
+    safe_free(tlb->buckets);
 }
 
 extern bool rv64_tlb_resize(rv64_tlb_t *tlb, size_t size)
 {
-    safe_free(tlb->entries);
-    tlb->entries = safe_malloc(size * sizeof(rv64_tlb_entry_t));
-    tlb->size = size;
-    list_init(&tlb->lru_list);
-    list_init(&tlb->free_list);
+    tlb->generation++;
 
-    memset(tlb->entries, 0, size * sizeof(rv64_tlb_entry_t));
-
-    for (size_t i = 0; i < size; ++i) {
-        list_append(&tlb->free_list, &tlb->entries[i].item);
-    }
+    rv64_tlb_done(tlb);
+    allocate_entries(tlb, size);
 
     return true;
 }
 
 static inline void dump_tlb_entry(rv64_tlb_entry_t entry, string_t *text)
 {
-    uint64_t virt;
-
-    switch (entry.page_type) {
-    case page:
-        virt = entry.vpn << RV64_PAGESIZE;
-        break;
-    case megapage:
-        virt = entry.vpn << RV64_MEGAPAGESIZE;
-        break;
-    case gigapage:
-        virt = entry.vpn << RV64_GIGAPAGESIZE;
-        break;
-    default:
-        return;
-    }
-
     string_printf(text, "0x%08" PRIx64 " => 0x%09" PRIx64 " [ ASID: %d, GLOBAL: %s, PAGE TYPE: %s ]",
-            virt,
+            entry.vpn << page_shift(entry.page_type),
             (ptr55_t) entry.pte.ppn << RV64_PAGESIZE,
             entry.asid,
             entry.global ? "T" : "F",
@@ -356,5 +384,8 @@ extern void rv64_tlb_dump(rv64_tlb_t *tlb)
         printf("\t Empty\n");
     }
 
+    printf("TLB    hits: %" PRIu64 ", misses: %" PRIu64 ", evictions: %" PRIu64 "\n",
+            tlb->hits, tlb->misses, tlb->evictions);
+
     string_done(&s_text);
 }
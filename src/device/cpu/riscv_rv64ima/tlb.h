@@ -27,6 +27,20 @@ typedef struct rv64_tlb {
     size_t size;
     list_t lru_list;
     list_t free_list;
+    unsigned int generation; // Changes on every flush, removal or eviction of a mapping
+
+    // Hash index of the valid entries by their virtual page number
+    struct rv64_tlb_entry **buckets;
+    unsigned int bucket_bits;
+    // Counter of entry uses, ordering the entries the same way as the LRU list
+    uint64_t use_counter;
+    // Entry used by the last translation (valid until the generation changes)
+    struct rv64_tlb_entry *last_entry;
+
+    // Statistics of the translation lookups
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
 } rv64_tlb_t;
 
 #define DEFAULT_RV64_TLB_SIZE 96
@@ -37,6 +51,9 @@ extern void rv64_tlb_add_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt,
 /** Retrieves a cached mapping, giving priority to megapage mappings */
 extern bool rv64_tlb_get_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_pte_t *pte, sv39_page_type_t *page_type, bool noisy);
 
+/** Marks the given entry as used by a translation (as a noisy lookup would do) */
+extern void rv64_tlb_touch(rv64_tlb_t *tlb, struct rv64_tlb_entry *entry);
+
 /** Removes the first mapping that matches the given address and is global or has the right ASID */
 extern void rv64_tlb_remove_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt);
 
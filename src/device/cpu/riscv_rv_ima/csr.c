@@ -37,10 +37,33 @@ static void rv_init_csr(rv_csr_t *csr, unsigned int procno)
 
     csr->mtime = current_timestamp();
     csr->last_tick_time = csr->mtime;
+    csr->mtime_source = rv_mtime_host;
+    csr->mtime_period = RV_MTIME_HOST_PERIOD;
 
     csr->asid_len = rv_asid_len;
 }
 
+/**
+ * Change the source of mtime
+ *
+ * When switching from the host time, mtime restarts from zero so that
+ * the time derived from the cycles does not depend on the host.
+ */
+static void rv_csr_set_mtime_source(rv_csr_t *csr, rv_mtime_source_t source, uint64_t period)
+{
+    ASSERT(period > 0);
+
+    if (source == rv_mtime_host) {
+        csr->last_tick_time = current_timestamp();
+    } else if (csr->mtime_source == rv_mtime_host) {
+        csr->mtime = 0;
+    }
+
+    csr->mtime_source = source;
+    csr->mtime_period = period;
+    csr->mtime_cycles = 0;
+}
+
 /**
  * @brief The minimal privilege from which the given csr can be accessed
  */
@@ -59,33 +82,24 @@ typedef struct {
     csr_clear_func_t clear; /** Clears the bits on position that has a bit set in the given value (writing only to those bits)*/
 } csr_ops_t;
 
-#define minimal_privilege(priv, cpu) \
-    { \
-        if (cpu->priv_mode < priv) \
-            return rv_exc_illegal_instruction; \
-    }
-#define default_csr_functions(csr_name, priv) \
+#define default_csr_functions(csr_name) \
     static rv_exc_t csr_name##_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target) \
     { \
-        minimal_privilege(priv, cpu); \
         *target = cpu->csr.csr_name; \
         return rv_exc_none; \
     } \
     static rv_exc_t csr_name##_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value) \
     { \
-        minimal_privilege(priv, cpu); \
         cpu->csr.csr_name = value; \
         return rv_exc_none; \
     } \
     static rv_exc_t csr_name##_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value) \
     { \
-        minimal_privilege(priv, cpu); \
         cpu->csr.csr_name |= value; \
         return rv_exc_none; \
     } \
     static rv_exc_t csr_name##_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value) \
     { \
-        minimal_privilege(priv, cpu); \
         cpu->csr.csr_name &= ~value; \
         return rv_exc_none; \
     }
@@ -103,6 +117,36 @@ static rv_exc_t invalid_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 #define is_counter_enabled_s(cpu, counter) (cpu->csr.scounteren & (1 << counter))
 #define is_high_counter(csr) (csr & 0x080)
 
+/** Add the cycles pending in the HPM counter with the given index to its value */
+static void hpm_counter_update(rv_cpu_t *cpu, unsigned int i)
+{
+    cpu->csr.hpmcounters[i] = rv_csr_hpm_counter(&cpu->csr, i);
+    cpu->csr.hpm_event_base[i] = cpu->csr.hpm_event_cycles[cpu->csr.hpmevents[i]];
+}
+
+/** Change the event counted by the HPM counter with the given index
+ *
+ * Unknown events are ignored, the counter keeps its previous event.
+ */
+static void hpm_counter_set_event(rv_cpu_t *cpu, unsigned int i, uxlen_t event)
+{
+    if (event >= hpm_event_count) {
+        return;
+    }
+
+    hpm_counter_update(cpu, i);
+    cpu->csr.hpmevents[i] = event;
+    cpu->csr.hpm_event_base[i] = cpu->csr.hpm_event_cycles[event];
+}
+
+/** Update all HPM counters, needed before their inhibition is changed */
+static void hpm_counters_update(rv_cpu_t *cpu)
+{
+    for (unsigned int i = 0; i < 29; i++) {
+        hpm_counter_update(cpu, i);
+    }
+}
+
 static inline void read_counter_csr_unchecked(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
     int counter = csr & 0x1F;
@@ -115,6 +159,7 @@ static inline void read_counter_csr_unchecked(rv_cpu_t *cpu, csr_num_t csr, uxle
         break;
     }
     case (csr_time & 0x1F): {
+        rv_csr_mtime_sample(&cpu->csr);
         *target = EXTRACT_BITS(cpu->csr.mtime, offset, offset + 32);
         break;
     }
@@ -123,7 +168,7 @@ static inline void read_counter_csr_unchecked(rv_cpu_t *cpu, csr_num_t csr, uxle
         break;
     }
     default: {
-        uint64_t hpc = cpu->csr.hpmcounters[counter - 3];
+        uint64_t hpc = rv_csr_hpm_counter(&cpu->csr, counter - 3);
         *target = EXTRACT_BITS(hpc, offset, offset + 32);
         break;
     }
@@ -161,9 +206,6 @@ static rv_exc_t counter_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 static rv_exc_t counter_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
 
-    // only mmode can write to counters
-    minimal_privilege(rv_mmode, cpu);
-
     // global counters are r/o
     if (rv_csr_min_priv_mode(csr) != rv_mmode) {
         return rv_exc_illegal_instruction;
@@ -198,6 +240,7 @@ static rv_exc_t counter_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
         break;
     }
     default: {
+        hpm_counter_update(cpu, counter - 3);
         uint64_t hpc = cpu->csr.hpmcounters[counter - 3];
         cpu->csr.hpmcounters[counter - 3] = (hpc & mask) | val;
         break;
@@ -210,9 +253,6 @@ static rv_exc_t counter_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 static rv_exc_t counter_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
 
-    // only mmode can write to counters
-    minimal_privilege(rv_mmode, cpu);
-
     // global counters are r/o
     if (rv_csr_min_priv_mode(csr) != rv_mmode) {
         return rv_exc_illegal_instruction;
@@ -238,6 +278,7 @@ static rv_exc_t counter_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
         break;
     }
     default: {
+        hpm_counter_update(cpu, counter - 3);
         cpu->csr.hpmcounters[counter - 3] |= val;
         break;
     }
@@ -248,9 +289,6 @@ static rv_exc_t counter_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t counter_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    // only mmode can write to counters
-    minimal_privilege(rv_mmode, cpu);
-
     // global counters are r/o
     if (rv_csr_min_priv_mode(csr) != rv_mmode) {
         return rv_exc_illegal_instruction;
@@ -276,6 +314,7 @@ static rv_exc_t counter_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
         break;
     }
     default: {
+        hpm_counter_update(cpu, counter - 3);
         cpu->csr.hpmcounters[counter - 3] &= ~val;
         break;
     }
@@ -288,35 +327,33 @@ static rv_exc_t counter_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mcountinhibit_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mcountinhibit;
     return rv_exc_none;
 }
 
 static rv_exc_t mcountinhibit_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
+    hpm_counters_update(cpu);
     cpu->csr.mcountinhibit = value & mcountinhibit_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mcountinhibit_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
+    hpm_counters_update(cpu);
     cpu->csr.mcountinhibit |= value & mcountinhibit_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mcountinhibit_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
+    hpm_counters_update(cpu);
     cpu->csr.mcountinhibit &= ~(value & mcountinhibit_mask);
     return rv_exc_none;
 }
 
 static rv_exc_t mhpmevent_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     int event = (csr & 0x1F) - 3;
     *target = cpu->csr.hpmevents[event];
     return rv_exc_none;
@@ -324,38 +361,27 @@ static rv_exc_t mhpmevent_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 
 static rv_exc_t mhpmevent_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     int event = (csr & 0x1F) - 3;
 
-    if (value < hpm_event_count) {
-        cpu->csr.hpmevents[event] = value;
-    }
+    hpm_counter_set_event(cpu, event, value);
     return rv_exc_none;
 }
 
 static rv_exc_t mhpmevent_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     int event = (csr & 0x1F) - 3;
 
-    int val = cpu->csr.hpmevents[event] | value;
-
-    if (val < hpm_event_count) {
-        cpu->csr.hpmevents[event] = val;
-    }
+    uxlen_t val = cpu->csr.hpmevents[event] | value;
+    hpm_counter_set_event(cpu, event, val);
     return rv_exc_none;
 }
 
 static rv_exc_t mhpmevent_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     int event = (csr & 0x1F) - 3;
 
-    int val = cpu->csr.hpmevents[event] & ~value;
-
-    if (val < hpm_event_count) {
-        cpu->csr.hpmevents[event] = val;
-    }
+    uxlen_t val = cpu->csr.hpmevents[event] & ~value;
+    hpm_counter_set_event(cpu, event, val);
 
     return rv_exc_none;
 }
@@ -402,14 +428,12 @@ static rv_exc_t pmpaddr_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t sstatus_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     *target = cpu->csr.mstatus & rv_csr_sstatus_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t sstatus_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
 
     // Masked write of low 32 bits
     // TODO: Reconsider this masking
@@ -419,7 +443,6 @@ static rv_exc_t sstatus_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t sstatus_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     // Masked write
     cpu->csr.mstatus |= (value & rv_csr_sstatus_mask);
     return rv_exc_none;
@@ -427,7 +450,6 @@ static rv_exc_t sstatus_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t sstatus_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     // Masked write
     cpu->csr.mstatus &= ~(value & rv_csr_sstatus_mask);
     return rv_exc_none;
@@ -435,14 +457,12 @@ static rv_exc_t sstatus_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t sie_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     *target = cpu->csr.mie & rv_csr_si_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t sie_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
 
     // write only to si bits, preserve rest
     cpu->csr.mie &= ~rv_csr_si_mask;
@@ -452,21 +472,18 @@ static rv_exc_t sie_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t sie_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.mie |= value & rv_csr_si_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t sie_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.mie &= ~(value & rv_csr_si_mask);
     return rv_exc_none;
 }
 
 static rv_exc_t sip_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
 
     // The SEIP bit is the logical OR of the value in MIP and the status from external interrupt controller
     // Full explanation RISC-V Privileged spec section 3.1.9 Machine Interrupt Registers (mip and mie)
@@ -478,7 +495,6 @@ static rv_exc_t sip_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 
 static rv_exc_t sip_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
 
     // only ssip is writable
     cpu->csr.mip &= ~rv_csr_ssi_mask;
@@ -488,14 +504,12 @@ static rv_exc_t sip_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t sip_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.mip |= value & rv_csr_ssi_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t sip_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.mip &= ~(value & rv_csr_ssi_mask);
     return rv_exc_none;
 }
@@ -504,65 +518,57 @@ static rv_exc_t sip_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t stvec_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     *target = cpu->csr.stvec;
     return rv_exc_none;
 }
 
 static rv_exc_t stvec_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.stvec = value & scvec_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t stvec_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.stvec |= value & scvec_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t stvec_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.stvec &= ~(value & scvec_mask);
     return rv_exc_none;
 }
 
-default_csr_functions(scounteren, rv_smode)
+default_csr_functions(scounteren)
 
 #define senvcfg_mask 0x71
 
         static rv_exc_t senvcfg_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     *target = cpu->csr.senvcfg;
     return rv_exc_none;
 }
 
 static rv_exc_t senvcfg_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.senvcfg = value & senvcfg_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t senvcfg_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.senvcfg |= value & senvcfg_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t senvcfg_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.senvcfg &= ~(value & senvcfg_mask);
     return rv_exc_none;
 }
 
-default_csr_functions(sscratch, rv_smode)
+default_csr_functions(sscratch)
 
 #if XLEN == 32
 #define sepc_mask 0xFFFFFFFC
@@ -572,28 +578,24 @@ default_csr_functions(sscratch, rv_smode)
 
         static rv_exc_t sepc_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     *target = cpu->csr.sepc;
     return rv_exc_none;
 }
 
 static rv_exc_t sepc_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.sepc = value & sepc_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t sepc_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.sepc |= value & sepc_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t sepc_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.sepc &= ~(value & sepc_mask);
     return rv_exc_none;
 }
@@ -608,14 +610,12 @@ static bool is_exception_code(uxlen_t num)
 
 static rv_exc_t scause_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     *target = cpu->csr.scause;
     return rv_exc_none;
 }
 
 static rv_exc_t scause_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
 
     if (is_exception_code(value)) {
         cpu->csr.scause = value;
@@ -628,7 +628,6 @@ static rv_exc_t scause_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t scause_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
 
     uxlen_t val = value | cpu->csr.scause;
     if (is_exception_code(val)) {
@@ -642,7 +641,6 @@ static rv_exc_t scause_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t scause_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
 
     uxlen_t val = ~value & cpu->csr.scause;
     if (is_exception_code(val)) {
@@ -654,11 +652,10 @@ static rv_exc_t scause_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     return rv_exc_none;
 }
 
-default_csr_functions(stval, rv_smode)
+default_csr_functions(stval)
 
         static rv_exc_t satp_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     if (rv_csr_mstatus_tvm(cpu)) {
         return rv_exc_illegal_instruction;
     }
@@ -669,7 +666,6 @@ default_csr_functions(stval, rv_smode)
 
 static rv_exc_t satp_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     if (rv_csr_mstatus_tvm(cpu)) {
         return rv_exc_illegal_instruction;
     }
@@ -691,7 +687,6 @@ static rv_exc_t satp_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t satp_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     if (rv_csr_mstatus_tvm(cpu)) {
         return rv_exc_illegal_instruction;
     }
@@ -713,7 +708,6 @@ static rv_exc_t satp_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t satp_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     if (rv_csr_mstatus_tvm(cpu)) {
         return rv_exc_illegal_instruction;
     }
@@ -733,34 +727,30 @@ static rv_exc_t satp_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     return rv_exc_none;
 }
 
-default_csr_functions(scontext, rv_smode)
+default_csr_functions(scontext)
 
         // Writes to scyclecmp request or unrequest STI (based on the low 32 bits of cycle)
 
         static rv_exc_t scyclecmp_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_smode, cpu);
     *target = cpu->csr.scyclecmp;
     return rv_exc_none;
 }
 
 static rv_exc_t scyclecmp_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.scyclecmp = value;
     cpu->csr.external_STIP = ((uxlen_t) cpu->csr.cycle) >= cpu->csr.scyclecmp;
     return rv_exc_none;
 }
 static rv_exc_t scyclecmp_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.scyclecmp |= value;
     cpu->csr.external_STIP = ((uxlen_t) cpu->csr.cycle) >= cpu->csr.scyclecmp;
     return rv_exc_none;
 }
 static rv_exc_t scyclecmp_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_smode, cpu);
     cpu->csr.scyclecmp &= ~value;
     cpu->csr.external_STIP = ((uxlen_t) cpu->csr.cycle) >= cpu->csr.scyclecmp;
     return rv_exc_none;
@@ -768,49 +758,42 @@ static rv_exc_t scyclecmp_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mvendorid_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mvendorid;
     return rv_exc_none;
 }
 
 static rv_exc_t marchid_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.marchid;
     return rv_exc_none;
 }
 
 static rv_exc_t mimpid_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mimpid;
     return rv_exc_none;
 }
 
 static rv_exc_t mhartid_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mhartid;
     return rv_exc_none;
 }
 
 static rv_exc_t mconfigptr_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mconfigptr;
     return rv_exc_none;
 }
 
 static rv_exc_t mstatus_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = (uxlen_t) cpu->csr.mstatus;
     return rv_exc_none;
 }
 
 static rv_exc_t mstatus_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
 
     uint64_t val = value & rv_csr_mstatus_mask;
 
@@ -828,7 +811,6 @@ static rv_exc_t mstatus_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mstatus_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
 
     value &= rv_csr_mstatus_mask;
 
@@ -846,7 +828,6 @@ static rv_exc_t mstatus_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mstatus_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
 
     value &= rv_csr_mstatus_mask;
     // Masked write
@@ -864,35 +845,30 @@ static rv_exc_t mstatus_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 // Since MBE and SBE are both R/O zero and other bits re WPRI, whole mstatush is R/O zero
 static rv_exc_t mstatush_read(rv_cpu_t *cpu, csr_num_t csr, uint32_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = (uint32_t) (cpu->csr.mstatus >> 32);
     return rv_exc_none;
 }
 
 static rv_exc_t mstatush_write(rv_cpu_t *cpu, csr_num_t csr, uint32_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     // writes to mstatush have no effect
     return rv_exc_none;
 }
 
 static rv_exc_t mstatush_set(rv_cpu_t *cpu, csr_num_t csr, uint32_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     // writes to mstatush have no effect
     return rv_exc_none;
 }
 
 static rv_exc_t mstatush_clear(rv_cpu_t *cpu, csr_num_t csr, uint32_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     // writes to mstatush have no effect
     return rv_exc_none;
 }
 
 static rv_exc_t misa_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.misa;
     return rv_exc_none;
 }
@@ -900,19 +876,16 @@ static rv_exc_t misa_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 // misa writes do nothing, we don't allow the change of extensions or MXLEN
 static rv_exc_t misa_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t misa_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t misa_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
@@ -921,35 +894,30 @@ static rv_exc_t misa_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t medeleg_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.medeleg;
     return rv_exc_none;
 }
 
 static rv_exc_t medeleg_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.medeleg = value & medeleg_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t medeleg_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.medeleg |= value & medeleg_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t medeleg_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.medeleg &= ~(value & medeleg_mask);
     return rv_exc_none;
 }
 
 static rv_exc_t mideleg_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mideleg;
     return rv_exc_none;
 }
@@ -957,56 +925,48 @@ static rv_exc_t mideleg_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 // we allow only smode interrupts to be delegatable
 static rv_exc_t mideleg_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mideleg = value & rv_csr_si_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mideleg_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mideleg |= value & rv_csr_si_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mideleg_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mideleg &= ~(value & rv_csr_si_mask);
     return rv_exc_none;
 }
 
 static rv_exc_t mie_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mie;
     return rv_exc_none;
 }
 
 static rv_exc_t mie_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mie = value & rv_csr_mi_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mie_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mie |= value & rv_csr_mi_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mie_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mie &= ~(value & rv_csr_mi_mask);
     return rv_exc_none;
 }
 
 static rv_exc_t mip_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
 
     // The SEIP bit is the logical OR of the value in MIP and the status from external interrupt controller
     // Full explanation RISC-V Privileged spec section 3.1.9 Machine Interrupt Registers (mip and mie)
@@ -1021,7 +981,6 @@ static rv_exc_t mip_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 
 static rv_exc_t mip_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
 
     cpu->csr.mip = value & mip_mask;
     return rv_exc_none;
@@ -1029,14 +988,12 @@ static rv_exc_t mip_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mip_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mip |= value & mip_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mip_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mip &= ~(value & mip_mask);
     return rv_exc_none;
 }
@@ -1045,47 +1002,41 @@ static rv_exc_t mip_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mtvec_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mtvec;
     return rv_exc_none;
 }
 
 static rv_exc_t mtvec_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mtvec = value & mtvec_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mtvec_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mtvec |= value & mtvec_mask;
     return rv_exc_none;
 }
 
 static rv_exc_t mtvec_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.mtvec &= ~(value & mtvec_mask);
     return rv_exc_none;
 }
 
-default_csr_functions(mcounteren, rv_mmode)
+default_csr_functions(mcounteren)
 
-        default_csr_functions(mscratch, rv_mmode)
-                default_csr_functions(mepc, rv_mmode)
+        default_csr_functions(mscratch)
+                default_csr_functions(mepc)
 
                         static rv_exc_t mcause_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mcause;
     return rv_exc_none;
 }
 
 static rv_exc_t mcause_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     if (is_exception_code(value)) {
         cpu->csr.mcause = value;
     } else {
@@ -1096,7 +1047,6 @@ static rv_exc_t mcause_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mcause_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
 
     uxlen_t val = cpu->csr.mcause | value;
 
@@ -1110,7 +1060,6 @@ static rv_exc_t mcause_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t mcause_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     uxlen_t val = cpu->csr.mcause & ~value;
 
     if (is_exception_code(val)) {
@@ -1121,7 +1070,7 @@ static rv_exc_t mcause_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     return rv_exc_none;
 }
 
-default_csr_functions(mtval, rv_mmode)
+default_csr_functions(mtval)
 
         static rv_exc_t mtinst_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
@@ -1167,14 +1116,12 @@ static rv_exc_t mtval2_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t menvcfg_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = (uxlen_t) cpu->csr.menvcfg;
     return rv_exc_none;
 }
 
 static rv_exc_t menvcfg_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     // TODO: Reconsider this masking
     cpu->csr.menvcfg = (cpu->csr.menvcfg & 0xFFFFFFFF00000000) | (value & menvcfg_fiom_mask);
     return rv_exc_none;
@@ -1182,14 +1129,12 @@ static rv_exc_t menvcfg_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t menvcfg_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     cpu->csr.menvcfg |= (uint64_t) (value & menvcfg_fiom_mask);
     return rv_exc_none;
 }
 
 static rv_exc_t menvcfg_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     // Writing to unwritable fields
     cpu->csr.menvcfg &= ~((uint64_t) (value & menvcfg_fiom_mask));
     return rv_exc_none;
@@ -1197,77 +1142,65 @@ static rv_exc_t menvcfg_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 
 static rv_exc_t menvcfgh_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.menvcfg >> 32;
     return rv_exc_none;
 }
 
 static rv_exc_t menvcfgh_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t menvcfgh_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t menvcfgh_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 // mseccfg(h) do nothing as of now, so they are read-only 0
 static rv_exc_t mseccfg_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = cpu->csr.mseccfg;
     return rv_exc_none;
 }
 
 static rv_exc_t mseccfg_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t mseccfg_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t mseccfg_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t mseccfgh_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target)
 {
-    minimal_privilege(rv_mmode, cpu);
     *target = 0;
     return rv_exc_none;
 }
 
 static rv_exc_t mseccfgh_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t mseccfgh_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t mseccfgh_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
-    minimal_privilege(rv_mmode, cpu);
     return rv_exc_none;
 }
 
@@ -1451,376 +1384,137 @@ static rv_exc_t dscratch1_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     return rv_exc_illegal_instruction;
 }
 
-/** Retrieves the CSR ops for the given csr*/
-static csr_ops_t get_csr_ops(csr_num_t csr)
-{
-    csr_ops_t ops = {
-        .read = invalid_read,
-        .write = invalid_write,
-        .set = invalid_write,
-        .clear = invalid_write
-    };
-
-#define default_case(csr) \
-    case csr_##csr: { \
-        ops.read = csr##_read; \
-        ops.write = csr##_write; \
-        ops.set = csr##_set; \
-        ops.clear = csr##_clear; \
-        break; \
-    }
-
-#define unreachable_case(csr, reason) \
-    case csr_##csr: { \
-        die(ERR_INTERN, "Register " #csr " not available here" reason "."); \
-        break; \
+#define csr_ops(name) \
+    { \
+        .read = name##_read, \
+        .write = name##_write, \
+        .set = name##_set, \
+        .clear = name##_clear \
     }
 
-#define read_only_case(csr) \
-    case csr_##csr: { \
-        ops.read = csr##_read; \
-        ops.write = invalid_write; \
-        ops.set = invalid_write; \
-        ops.clear = invalid_write; \
-        break; \
+#define read_only_csr_ops(name) \
+    { \
+        .read = name##_read, \
+        .write = invalid_write, \
+        .set = invalid_write, \
+        .clear = invalid_write \
     }
 
-    switch (csr) {
-    case (csr_cycle):
-    case (csr_time):
-    case (csr_instret):
-    case (csr_hpmcounter3):
-    case (csr_hpmcounter4):
-    case (csr_hpmcounter5):
-    case (csr_hpmcounter6):
-    case (csr_hpmcounter7):
-    case (csr_hpmcounter8):
-    case (csr_hpmcounter9):
-    case (csr_hpmcounter10):
-    case (csr_hpmcounter11):
-    case (csr_hpmcounter12):
-    case (csr_hpmcounter13):
-    case (csr_hpmcounter14):
-    case (csr_hpmcounter15):
-    case (csr_hpmcounter16):
-    case (csr_hpmcounter17):
-    case (csr_hpmcounter18):
-    case (csr_hpmcounter19):
-    case (csr_hpmcounter20):
-    case (csr_hpmcounter21):
-    case (csr_hpmcounter22):
-    case (csr_hpmcounter23):
-    case (csr_hpmcounter24):
-    case (csr_hpmcounter25):
-    case (csr_hpmcounter26):
-    case (csr_hpmcounter27):
-    case (csr_hpmcounter28):
-    case (csr_hpmcounter29):
-    case (csr_hpmcounter30):
-    case (csr_hpmcounter31):
-    case (csr_cycleh):
-    case (csr_timeh):
-    case (csr_instreth):
-    case (csr_hpmcounter3h):
-    case (csr_hpmcounter4h):
-    case (csr_hpmcounter5h):
-    case (csr_hpmcounter6h):
-    case (csr_hpmcounter7h):
-    case (csr_hpmcounter8h):
-    case (csr_hpmcounter9h):
-    case (csr_hpmcounter10h):
-    case (csr_hpmcounter11h):
-    case (csr_hpmcounter12h):
-    case (csr_hpmcounter13h):
-    case (csr_hpmcounter14h):
-    case (csr_hpmcounter15h):
-    case (csr_hpmcounter16h):
-    case (csr_hpmcounter17h):
-    case (csr_hpmcounter18h):
-    case (csr_hpmcounter19h):
-    case (csr_hpmcounter20h):
-    case (csr_hpmcounter21h):
-    case (csr_hpmcounter22h):
-    case (csr_hpmcounter23h):
-    case (csr_hpmcounter24h):
-    case (csr_hpmcounter25h):
-    case (csr_hpmcounter26h):
-    case (csr_hpmcounter27h):
-    case (csr_hpmcounter28h):
-    case (csr_hpmcounter29h):
-    case (csr_hpmcounter30h):
-    case (csr_hpmcounter31h):
-    case (csr_mcycle):
-    case (csr_minstret):
-    case (csr_mhpmcounter3):
-    case (csr_mhpmcounter4):
-    case (csr_mhpmcounter5):
-    case (csr_mhpmcounter6):
-    case (csr_mhpmcounter7):
-    case (csr_mhpmcounter8):
-    case (csr_mhpmcounter9):
-    case (csr_mhpmcounter10):
-    case (csr_mhpmcounter11):
-    case (csr_mhpmcounter12):
-    case (csr_mhpmcounter13):
-    case (csr_mhpmcounter14):
-    case (csr_mhpmcounter15):
-    case (csr_mhpmcounter16):
-    case (csr_mhpmcounter17):
-    case (csr_mhpmcounter18):
-    case (csr_mhpmcounter19):
-    case (csr_mhpmcounter20):
-    case (csr_mhpmcounter21):
-    case (csr_mhpmcounter22):
-    case (csr_mhpmcounter23):
-    case (csr_mhpmcounter24):
-    case (csr_mhpmcounter25):
-    case (csr_mhpmcounter26):
-    case (csr_mhpmcounter27):
-    case (csr_mhpmcounter28):
-    case (csr_mhpmcounter29):
-    case (csr_mhpmcounter30):
-    case (csr_mhpmcounter31):
-    case (csr_mcycleh):
-    case (csr_minstreth):
-    case (csr_mhpmcounter3h):
-    case (csr_mhpmcounter4h):
-    case (csr_mhpmcounter5h):
-    case (csr_mhpmcounter6h):
-    case (csr_mhpmcounter7h):
-    case (csr_mhpmcounter8h):
-    case (csr_mhpmcounter9h):
-    case (csr_mhpmcounter10h):
-    case (csr_mhpmcounter11h):
-    case (csr_mhpmcounter12h):
-    case (csr_mhpmcounter13h):
-    case (csr_mhpmcounter14h):
-    case (csr_mhpmcounter15h):
-    case (csr_mhpmcounter16h):
-    case (csr_mhpmcounter17h):
-    case (csr_mhpmcounter18h):
-    case (csr_mhpmcounter19h):
-    case (csr_mhpmcounter20h):
-    case (csr_mhpmcounter21h):
-    case (csr_mhpmcounter22h):
-    case (csr_mhpmcounter23h):
-    case (csr_mhpmcounter24h):
-    case (csr_mhpmcounter25h):
-    case (csr_mhpmcounter26h):
-    case (csr_mhpmcounter27h):
-    case (csr_mhpmcounter28h):
-    case (csr_mhpmcounter29h):
-    case (csr_mhpmcounter30h):
-    case (csr_mhpmcounter31h): {
-        ops.read = counter_read;
-        ops.write = counter_write;
-        ops.set = counter_set;
-        ops.clear = counter_clear;
-        break;
-    }
+#define default_entry(csr) [csr_##csr] = csr_ops(csr)
+#define read_only_entry(csr) [csr_##csr] = read_only_csr_ops(csr)
 
-    case (csr_mhpmevent3):
-    case (csr_mhpmevent4):
-    case (csr_mhpmevent5):
-    case (csr_mhpmevent6):
-    case (csr_mhpmevent7):
-    case (csr_mhpmevent8):
-    case (csr_mhpmevent9):
-    case (csr_mhpmevent10):
-    case (csr_mhpmevent11):
-    case (csr_mhpmevent12):
-    case (csr_mhpmevent13):
-    case (csr_mhpmevent14):
-    case (csr_mhpmevent15):
-    case (csr_mhpmevent16):
-    case (csr_mhpmevent17):
-    case (csr_mhpmevent18):
-    case (csr_mhpmevent19):
-    case (csr_mhpmevent20):
-    case (csr_mhpmevent21):
-    case (csr_mhpmevent22):
-    case (csr_mhpmevent23):
-    case (csr_mhpmevent24):
-    case (csr_mhpmevent25):
-    case (csr_mhpmevent26):
-    case (csr_mhpmevent27):
-    case (csr_mhpmevent28):
-    case (csr_mhpmevent29):
-    case (csr_mhpmevent30):
-    case (csr_mhpmevent31): {
-        ops.read = mhpmevent_read;
-        ops.write = mhpmevent_write;
-        ops.set = mhpmevent_set;
-        ops.clear = mhpmevent_clear;
-        break;
-    }
+/**
+ * Operations of all CSRs indexed by the CSR number
+ *
+ * The entries of the CSRs which are not implemented are left empty.
+ */
+static const csr_ops_t csr_ops_table[0x1000] = {
+    [csr_cycle ... csr_hpmcounter31] = csr_ops(counter),
+    [csr_cycleh ... csr_hpmcounter31h] = csr_ops(counter),
+    [csr_mcycle] = csr_ops(counter),
+    [csr_minstret ... csr_mhpmcounter31] = csr_ops(counter),
+    [csr_mcycleh] = csr_ops(counter),
+    [csr_minstreth ... csr_mhpmcounter31h] = csr_ops(counter),
+    [csr_mhpmevent3 ... csr_mhpmevent31] = csr_ops(mhpmevent),
+    [csr_pmpcfg0 ... csr_pmpcfg15] = csr_ops(pmpcfg),
+    [csr_pmpaddr0 ... csr_pmpaddr63] = csr_ops(pmpaddr),
+
+    default_entry(mcountinhibit),
+
+    default_entry(sstatus),
+
+    default_entry(sie),
+    default_entry(stvec),
+    default_entry(scounteren),
+
+    default_entry(senvcfg),
+
+    default_entry(sscratch),
+    default_entry(sepc),
+    default_entry(scause),
+    default_entry(stval),
+    default_entry(sip),
+    default_entry(satp),
+    default_entry(scontext),
+    default_entry(scyclecmp),
+
+    read_only_entry(mvendorid),
+    read_only_entry(marchid),
+    read_only_entry(mimpid),
+    read_only_entry(mhartid),
+    read_only_entry(mconfigptr),
+
+    default_entry(mstatus),
+#if XLEN == 32
+    default_entry(mstatush),
+#endif
 
-    case (csr_pmpcfg0):
-    case (csr_pmpcfg1):
-    case (csr_pmpcfg2):
-    case (csr_pmpcfg3):
-    case (csr_pmpcfg4):
-    case (csr_pmpcfg5):
-    case (csr_pmpcfg6):
-    case (csr_pmpcfg7):
-    case (csr_pmpcfg8):
-    case (csr_pmpcfg9):
-    case (csr_pmpcfg10):
-    case (csr_pmpcfg11):
-    case (csr_pmpcfg12):
-    case (csr_pmpcfg13):
-    case (csr_pmpcfg14):
-    case (csr_pmpcfg15): {
-        ops.read = pmpcfg_read;
-        ops.write = pmpcfg_write;
-        ops.set = pmpcfg_set;
-        ops.clear = pmpcfg_clear;
-        break;
-    }
+    default_entry(misa),
+    default_entry(medeleg),
+    default_entry(mideleg),
+    default_entry(mie),
+    default_entry(mtvec),
+    default_entry(mcounteren),
+
+    default_entry(mscratch),
+    default_entry(mepc),
+    default_entry(mcause),
+    default_entry(mtval),
+    default_entry(mip),
+    default_entry(mtinst),
+    default_entry(mtval2),
+
+    default_entry(menvcfg),
+    default_entry(menvcfgh),
+    default_entry(mseccfg),
+    default_entry(mseccfgh),
+
+    default_entry(tselect),
+    default_entry(tdata1),
+    default_entry(tdata2),
+    default_entry(tdata3),
+    default_entry(mcontext),
+    default_entry(dcsr),
+    default_entry(dpc),
+    default_entry(dscratch0),
+    default_entry(dscratch1),
+};
+
+#undef default_entry
+#undef read_only_entry
+#undef csr_ops
+#undef read_only_csr_ops
+
+/** Operations of the CSRs which cannot be accessed */
+static const csr_ops_t invalid_csr_ops = {
+    .read = invalid_read,
+    .write = invalid_write,
+    .set = invalid_write,
+    .clear = invalid_write
+};
 
-    case (csr_pmpaddr0):
-    case (csr_pmpaddr1):
-    case (csr_pmpaddr2):
-    case (csr_pmpaddr3):
-    case (csr_pmpaddr4):
-    case (csr_pmpaddr5):
-    case (csr_pmpaddr6):
-    case (csr_pmpaddr7):
-    case (csr_pmpaddr8):
-    case (csr_pmpaddr9):
-    case (csr_pmpaddr10):
-    case (csr_pmpaddr11):
-    case (csr_pmpaddr12):
-    case (csr_pmpaddr13):
-    case (csr_pmpaddr14):
-    case (csr_pmpaddr15):
-    case (csr_pmpaddr16):
-    case (csr_pmpaddr17):
-    case (csr_pmpaddr18):
-    case (csr_pmpaddr19):
-    case (csr_pmpaddr20):
-    case (csr_pmpaddr21):
-    case (csr_pmpaddr22):
-    case (csr_pmpaddr23):
-    case (csr_pmpaddr24):
-    case (csr_pmpaddr25):
-    case (csr_pmpaddr26):
-    case (csr_pmpaddr27):
-    case (csr_pmpaddr28):
-    case (csr_pmpaddr29):
-    case (csr_pmpaddr30):
-    case (csr_pmpaddr31):
-    case (csr_pmpaddr32):
-    case (csr_pmpaddr33):
-    case (csr_pmpaddr34):
-    case (csr_pmpaddr35):
-    case (csr_pmpaddr36):
-    case (csr_pmpaddr37):
-    case (csr_pmpaddr38):
-    case (csr_pmpaddr39):
-    case (csr_pmpaddr40):
-    case (csr_pmpaddr41):
-    case (csr_pmpaddr42):
-    case (csr_pmpaddr43):
-    case (csr_pmpaddr44):
-    case (csr_pmpaddr45):
-    case (csr_pmpaddr46):
-    case (csr_pmpaddr47):
-    case (csr_pmpaddr48):
-    case (csr_pmpaddr49):
-    case (csr_pmpaddr50):
-    case (csr_pmpaddr51):
-    case (csr_pmpaddr52):
-    case (csr_pmpaddr53):
-    case (csr_pmpaddr54):
-    case (csr_pmpaddr55):
-    case (csr_pmpaddr56):
-    case (csr_pmpaddr57):
-    case (csr_pmpaddr58):
-    case (csr_pmpaddr59):
-    case (csr_pmpaddr60):
-    case (csr_pmpaddr61):
-    case (csr_pmpaddr62):
-    case (csr_pmpaddr63): {
-        ops.read = pmpaddr_read;
-        ops.write = pmpaddr_write;
-        ops.set = pmpaddr_set;
-        ops.clear = pmpaddr_clear;
-        break;
-    }
+/**
+ * @brief Whether the given CSR is implemented
+ */
+static bool rv_csr_implemented(csr_num_t csr)
+{
+    return (csr < 0x1000) && (csr_ops_table[csr].read != NULL);
+}
 
-        // clang-format off
-
-    default_case(mcountinhibit)
-
-    default_case(sstatus)
-
-    default_case(sie)
-    default_case(stvec)
-    default_case(scounteren)
-
-    default_case(senvcfg)
-
-    default_case(sscratch)
-    default_case(sepc)
-    default_case(scause)
-    default_case(stval)
-    default_case(sip)
-    default_case(satp)
-    default_case(scontext)
-    default_case(scyclecmp)
-
-    read_only_case(mvendorid)
-    read_only_case(marchid)
-    read_only_case(mimpid)
-    read_only_case(mhartid)
-    read_only_case(mconfigptr)
-
-    default_case(mstatus)
-    #if XLEN == 32
-    default_case(mstatush)
-    #else
-    unreachable_case(mstatush, " (XLEN is " STRINGIFY(XLEN) ")")
-    #endif
-
-
-    default_case(misa)
-    default_case(medeleg)
-    default_case(mideleg)
-    default_case(mie)
-    default_case(mtvec)
-    default_case(mcounteren)
-
-    default_case(mscratch)
-    default_case(mepc)
-    default_case(mcause)
-    default_case(mtval)
-    default_case(mip)
-    default_case(mtinst)
-    default_case(mtval2)
-
-    default_case(menvcfg)
-    default_case(menvcfgh)
-    default_case(mseccfg)
-    default_case(mseccfgh)
-
-    default_case(tselect)
-    default_case(tdata1)
-    default_case(tdata2)
-    default_case(tdata3)
-    default_case(mcontext)
-    default_case(dcsr)
-    default_case(dpc)
-    default_case(dscratch0)
-    default_case(dscratch1)
-
-        // clang-format on
+/**
+ * @brief Retrieves the CSR ops for the given csr
+ *
+ * CSRs which are not implemented or not accessible
+ * from the current privilege mode get the ops which
+ * raise the illegal instruction exception.
+ */
+static const csr_ops_t *get_csr_ops(rv_cpu_t *cpu, csr_num_t csr)
+{
+    if (!rv_csr_implemented(csr) || (cpu->priv_mode < rv_csr_min_priv_mode(csr))) {
+        return &invalid_csr_ops;
     }
 
-    return ops;
-
-#undef default_case
-#undef read_only_case
+    return &csr_ops_table[csr];
 }
 
 /**
@@ -1835,16 +1529,16 @@ static csr_ops_t get_csr_ops(csr_num_t csr)
  */
 static rv_exc_t rv_csr_rw(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *read_target, bool read)
 {
-    csr_ops_t ops = get_csr_ops(csr);
+    const csr_ops_t *ops = get_csr_ops(cpu, csr);
     rv_exc_t ex = rv_exc_none;
     uxlen_t temp_read_target = 0;
 
     if (read) {
-        ex = ops.read(cpu, csr, &temp_read_target);
+        ex = ops->read(cpu, csr, &temp_read_target);
     }
 
     if (ex == rv_exc_none) {
-        ex = ops.write(cpu, csr, value);
+        ex = ops->write(cpu, csr, value);
     }
 
     if (ex == rv_exc_none) {
@@ -1866,14 +1560,14 @@ static rv_exc_t rv_csr_rw(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *
  */
 static rv_exc_t rv_csr_rs(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *read_target, bool write)
 {
-    csr_ops_t ops = get_csr_ops(csr);
+    const csr_ops_t *ops = get_csr_ops(cpu, csr);
 
     uxlen_t temp_read_target = 0;
 
-    rv_exc_t ex = ops.read(cpu, csr, &temp_read_target);
+    rv_exc_t ex = ops->read(cpu, csr, &temp_read_target);
 
     if (ex == rv_exc_none && write) {
-        ex = ops.set(cpu, csr, value);
+        ex = ops->set(cpu, csr, value);
     }
 
     if (ex == rv_exc_none) {
@@ -1896,12 +1590,12 @@ static rv_exc_t rv_csr_rs(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *
 static rv_exc_t rv_csr_rc(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *read_target, bool write)
 {
 
-    csr_ops_t ops = get_csr_ops(csr);
+    const csr_ops_t *ops = get_csr_ops(cpu, csr);
     uxlen_t temp_read_target = 0;
-    rv_exc_t ex = ops.read(cpu, csr, &temp_read_target);
+    rv_exc_t ex = ops->read(cpu, csr, &temp_read_target);
 
     if (ex == rv_exc_none && write) {
-        ex = ops.clear(cpu, csr, value);
+        ex = ops->clear(cpu, csr, value);
     }
 
     if (ex == rv_exc_none) {
@@ -16,6 +16,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "../../../utils.h"
 #include "exception.h"
 #include "types.h"
 
@@ -380,6 +381,21 @@ typedef enum {
     hpm_event_count // Last enum member holding the count
 } rv_csr_hpm_event_t;
 
+/**
+ * Sources of the mtime register
+ */
+typedef enum {
+    rv_mtime_host, // Host time in milliseconds, sampled periodically and on access
+    rv_mtime_cycles, // Derived from the number of cycles
+    rv_mtime_skip // Derived from the number of cycles, skips to mtimecmp in WFI
+} rv_mtime_source_t;
+
+/** Default number of cycles between samples of the host time */
+#define RV_MTIME_HOST_PERIOD 1024
+
+/** Default number of cycles per tick of mtime derived from the cycles */
+#define RV_MTIME_CYCLES_PERIOD 1000
+
 /**
  * Structure holding CSR data
  */
@@ -393,6 +409,12 @@ typedef struct {
     /* Event selectors */
     uxlen_t hpmevents[29];
 
+    /* Cycles spent in the condition of each HPM event */
+    uint64_t hpm_event_cycles[hpm_event_count];
+
+    /* Cycles of the counter event when the counter was last updated */
+    uint64_t hpm_event_base[29];
+
     /* Machine-level registers */
 
     /* information */
@@ -467,6 +489,12 @@ typedef struct {
     uint64_t mtime;
     // The timestamp of the last clock cycle
     uint64_t last_tick_time;
+    // Source of mtime
+    rv_mtime_source_t mtime_source;
+    // Cycles between samples of the host time or between mtime ticks
+    uint64_t mtime_period;
+    // Cycles since the last sample of the host time or the last mtime tick
+    uint64_t mtime_cycles;
     // Value of memory-mapped register mtimecmp
     uint64_t mtimecmp;
 
@@ -480,6 +508,39 @@ typedef struct {
 
 } rv_csr_t;
 
+/** Current value of the HPM counter with the given index
+ *
+ * The HPM counters are not increased on every cycle, the cycles spent
+ * in the condition of the counter event since the counter was last
+ * updated are added when the value is needed.
+ *
+ */
+static inline uint64_t rv_csr_hpm_counter(const rv_csr_t *csr, unsigned int i)
+{
+    if (csr->mcountinhibit & (UINT32_C(1) << (i + 3))) {
+        return csr->hpmcounters[i];
+    }
+
+    return csr->hpmcounters[i] + csr->hpm_event_cycles[csr->hpmevents[i]] - csr->hpm_event_base[i];
+}
+
+/** Account the cycles spent in the given privilege mode to the HPM events */
+static inline void rv_csr_hpm_account(rv_csr_t *csr, rv_priv_mode_t priv_mode, bool standby, uint64_t cycles)
+{
+    static const rv_csr_hpm_event_t priv_mode_events[] = {
+        [rv_umode] = hpm_u_cycles,
+        [rv_smode] = hpm_s_cycles,
+        [0b10] = hpm_r_cycles,
+        [rv_mmode] = hpm_m_cycles
+    };
+
+    csr->hpm_event_cycles[priv_mode_events[priv_mode]] += cycles;
+
+    if (standby) {
+        csr->hpm_event_cycles[hpm_w_cycles] += cycles;
+    }
+}
+
 #define RV_START_ADDRESS XLEN_C(0xF0000000)
 #define RV_MTIME_ADDRESS XLEN_C(0xFF000000)
 #define RV_MTIMECMP_ADDRESS XLEN_C(0xFF000008)
@@ -613,4 +674,70 @@ typedef struct {
 
 #define rv_csr_is_read_only(csr) (((csr) >> 30) == 0b11)
 
+/** Advance mtime to the current host time */
+static inline void rv_csr_mtime_sample(rv_csr_t *csr)
+{
+    if (csr->mtime_source == rv_mtime_host) {
+        uint64_t current_tick_time = current_timestamp();
+        csr->mtime += current_tick_time - csr->last_tick_time;
+        csr->last_tick_time = current_tick_time;
+        csr->mtime_cycles = 0;
+    }
+}
+
+/** Advance mtime by the given number of cycles
+ *
+ * The host time is sampled once per period, the time derived from
+ * the cycles ticks once per period.
+ *
+ */
+static inline void rv_csr_mtime_account(rv_csr_t *csr, uint64_t cycles)
+{
+    csr->mtime_cycles += cycles;
+
+    if (csr->mtime_cycles < csr->mtime_period) {
+        return;
+    }
+
+    if (csr->mtime_source == rv_mtime_host) {
+        rv_csr_mtime_sample(csr);
+    } else {
+        csr->mtime += csr->mtime_cycles / csr->mtime_period;
+        csr->mtime_cycles %= csr->mtime_period;
+    }
+}
+
+/** Number of cycles until mtime derived from the cycles reaches mtimecmp
+ *
+ * @returns The number of cycles, at most limit (also if mtime does
+ *          not depend on the cycles or has already reached mtimecmp)
+ *
+ */
+static inline uint64_t rv_csr_mtime_cycles_left(const rv_csr_t *csr, uint64_t limit)
+{
+    if ((csr->mtime_source == rv_mtime_host) || (csr->mtime >= csr->mtimecmp)) {
+        return limit;
+    }
+
+    uint64_t ticks = csr->mtimecmp - csr->mtime;
+    uint64_t next_tick = csr->mtime_period - csr->mtime_cycles;
+
+    if (ticks - 1 > limit / csr->mtime_period) {
+        return limit;
+    }
+
+    return MIN((ticks - 1) * csr->mtime_period + next_tick, limit);
+}
+
+/** Skip the time of waiting for the timer interrupt in the skip mode */
+static inline void rv_csr_mtime_skip(rv_csr_t *csr)
+{
+    if ((csr->mtime_source == rv_mtime_skip)
+            && (csr->mie & rv_csr_mti_mask)
+            && (csr->mtime < csr->mtimecmp)) {
+        csr->mtime = csr->mtimecmp;
+        csr->mtime_cycles = 0;
+    }
+}
+
 #endif // RISCV_RV_CSR_H_
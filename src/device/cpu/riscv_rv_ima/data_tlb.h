@@ -0,0 +1,67 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  RISC-V data access cache
+ *
+ *  Remembers the host memory of recently accessed virtual pages,
+ *  so that loads and stores to plain memory skip the address
+ *  translation and the physical memory lookup.
+ *
+ */
+
+#ifndef RISCV_RV_DATA_TLB_H_
+#define RISCV_RV_DATA_TLB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../../physmem.h"
+#include "exception.h"
+
+/** Number of the entries for each access type (power of 2) */
+#define RV_DATA_TLB_SIZE 64
+
+/** Virtual page number of an unused entry */
+#define RV_DATA_TLB_INVALID UINT64_MAX
+
+/** Translation of a virtual page to a memory frame */
+typedef struct {
+    /** Virtual page number */
+    uint64_t vpn;
+
+    /** Frame the page is translated to */
+    frame_t *frame;
+
+    /** TLB entry of the translation (NULL if not translated by the TLB) */
+    void *tlb_entry;
+} rv_data_tlb_entry_t;
+
+/** Direct-mapped data access cache of a processor
+ *
+ * The entries are valid only in the translation context they were
+ * added in, any change of the context drops all of them.
+ *
+ */
+typedef struct {
+    rv_data_tlb_entry_t read[RV_DATA_TLB_SIZE];
+    rv_data_tlb_entry_t write[RV_DATA_TLB_SIZE];
+
+    /** Translation context of the entries */
+    rv_priv_mode_t priv_mode;
+    uint64_t satp;
+    uint64_t mstatus;
+    unsigned int tlb_generation;
+    unsigned int frame_generation;
+} rv_data_tlb_t;
+
+/** Drop all entries of the data access cache */
+static inline void rv_data_tlb_clear(rv_data_tlb_t *data_tlb)
+{
+    for (size_t i = 0; i < RV_DATA_TLB_SIZE; i++) {
+        data_tlb->read[i].vpn = RV_DATA_TLB_INVALID;
+        data_tlb->write[i].vpn = RV_DATA_TLB_INVALID;
+    }
+}
+
+#endif // RISCV_RV_DATA_TLB_H_
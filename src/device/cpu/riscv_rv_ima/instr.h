@@ -14,6 +14,7 @@
 #define RISCV_RV_INSTR_H_
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "../../../utils.h"
@@ -231,4 +232,28 @@ typedef enum {
 
 typedef enum rv_exc (*rv_instr_func_t)(rv_cpu_t *, rv_instr_t);
 
+/**
+ * @brief Whether the instruction ends a block of instructions executed at once
+ *
+ * Only instructions which neither change the control flow nor the privilege
+ * or translation context nor write to memory may be followed by another
+ * instruction of the same block. Loads are allowed, but the block has to be
+ * ended early if a page walk of a load modifies the code page.
+ */
+static inline bool rv_instr_ends_block(rv_instr_t instr)
+{
+    switch (instr.r.opcode) {
+    case rv_opcLOAD:
+    case rv_opcOP_IMM:
+    case rv_opcOP_IMM_32:
+    case rv_opcAUIPC:
+    case rv_opcOP:
+    case rv_opcOP_32:
+    case rv_opcLUI:
+        return false;
+    default:
+        return true;
+    }
+}
+
 #endif // RISCV_RV_INSTR_H_
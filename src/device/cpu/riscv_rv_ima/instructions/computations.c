@@ -27,6 +27,8 @@ rv_exc_t rv_write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool noisy);
 rv_exc_t rv_write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool noisy);
 rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool noisy);
 rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool noisy);
+bool rv_cas_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t expected, uint32_t value);
+bool rv_cas_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t expected, uint64_t value);
 rv_exc_t rv_convert_addr(rv_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr, bool fetch, bool noisy);
 
 /******
@@ -757,19 +759,19 @@ static rv_exc_t rv_amoswap_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 
     uxlen_t virt = cpu->regs[instr.r.rs1];
 
-    // Check write privileges first
     throw_if_wrong_privilege(cpu, virt);
-    // Then alignment
     throw_if_misaligned_word(cpu, virt);
 
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
     uint32_t val;
 
-    rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
-
-    ex = rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr.r.rs2], true);
-    ASSERT(ex == rv_exc_none);
+    // load from mem, swap rs2 in and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, rs2));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
     return rv_exc_none;
 }
@@ -785,14 +787,16 @@ static rv_exc_t rv_amoswap_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
     uint64_t val;
 
-    rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
-
-    ex = rv_write_mem64(cpu, virt, cpu->regs[instr.r.rs2], true);
-    ASSERT(ex == rv_exc_none);
+    // load from mem, swap rs2 in and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, rs2));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = val;
     return rv_exc_none;
 }
@@ -804,20 +808,18 @@ static rv_exc_t rv_amoadd_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
     uint32_t val;
-    // load from mem
-    rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
+
+    // load from mem, add rs2 to it and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, val + rs2));
 
     // save loaded value to rd
     cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    // add with rs2
-    val += (uint32_t) cpu->regs[instr.r.rs2];
-
-    //  write to mem
-    ex = rv_write_mem32(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -828,20 +830,18 @@ static rv_exc_t rv_amoadd_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
     uint64_t val;
-    // load from mem
-    rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
+
+    // load from mem, add rs2 to it and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, val + rs2));
 
     // save loaded value to rd
     cpu->regs[instr.r.rd] = val;
-    // add with rs2
-    val += cpu->regs[instr.r.rs2];
-
-    //  write to mem
-    ex = rv_write_mem64(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    return rv_exc_none;
 }
 
 static rv_exc_t rv_amoxor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
@@ -851,16 +851,18 @@ static rv_exc_t rv_amoxor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
     uint32_t val;
-    rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    val ^= (uint32_t) cpu->regs[instr.r.rs2];
-    ex = rv_write_mem32(cpu, virt, val, true);
+    // load from mem, xor it with rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, val ^ rs2));
 
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -871,16 +873,18 @@ static rv_exc_t rv_amoxor_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
     uint64_t val;
-    rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    val ^= cpu->regs[instr.r.rs2];
-    ex = rv_write_mem64(cpu, virt, val, true);
+    // load from mem, xor it with rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, val ^ rs2));
 
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = val;
+    return rv_exc_none;
 }
 
 static rv_exc_t rv_amoand_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
@@ -890,16 +894,18 @@ static rv_exc_t rv_amoand_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
     uint32_t val;
-    rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    val &= (uint32_t) cpu->regs[instr.r.rs2];
+    // load from mem, and it with rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, val & rs2));
 
-    ex = rv_write_mem32(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -913,19 +919,18 @@ static rv_exc_t rv_amoand_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
     uint64_t val;
 
-    rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
+    // load from mem, and it with rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, val & rs2));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = val;
-
-    val &= cpu->regs[instr.r.rs2];
-
-    ex = rv_write_mem64(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-
-    return ex;
+    return rv_exc_none;
 }
 
 static rv_exc_t rv_amoor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
@@ -935,16 +940,18 @@ static rv_exc_t rv_amoor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
     uint32_t val;
-    rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    val |= (uint32_t) cpu->regs[instr.r.rs2];
+    // load from mem, or it with rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, val | rs2));
 
-    ex = rv_write_mem32(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -958,19 +965,18 @@ static rv_exc_t rv_amoor_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
     uint64_t val;
 
-    rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
+    // load from mem, or it with rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, val | rs2));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = val;
-
-    val |= cpu->regs[instr.r.rs2];
-
-    ex = rv_write_mem64(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-
-    return ex;
+    return rv_exc_none;
 }
 
 static rv_exc_t rv_amomin_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
@@ -980,17 +986,18 @@ static rv_exc_t rv_amomin_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
-    int32_t val;
-    rv_exc_t ex = rv_read_mem32(cpu, virt, (uint32_t *) &val, false, true);
-    ASSERT(ex == rv_exc_none);
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
+    uint32_t val;
+
+    // load from mem, take the minimum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, ((int32_t) rs2 < (int32_t) val) ? rs2 : val));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    int32_t rs2 = (int32_t) cpu->regs[instr.r.rs2];
-    val = rs2 < val ? rs2 : val;
-
-    ex = rv_write_mem32(cpu, virt, (uint32_t) val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -1004,17 +1011,18 @@ static rv_exc_t rv_amomin_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
-    int64_t val;
-    rv_exc_t ex = rv_read_mem64(cpu, virt, (uint64_t *) &val, false, true);
-    ASSERT(ex == rv_exc_none);
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
+    uint64_t val;
+
+    // load from mem, take the minimum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, ((int64_t) rs2 < (int64_t) val) ? rs2 : val));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = val;
-    int64_t rs2 = (int64_t) cpu->regs[instr.r.rs2];
-    val = rs2 < val ? rs2 : val;
-
-    ex = rv_write_mem64(cpu, virt, (uint64_t) val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    return rv_exc_none;
 }
 
 static rv_exc_t rv_amomax_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
@@ -1024,17 +1032,18 @@ static rv_exc_t rv_amomax_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
-    int32_t val;
-    rv_exc_t ex = rv_read_mem32(cpu, virt, (uint32_t *) &val, false, true);
-    ASSERT(ex == rv_exc_none);
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
+    uint32_t val;
+
+    // load from mem, take the maximum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, ((int32_t) rs2 > (int32_t) val) ? rs2 : val));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    int32_t rs2 = (int32_t) cpu->regs[instr.r.rs2];
-    val = rs2 > val ? rs2 : val;
-
-    ex = rv_write_mem32(cpu, virt, (uint32_t) val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -1045,17 +1054,18 @@ static rv_exc_t rv_amomax_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
-    int64_t val;
-    rv_exc_t ex = rv_read_mem64(cpu, virt, (uint64_t *) &val, false, true);
-    ASSERT(ex == rv_exc_none);
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
+    uint64_t val;
+
+    // load from mem, take the maximum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, ((int64_t) rs2 > (int64_t) val) ? rs2 : val));
 
+    // save loaded value to rd
     cpu->regs[instr.r.rd] = val;
-    int64_t rs2 = (int64_t) cpu->regs[instr.r.rs2];
-    val = rs2 > val ? rs2 : val;
-
-    ex = rv_write_mem64(cpu, virt, (uint64_t) val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    return rv_exc_none;
 }
 
 static rv_exc_t rv_amominu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
@@ -1065,17 +1075,18 @@ static rv_exc_t rv_amominu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
     uint32_t val;
-    rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = zero_extend_32_to_xlen(val, XLEN);
-    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
-    val = rs2 < val ? rs2 : val;
+    // load from mem, take the unsigned minimum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, (rs2 < val) ? rs2 : val));
 
-    ex = rv_write_mem32(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = zero_extend_32_to_xlen(val, XLEN);
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -1089,17 +1100,18 @@ static rv_exc_t rv_amominu_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
     uint64_t val;
-    rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    uint64_t rs2 = cpu->regs[instr.r.rs2];
-    val = rs2 < val ? rs2 : val;
+    // load from mem, take the unsigned minimum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, (rs2 < val) ? rs2 : val));
 
-    ex = rv_write_mem64(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = val;
+    return rv_exc_none;
 }
 
 static rv_exc_t rv_amomaxu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
@@ -1109,17 +1121,18 @@ static rv_exc_t rv_amomaxu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
 
+    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
     uint32_t val;
-    rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = zero_extend_32_to_xlen(val, XLEN);
-    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
-    val = rs2 > val ? rs2 : val;
+    // load from mem, take the unsigned maximum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem32(cpu, virt, val, (rs2 > val) ? rs2 : val));
 
-    ex = rv_write_mem32(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = zero_extend_32_to_xlen(val, XLEN);
+    return rv_exc_none;
 }
 
 /** RV64 ONLY */
@@ -1133,15 +1146,16 @@ static rv_exc_t rv_amomaxu_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
 
+    uint64_t rs2 = cpu->regs[instr.r.rs2];
     uint64_t val;
-    rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
-    ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    uint64_t rs2 = cpu->regs[instr.r.rs2];
-    val = rs2 > val ? rs2 : val;
+    // load from mem, take the unsigned maximum of it and rs2 and write to mem (again if it changed meanwhile)
+    do {
+        rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
+        ASSERT(ex == rv_exc_none);
+    } while (!rv_cas_mem64(cpu, virt, val, (rs2 > val) ? rs2 : val));
 
-    ex = rv_write_mem64(cpu, virt, val, true);
-    ASSERT(ex == rv_exc_none);
-    return ex;
+    // save loaded value to rd
+    cpu->regs[instr.r.rd] = val;
+    return rv_exc_none;
 }
@@ -30,6 +30,8 @@ rv_exc_t rv_write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool noisy);
 rv_exc_t rv_write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool noisy);
 rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool noisy);
 rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool noisy);
+bool rv_cas_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t expected, uint32_t value);
+bool rv_cas_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t expected, uint64_t value);
 rv_exc_t rv_convert_addr(rv_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr, bool fetch, bool noisy);
 
 static ALWAYS_INLINE rv_read_xlen_t rv_read_xlen()
@@ -307,9 +309,10 @@ static rv_exc_t rv_lr_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 
     // register address for tracking
 
-    sc_register(cpu->csr.mhartid);
+    sc_register(cpu->csr.mhartid, phys);
     cpu->reserved_valid = true;
     cpu->reserved_addr = phys;
+    cpu->reserved_value = val;
 
     return rv_exc_none;
 }
@@ -357,12 +360,10 @@ static rv_exc_t rv_sc_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     // and risc-v allows only aligned accesses (without Zam extension) and only 32-bit atomics are supported here
     // this should be fine
 
-    ex = rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr.r.rs2], true);
-
-    if (ex != rv_exc_none) {
-        alert("RV32IMA: SC write failed after successful address translation");
+    // the memory has to still hold the loaded value when running in parallel
+    if (!rv_cas_mem32(cpu, virt, (uint32_t) cpu->reserved_value, (uint32_t) cpu->regs[instr.r.rs2])) {
         cpu->regs[instr.r.rd] = 1;
-        return ex;
+        return rv_exc_none;
     }
 
     cpu->regs[instr.r.rd] = 0;
@@ -406,9 +407,10 @@ static rv_exc_t rv_lr_instr(rv_cpu_t *cpu, rv_instr_t instr)
     ex = rv_convert_addr(cpu, virt, &phys, false, false, false);
     ASSERT(ex == rv_exc_none);
 
-    sc_register(cpu->csr.mhartid);
+    sc_register(cpu->csr.mhartid, phys);
     cpu->reserved_valid = true;
     cpu->reserved_addr = phys;
+    cpu->reserved_value = val;
 
     return rv_exc_none;
 }
@@ -458,12 +460,10 @@ static rv_exc_t rv_sc_instr(rv_cpu_t *cpu, rv_instr_t instr)
         return rv_exc_none;
     }
 
-    ex = rv_write_mem64(cpu, virt, cpu->regs[instr.r.rs2], true);
-
-    if (ex != rv_exc_none) {
-        alert("RV64IMA: SC write failed after successful address translation");
+    // The memory has to still hold the loaded value when running in parallel
+    if (!rv_cas_mem64(cpu, virt, cpu->reserved_value, cpu->regs[instr.r.rs2])) {
         cpu->regs[instr.r.rd] = 1;
-        return ex;
+        return rv_exc_none;
     }
 
     // Success: store 0 to rd
@@ -39,6 +39,7 @@ static rv_exc_t rv_break_instr(rv_cpu_t *cpu, rv_instr_t instr)
     if (input_is_terminal() || machine_allow_interactive_without_tty) {
         alert("EBREAK: breakpoint reached, entering interactive mode");
         machine_interactive = true;
+        machine_instrumented = true;
     } else {
         alert("EBREAK: Machine halt when no tty available.");
         machine_halt = true;
@@ -64,6 +65,7 @@ static rv_exc_t rv_trace_set_instr(rv_cpu_t *cpu, rv_instr_t instr)
     ASSERT(instr.i.opcode == rv_opcSYSTEM);
     alert("ETRACES: Trace Set");
     machine_trace = true;
+    machine_instrumented = true;
     return rv_exc_none;
 }
 
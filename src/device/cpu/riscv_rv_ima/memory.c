@@ -15,18 +15,36 @@
 #include <stdbool.h>
 
 #include "../../../assert.h"
+#include "../../../debug/breakpoint.h"
+#include "../../../endian.h"
 #include "../../../physmem.h"
+#include "../../../trace.h"
 #include "../../../utils.h"
+#include "../../parallel.h"
+#include "../instr_cache.h"
 #include "csr.h"
+#include "data_tlb.h"
 #include "exception.h"
 #include "types.h"
 
 #if XLEN == 64
 #define rv_convert_addr rv64_convert_addr
+#define rv_tlb_touch rv64_tlb_touch
 #elif XLEN == 32
 #define rv_convert_addr rv32_convert_addr
+#define rv_tlb_touch rv32_tlb_touch
 #endif
 
+/*
+ * Records the stores done by the executed instructions in the binary trace
+ * (only the RV32 instructions are traced).
+ */
+#define rv_write_mem_body(cpu, virt, value, noisy, width) \
+    rv_exc_t ex = write_mem##width(cpu, virt, value, noisy); \
+    if ((XLEN == 32) && (trace_enabled) && (noisy) && (ex == rv_exc_none)) \
+        trace_store((cpu)->csr.mhartid, virt, width / 8, value); \
+    return ex;
+
 #define read_address_misaligned_exception (fetch ? rv_exc_instruction_address_misaligned : rv_exc_load_address_misaligned)
 
 #define try_read_memory_mapped_regs_body(cpu, virt, value, width, type) \
@@ -36,11 +54,12 @@
         return false; \
     int offset = (virt & 0x7) * 8; \
     if (ALIGN_DOWN(virt, 8) == RV_MTIME_ADDRESS) { \
-        *value = (type) EXTRACT_BITS(cpu->csr.mtime, offset, offset + (width) / 8); \
+        rv_csr_mtime_sample(&(cpu)->csr); \
+        *value = (type) (cpu->csr.mtime >> offset); \
         return true; \
     } \
     if (ALIGN_DOWN(virt, 8) == RV_MTIMECMP_ADDRESS) { \
-        *value = (type) EXTRACT_BITS(cpu->csr.mtimecmp, offset, offset + (width) / 8); \
+        *value = (type) (cpu->csr.mtimecmp >> offset); \
         return true; \
     } \
     return false;
@@ -106,6 +125,117 @@ static bool try_write_memory_mapped_regs(rv_cpu_t *cpu, uint64_t virt, uint64_t
     return false;
 }
 
+/** @brief Drops the data access cache and remembers the current translation context */
+static void data_tlb_flush(rv_cpu_t *cpu)
+{
+    rv_data_tlb_t *data_tlb = &cpu->data_tlb;
+
+    rv_data_tlb_clear(data_tlb);
+    data_tlb->priv_mode = cpu->priv_mode;
+    data_tlb->satp = cpu->csr.satp;
+    data_tlb->mstatus = cpu->csr.mstatus;
+    data_tlb->tlb_generation = cpu->tlb.generation;
+    data_tlb->frame_generation = instr_cache_generation;
+}
+
+/**
+ * @brief Checks whether the translation context of the data access cache changed
+ *
+ * Covers privilege mode changes, satp and mstatus writes,
+ * SFENCE.VMA and other TLB changes and memory rewiring.
+ */
+static bool data_tlb_context_changed(rv_cpu_t *cpu)
+{
+    rv_data_tlb_t *data_tlb = &cpu->data_tlb;
+
+    return (data_tlb->priv_mode != cpu->priv_mode)
+            || (data_tlb->satp != cpu->csr.satp)
+            || (data_tlb->mstatus != cpu->csr.mstatus)
+            || (data_tlb->tlb_generation != cpu->tlb.generation)
+            || (data_tlb->frame_generation != instr_cache_generation);
+}
+
+/**
+ * @brief Finds the host memory of an access in the data access cache
+ *
+ * Memory breakpoints and LL/SC reservations are not checked,
+ * so the cache is not used for pages with breakpoints nor
+ * for writes to pages with reservations.
+ *
+ * @return Host memory of the access or NULL if it is not cached
+ */
+static uint8_t *data_tlb_find(rv_cpu_t *cpu, virt_t virt, int size, bool wr)
+{
+    if (!IS_ALIGNED(virt, size)) {
+        return NULL;
+    }
+
+    if (data_tlb_context_changed(cpu)) {
+        data_tlb_flush(cpu);
+        return NULL;
+    }
+
+    uint64_t vpn = virt >> FRAME_WIDTH;
+    rv_data_tlb_entry_t *entries = wr ? cpu->data_tlb.write : cpu->data_tlb.read;
+    rv_data_tlb_entry_t *entry = &entries[vpn & (RV_DATA_TLB_SIZE - 1)];
+
+    if ((entry->vpn != vpn) || (entry->frame->breakpoints > 0)
+            || (wr && frame_reserved(entry->frame))) {
+        return NULL;
+    }
+
+    // Keep the TLB replacement as if the translation was done
+    if (entry->tlb_entry != NULL) {
+        rv_tlb_touch(&cpu->tlb, entry->tlb_entry);
+    }
+
+    return entry->frame->data + (virt & FRAME_MASK);
+}
+
+/**
+ * @brief Invalidates the binary translation of a page written through the data access cache
+ *
+ * Has to be called after the data is stored.
+ */
+static void data_tlb_written(rv_cpu_t *cpu, virt_t virt)
+{
+    uint64_t vpn = virt >> FRAME_WIDTH;
+    frame_invalidate(cpu->data_tlb.write[vpn & (RV_DATA_TLB_SIZE - 1)].frame);
+}
+
+/**
+ * @brief Adds the page of a completed memory access to the data access cache
+ *
+ * Only pages of plain memory are added, the translation has to be
+ * the last one done by the CPU.
+ */
+static void data_tlb_fill(rv_cpu_t *cpu, virt_t virt, ptr36_t phys, bool wr)
+{
+    // The memory mapped registers are checked before the cache is
+    uint64_t page = ALIGN_DOWN((uint64_t) virt, FRAME_SIZE);
+    if ((page == ALIGN_DOWN(RV_MTIME_ADDRESS, FRAME_SIZE))
+            || (page == ALIGN_DOWN(RV_MTIMECMP_ADDRESS, FRAME_SIZE))) {
+        return;
+    }
+
+    frame_t *frame = physmem_find_frame(phys);
+    if ((frame == NULL) || (wr && !frame->area->writable)) {
+        return;
+    }
+
+    if (data_tlb_context_changed(cpu)) {
+        data_tlb_flush(cpu);
+    }
+
+    uint64_t vpn = virt >> FRAME_WIDTH;
+    rv_data_tlb_entry_t *entries = wr ? cpu->data_tlb.write : cpu->data_tlb.read;
+    rv_data_tlb_entry_t *entry = &entries[vpn & (RV_DATA_TLB_SIZE - 1)];
+
+    entry->vpn = vpn;
+    entry->frame = frame;
+    entry->tlb_entry = cpu->tlb.last_entry;
+}
+
 #define throw_ex(cpu, virt, ex, noisy) \
     { \
         if (noisy) { \
@@ -129,6 +259,14 @@ static rv_exc_t rv_read_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t *value, bool
     ASSERT(cpu != NULL);
     ASSERT(value != NULL);
 
+    if (noisy && !fetch) {
+        uint8_t *data = data_tlb_find(cpu, virt, 8, false);
+        if (data != NULL) {
+            *value = convert_uint64_t_endian(*(uint64_t *) data);
+            return rv_exc_none;
+        }
+    }
+
     if (try_read_memory_mapped_regs_64(cpu, virt, value)) {
         return rv_exc_none;
     }
@@ -146,7 +284,12 @@ static rv_exc_t rv_read_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t *value, bool
         throw_ex(cpu, virt, read_address_misaligned_exception, noisy);
     }
 
-    *value = physmem_read64(cpu->csr.mhartid, phys, true);
+    *value = physmem_fast_read64(cpu->csr.mhartid, phys);
+
+    if (noisy && !fetch) {
+        data_tlb_fill(cpu, virt, phys, false);
+    }
+
     return rv_exc_none;
 }
 
@@ -165,6 +308,14 @@ static rv_exc_t rv_read_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t *value, bool
     ASSERT(cpu != NULL);
     ASSERT(value != NULL);
 
+    if (noisy && !fetch) {
+        uint8_t *data = data_tlb_find(cpu, virt, 4, false);
+        if (data != NULL) {
+            *value = convert_uint32_t_endian(*(uint32_t *) data);
+            return rv_exc_none;
+        }
+    }
+
     if (try_read_memory_mapped_regs_32(cpu, virt, value)) {
         return rv_exc_none;
     }
@@ -182,7 +333,12 @@ static rv_exc_t rv_read_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t *value, bool
         throw_ex(cpu, virt, read_address_misaligned_exception, noisy);
     }
 
-    *value = physmem_read32(cpu->csr.mhartid, phys, true);
+    *value = physmem_fast_read32(cpu->csr.mhartid, phys);
+
+    if (noisy && !fetch) {
+        data_tlb_fill(cpu, virt, phys, false);
+    }
+
     return rv_exc_none;
 }
 
@@ -201,6 +357,14 @@ static rv_exc_t rv_read_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t *value, bool
     ASSERT(cpu != NULL);
     ASSERT(value != NULL);
 
+    if (noisy && !fetch) {
+        uint8_t *data = data_tlb_find(cpu, virt, 2, false);
+        if (data != NULL) {
+            *value = convert_uint16_t_endian(*(uint16_t *) data);
+            return rv_exc_none;
+        }
+    }
+
     if (try_read_memory_mapped_regs_16(cpu, virt, value)) {
         return rv_exc_none;
     }
@@ -216,7 +380,12 @@ static rv_exc_t rv_read_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t *value, bool
         throw_ex(cpu, virt, read_address_misaligned_exception, noisy);
     }
 
-    *value = physmem_read16(cpu->csr.mhartid, phys, true);
+    *value = physmem_fast_read16(cpu->csr.mhartid, phys);
+
+    if (noisy && !fetch) {
+        data_tlb_fill(cpu, virt, phys, false);
+    }
+
     return rv_exc_none;
 }
 
@@ -235,6 +404,14 @@ static rv_exc_t rv_read_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t *value, bool no
     ASSERT(cpu != NULL);
     ASSERT(value != NULL);
 
+    if (noisy) {
+        uint8_t *data = data_tlb_find(cpu, virt, 1, false);
+        if (data != NULL) {
+            *value = convert_uint8_t_endian(*(uint8_t *) data);
+            return rv_exc_none;
+        }
+    }
+
     if (try_read_memory_mapped_regs_8(cpu, virt, value)) {
         return rv_exc_none;
     }
@@ -246,7 +423,12 @@ static rv_exc_t rv_read_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t *value, bool no
         throw_ex(cpu, virt, ex, noisy);
     }
 
-    *value = physmem_read8(cpu->csr.mhartid, phys, true);
+    *value = physmem_fast_read8(cpu->csr.mhartid, phys);
+
+    if (noisy) {
+        data_tlb_fill(cpu, virt, phys, false);
+    }
+
     return rv_exc_none;
 }
 
@@ -259,10 +441,19 @@ static rv_exc_t rv_read_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t *value, bool no
  * @param noisy Shall this operation change the global and cpu state
  * @return rv_exc_t The exception code
  */
-static rv_exc_t rv_write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool noisy)
+static rv_exc_t write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool noisy)
 {
     ASSERT(cpu != NULL);
 
+    if (noisy) {
+        uint8_t *data = data_tlb_find(cpu, virt, 1, true);
+        if (data != NULL) {
+            *(uint8_t *) data = convert_uint8_t_endian(value);
+            data_tlb_written(cpu, virt);
+            return rv_exc_none;
+        }
+    }
+
     if (try_write_memory_mapped_regs(cpu, virt, value, 8)) {
         return rv_exc_none;
     }
@@ -274,7 +465,10 @@ static rv_exc_t rv_write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool no
         throw_ex(cpu, virt, ex, noisy);
     }
 
-    if (physmem_write8(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_fast_write8(cpu->csr.mhartid, phys, value)) {
+        if (noisy) {
+            data_tlb_fill(cpu, virt, phys, true);
+        }
         return rv_exc_none;
     }
 
@@ -292,10 +486,19 @@ static rv_exc_t rv_write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool no
  * @param noisy Shall this operation change the global and cpu state
  * @return rv_exc_t The exception code
  */
-static rv_exc_t rv_write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool noisy)
+static rv_exc_t write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool noisy)
 {
     ASSERT(cpu != NULL);
 
+    if (noisy) {
+        uint8_t *data = data_tlb_find(cpu, virt, 2, true);
+        if (data != NULL) {
+            *(uint16_t *) data = convert_uint16_t_endian(value);
+            data_tlb_written(cpu, virt);
+            return rv_exc_none;
+        }
+    }
+
     if (try_write_memory_mapped_regs(cpu, virt, value, 16)) {
         return rv_exc_none;
     }
@@ -312,7 +515,10 @@ static rv_exc_t rv_write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool
         throw_ex(cpu, virt, rv_exc_store_amo_address_misaligned, noisy);
     }
 
-    if (physmem_write16(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_fast_write16(cpu->csr.mhartid, phys, value)) {
+        if (noisy) {
+            data_tlb_fill(cpu, virt, phys, true);
+        }
         return rv_exc_none;
     }
 
@@ -330,10 +536,19 @@ static rv_exc_t rv_write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool
  * @param noisy Shall this operation change the global and cpu state
  * @return rv_exc_t The exception code
  */
-static rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool noisy)
+static rv_exc_t write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool noisy)
 {
     ASSERT(cpu != NULL);
 
+    if (noisy) {
+        uint8_t *data = data_tlb_find(cpu, virt, 4, true);
+        if (data != NULL) {
+            *(uint32_t *) data = convert_uint32_t_endian(value);
+            data_tlb_written(cpu, virt);
+            return rv_exc_none;
+        }
+    }
+
     if (try_write_memory_mapped_regs(cpu, virt, value, 32)) {
         return rv_exc_none;
     }
@@ -349,7 +564,10 @@ static rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool
         throw_ex(cpu, virt, rv_exc_store_amo_address_misaligned, noisy);
     }
 
-    if (physmem_write32(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_fast_write32(cpu->csr.mhartid, phys, value)) {
+        if (noisy) {
+            data_tlb_fill(cpu, virt, phys, true);
+        }
         return rv_exc_none;
     }
 
@@ -367,10 +585,19 @@ static rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool
  * @param noisy Shall this operation change the global and cpu state
  * @return rv_exc_t The exception code
  */
-static rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool noisy)
+static rv_exc_t write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool noisy)
 {
     ASSERT(cpu != NULL);
 
+    if (noisy) {
+        uint8_t *data = data_tlb_find(cpu, virt, 8, true);
+        if (data != NULL) {
+            *(uint64_t *) data = convert_uint64_t_endian(value);
+            data_tlb_written(cpu, virt);
+            return rv_exc_none;
+        }
+    }
+
     if (try_write_memory_mapped_regs(cpu, virt, value, 64)) {
         return rv_exc_none;
     }
@@ -386,7 +613,10 @@ static rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool
         throw_ex(cpu, virt, rv_exc_store_amo_address_misaligned, noisy);
     }
 
-    if (physmem_write64(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_fast_write64(cpu->csr.mhartid, phys, value)) {
+        if (noisy) {
+            data_tlb_fill(cpu, virt, phys, true);
+        }
         return rv_exc_none;
     }
 
@@ -395,6 +625,113 @@ static rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool
     return rv_exc_none;
 }
 
+/**
+ * @brief Writes 8 bits to the specified virtual address and traces the store
+ *
+ * See write_mem8.
+ */
+static rv_exc_t rv_write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool noisy)
+{
+    rv_write_mem_body(cpu, virt, value, noisy, 8)
+}
+
+/**
+ * @brief Writes 16 bits to the specified virtual address and traces the store
+ *
+ * See write_mem16.
+ */
+static rv_exc_t rv_write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool noisy)
+{
+    rv_write_mem_body(cpu, virt, value, noisy, 16)
+}
+
+/**
+ * @brief Writes 32 bits to the specified virtual address and traces the store
+ *
+ * See write_mem32.
+ */
+static rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool noisy)
+{
+    rv_write_mem_body(cpu, virt, value, noisy, 32)
+}
+
+/**
+ * @brief Writes 64 bits to the specified virtual address and traces the store
+ *
+ * See write_mem64.
+ */
+static rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool noisy)
+{
+    rv_write_mem_body(cpu, virt, value, noisy, 64)
+}
+
+/**
+ * @brief Writes 32 bits to virtual memory if it holds the expected value
+ *
+ * Used by the atomic instructions, the address has to be already checked
+ * to be writable and aligned. The value is compared only when the CPUs
+ * run in parallel, otherwise the memory cannot change after the expected
+ * value was read (or the LR reservation would be lost).
+ *
+ * @param cpu The cpu which makes the write
+ * @param virt The virtual address
+ * @param expected The value the memory has to hold
+ * @param value The value to be written
+ * @return Whether the value was written
+ */
+static bool rv_cas_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t expected, uint32_t value)
+{
+    ASSERT(cpu != NULL);
+
+    if (!parallel_running) {
+        rv_exc_t ex = rv_write_mem32(cpu, virt, value, true);
+        ASSERT(ex == rv_exc_none);
+        return true;
+    }
+
+    if (try_write_memory_mapped_regs(cpu, virt, value, 32)) {
+        return true;
+    }
+
+    ptr36_t phys;
+    rv_exc_t ex = rv_convert_addr(cpu, virt, &phys, true, false, true);
+    ASSERT(ex == rv_exc_none);
+
+    return physmem_cas32(cpu->csr.mhartid, phys, expected, value);
+}
+
+/**
+ * @brief Writes 64 bits to virtual memory if it holds the expected value
+ *
+ * See rv_cas_mem32.
+ *
+ * @param cpu The cpu which makes the write
+ * @param virt The virtual address
+ * @param expected The value the memory has to hold
+ * @param value The value to be written
+ * @return Whether the value was written
+ */
+static bool rv_cas_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t expected, uint64_t value)
+{
+    ASSERT(cpu != NULL);
+
+    if (!parallel_running) {
+        rv_exc_t ex = rv_write_mem64(cpu, virt, value, true);
+        ASSERT(ex == rv_exc_none);
+        return true;
+    }
+
+    if (try_write_memory_mapped_regs(cpu, virt, value, 64)) {
+        return true;
+    }
+
+    ptr36_t phys;
+    rv_exc_t ex = rv_convert_addr(cpu, virt, &phys, true, false, true);
+    ASSERT(ex == rv_exc_none);
+
+    return physmem_cas64(cpu->csr.mhartid, phys, expected, value);
+}
+
 static bool rv_sc_access(rv_cpu_t *cpu, ptr36_t phys, int size)
 {
     ASSERT(cpu != NULL);
@@ -16,12 +16,9 @@
 
 #include <stdint.h>
 
+#include "../../../utils.h"
 #include "exception.h"
 
-#ifndef ALWAYS_INLINE
-#define ALWAYS_INLINE inline __attribute__((always_inline))
-#endif
-
 #if XLEN == 64
 typedef uint64_t uxlen_t;
 typedef uint64_t virt_t;
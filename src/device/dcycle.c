@@ -19,6 +19,7 @@
 #include "../utils.h"
 #include "dcycle.h"
 #include "device.h"
+#include "event.h"
 
 /** Registers */
 #define REGISTER_CYCLE_LO 0
@@ -28,9 +29,20 @@
 /** Instance data structure */
 typedef struct {
     ptr36_t addr;
-    uint64_t cycle;
+    uint64_t start; /**< Machine cycle of the initialization */
 } dcycle_data_t;
 
+/** Number of cycles since the initialization of the device
+ *
+ * Computed from the machine cycle counter, so that the device
+ * does not need to be stepped.
+ *
+ */
+static uint64_t dcycle_cycle(dcycle_data_t *data)
+{
+    return machine_current_cycle() - data->start;
+}
+
 /** Init command implementation
  *
  * @param parm Command-line parameters
@@ -67,7 +79,8 @@ static bool dcycle_init(token_t *parm, device_t *dev)
     dev->data = data;
 
     data->addr = addr;
-    data->cycle = 0;
+    dev_map_range(dev, addr, REGISTER_LIMIT);
+    data->start = machine_current_cycle();
 
     return true;
 }
@@ -103,7 +116,7 @@ static bool dcycle_stat(token_t *parm, device_t *dev)
     dcycle_data_t *data = (dcycle_data_t *) dev->data;
 
     printf("[cycle              ]\n");
-    printf("%20" PRIu64 "\n", data->cycle);
+    printf("%20" PRIu64 "\n", dcycle_cycle(data));
 
     return true;
 }
@@ -134,10 +147,10 @@ static void dcycle_read32(unsigned int procno, device_t *dev, ptr36_t addr, uint
 
     switch (addr - data->addr) {
     case REGISTER_CYCLE_LO:
-        *val = (uint32_t) data->cycle;
+        *val = (uint32_t) dcycle_cycle(data);
         break;
     case REGISTER_CYCLE_HI:
-        *val = (uint32_t) (data->cycle >> 32);
+        *val = (uint32_t) (dcycle_cycle(data) >> 32);
         break;
     }
 }
@@ -158,22 +171,11 @@ static void dcycle_read64(unsigned int procno, device_t *dev, ptr36_t addr, uint
 
     switch (addr - data->addr) {
     case REGISTER_CYCLE_LO:
-        *val = data->cycle;
+        *val = dcycle_cycle(data);
         break;
     }
 }
 
-/** Cycle device implementation
- *
- */
-static void dcycle_step(device_t *dev)
-{
-    ASSERT(dev != NULL);
-
-    dcycle_data_t *data = (dcycle_data_t *) dev->data;
-    data->cycle++;
-}
-
 static cmd_t dcycle_cmds[] = {
     { "init",
             (fcmd_t) dcycle_init,
@@ -220,7 +222,6 @@ device_type_t dcycle = {
     .done = dcycle_done,
     .read32 = dcycle_read32,
     .read64 = dcycle_read64,
-    .step = dcycle_step,
 
     /* Commands */
     .cmds = dcycle_cmds
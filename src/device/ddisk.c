@@ -18,6 +18,7 @@
 #include <sys/types.h>
 
 #include "../arch/mmap.h"
+#include "../assert.h"
 #include "../fault.h"
 #include "../main.h"
 #include "../physmem.h"
@@ -25,6 +26,7 @@
 #include "../utils.h"
 #include "cpu/general_cpu.h"
 #include "ddisk.h"
+#include "event.h"
 
 /** Actions the disk is performing */
 enum action_e {
@@ -42,7 +44,8 @@ enum action_e {
 #define REGISTER_ADDR_HI 16 /**< Address (bits 32 .. 35) */
 #define REGISTER_SECNO_HI 20 /**< Reserved for future extension */
 #define REGISTER_SIZE_HI 24 /**< Disk size in bytes (bits 32 .. 63) */
-#define REGISTER_LIMIT 28 /**< Size of register block */
+#define REGISTER_COUNT 28 /**< Sector (descriptor) count */
+#define REGISTER_LIMIT 32 /**< Size of register block */
 /* \} */
 
 /** \{ \name Status flags */
@@ -56,38 +59,68 @@ enum action_e {
 #define COMMAND_READ 0x01 /**< Read */
 #define COMMAND_WRITE 0x02 /**< Write */
 #define COMMAND_INT_ACK 0x04 /**< Interrupt acknowledge */
-#define COMMAND_MASK 0x07 /**< Command mask */
+#define COMMAND_LIST 0x08 /**< Transfer by a descriptor list */
+#define COMMAND_MASK 0x0f /**< Command mask */
 /* \} */
 
+/** \{ \name Descriptor list */
+#define DESCRIPTOR_ADDR_LO 0 /**< Address (bits 0 .. 31) */
+#define DESCRIPTOR_ADDR_HI 4 /**< Address (bits 32 .. 35) */
+#define DESCRIPTOR_SECNO 8 /**< First sector number */
+#define DESCRIPTOR_COUNT 12 /**< Sector count */
+#define DESCRIPTOR_SIZE 16 /**< Size of a descriptor */
+#define MAX_DESCRIPTORS 1024 /**< Maximal number of descriptors */
+/* \} */
+
+/** Default number of machine cycles needed to transfer a sector */
+#define DEFAULT_SECTOR_CYCLES 128
+
+/** Size of the copy-on-write blocks */
+#define COW_BLOCK_SIZE 4096
+
 /** Disk types */
 enum disk_type_e {
     DISKT_NONE, /**< Uninitialized */
     DISKT_MEM, /**< Memory-only disk */
-    DISKT_FMAP /**< File-mapped */
+    DISKT_FMAP, /**< File-mapped */
+    DISKT_COW /**< Read-only file with a copy-on-write overlay */
 };
 
+/** Contiguous part of a transfer */
+typedef struct {
+    ptr36_t addr; /**< Physical address of the buffer */
+    uint64_t secno; /**< First sector */
+    uint64_t count; /**< Number of sectors */
+} disk_segment_t;
+
 /** Disk instance data structure */
 typedef struct {
     uint32_t *img; /**< Disk image memory */
+    uint8_t **blocks; /**< Copy-on-write blocks (NULL if not written) */
+    uint64_t block_count; /**< Number of allocated copy-on-write blocks */
 
     /* Configuration */
     unsigned int intno; /**< Interrupt number */
     unsigned int cpuid; /**< ID of the CPU that will receive interrupts */
     bool uses_busy_bit; /**< Determines if the device should use busy bit or interrupts */
-    enum disk_type_e disk_type; /**< Disk type: none, memory, file-mapped */
+    enum disk_type_e disk_type; /**< Disk type: none, memory, file-mapped, copy-on-write */
     ptr36_t addr; /**< Disk memory location */
     uint64_t size; /**< Disk size */
+    uint64_t command_cycles; /**< Latency of a command */
+    uint64_t sector_cycles; /**< Transfer time of a sector */
 
     /* Registers */
     ptr36_t disk_ptr; /**< Current DMA pointer */
     uint32_t disk_secno; /**< Active sector to read/write */
+    uint32_t disk_count; /**< Number of sectors (descriptors) */
     uint32_t disk_status; /**< Disk status register */
     uint32_t disk_command; /**< Disk command register */
 
     /* Current action variables */
     enum action_e action; /**< Action type */
-    size_t secno; /**< Sector number */
-    size_t cnt; /**< Word counter */
+    disk_segment_t *segments; /**< Parts of the transfer */
+    size_t segment_count; /**< Number of parts of the transfer */
+    event_t transfer; /**< Completion of the current action */
     bool ig; /**< Interrupt pending flag */
 
     /* Statistics */
@@ -107,7 +140,9 @@ static void ddisk_clean_up(disk_data_s *data)
     /* Cancel current action */
     data->action = ACTION_NONE;
     data->disk_ptr = 0;
-    data->cnt = 0;
+    event_cancel(&data->transfer);
+    safe_free(data->segments);
+    data->segment_count = 0;
 
     /* Do the clean up */
     switch (data->disk_type) {
@@ -119,12 +154,148 @@ static void ddisk_clean_up(disk_data_s *data)
     case DISKT_FMAP:
         try_munmap(data->img, data->size);
         break;
+    case DISKT_COW:
+        for (uint64_t i = 0; i < ALIGN_UP(data->size, COW_BLOCK_SIZE) / COW_BLOCK_SIZE; i++) {
+            safe_free(data->blocks[i]);
+        }
+
+        safe_free(data->blocks);
+        data->block_count = 0;
+        try_munmap(data->img, data->size);
+        break;
     }
 
     data->size = 0;
     data->disk_type = DISKT_NONE;
 }
 
+/** Image data for reading
+ *
+ * @param data   Disk instance data structure
+ * @param offset Offset in the disk image
+ * @param len    Number of contiguous bytes at the returned address
+ *
+ * @return Address of the image data at the offset
+ *
+ */
+static const uint8_t *ddisk_image_read(disk_data_s *data, uint64_t offset,
+        uint64_t *len)
+{
+    ASSERT(offset < data->size);
+
+    if (data->disk_type != DISKT_COW) {
+        *len = data->size - offset;
+        return ((const uint8_t *) data->img) + offset;
+    }
+
+    uint64_t block = offset / COW_BLOCK_SIZE;
+    uint64_t block_offset = offset % COW_BLOCK_SIZE;
+    *len = MIN(COW_BLOCK_SIZE - block_offset, data->size - offset);
+
+    if (data->blocks[block] != NULL) {
+        return data->blocks[block] + block_offset;
+    }
+
+    return ((const uint8_t *) data->img) + offset;
+}
+
+/** Image data for writing
+ *
+ * Blocks of a copy-on-write disk are copied from the file
+ * when they are written for the first time.
+ *
+ * @param data   Disk instance data structure
+ * @param offset Offset in the disk image
+ * @param len    Number of contiguous bytes at the returned address
+ *
+ * @return Address of the image data at the offset
+ *
+ */
+static uint8_t *ddisk_image_write(disk_data_s *data, uint64_t offset,
+        uint64_t *len)
+{
+    ASSERT(offset < data->size);
+
+    if (data->disk_type != DISKT_COW) {
+        *len = data->size - offset;
+        return ((uint8_t *) data->img) + offset;
+    }
+
+    uint64_t block = offset / COW_BLOCK_SIZE;
+    uint64_t block_offset = offset % COW_BLOCK_SIZE;
+    *len = MIN(COW_BLOCK_SIZE - block_offset, data->size - offset);
+
+    if (data->blocks[block] == NULL) {
+        uint64_t block_start = block * COW_BLOCK_SIZE;
+
+        data->blocks[block] = (uint8_t *) safe_malloc(COW_BLOCK_SIZE);
+        memcpy(data->blocks[block], ((uint8_t *) data->img) + block_start,
+                MIN(COW_BLOCK_SIZE, data->size - block_start));
+        data->block_count++;
+    }
+
+    return data->blocks[block] + block_offset;
+}
+
+/** Transfer of the sectors of a command
+ *
+ * All the sectors are transferred when the time needed
+ * by the disk to transfer them has passed.
+ *
+ * @param event Completion event of the disk
+ *
+ */
+static void ddisk_transfer(event_t *event)
+{
+    disk_data_s *data = (disk_data_s *) event->data;
+
+    if (data->action == ACTION_NONE) {
+        /* No further processing */
+        return;
+    }
+
+    for (size_t i = 0; i < data->segment_count; i++) {
+        disk_segment_t *segment = &data->segments[i];
+        ptr36_t addr = segment->addr;
+        uint64_t offset = segment->secno * 512;
+        uint64_t end = offset + segment->count * 512;
+
+        while (offset < end) {
+            uint64_t len;
+
+            if (data->action == ACTION_READ) {
+                const uint8_t *src = ddisk_image_read(data, offset, &len);
+                len = MIN(len, end - offset);
+                physmem_dma_write(addr, src, len);
+            } else {
+                uint8_t *dst = ddisk_image_write(data, offset, &len);
+                len = MIN(len, end - offset);
+                physmem_dma_read(addr, dst, len);
+            }
+
+            addr += len;
+            offset += len;
+        }
+    }
+
+    /* The pointer moves over the buffer unless a list is used */
+    if (!(data->disk_command & COMMAND_LIST)) {
+        data->disk_ptr += data->segments[0].count * 512;
+    }
+
+    safe_free(data->segments);
+    data->segment_count = 0;
+    data->action = ACTION_NONE;
+    data->disk_status &= ~STATUS_BUSY;
+
+    if (!data->uses_busy_bit) {
+        data->disk_status |= STATUS_INT;
+        cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
+        data->ig = true;
+        data->intrcount++;
+    }
+}
+
 /** Init command implementation
  *
  * @param parm Command-line parameters
@@ -201,18 +372,25 @@ static bool ddisk_init(token_t *parm, device_t *dev)
 
     /* Basic structure inicialization */
     data->addr = addr;
+    dev_map_range(dev, addr, REGISTER_LIMIT);
     data->intno = intno;
     data->uses_busy_bit = uses_busy_bit;
     data->cpuid = cpuid;
     data->size = 0;
+    data->command_cycles = 0;
+    data->sector_cycles = DEFAULT_SECTOR_CYCLES;
     data->disk_ptr = 0;
     data->disk_secno = 0;
+    data->disk_count = 1;
     data->disk_status = 0;
     data->disk_command = 0;
     data->img = (uint32_t *) MAP_FAILED;
+    data->blocks = NULL;
+    data->block_count = 0;
     data->action = ACTION_NONE;
-    data->secno = 0;
-    data->cnt = 0;
+    data->segments = NULL;
+    data->segment_count = 0;
+    event_init(&data->transfer, ddisk_transfer, data);
     data->ig = false;
     data->intrcount = 0;
     data->cmds_read = 0;
@@ -248,6 +426,9 @@ static bool ddisk_info(token_t *parm, device_t *dev)
     case DISKT_FMAP:
         stype = "fmap";
         break;
+    case DISKT_COW:
+        stype = "cow";
+        break;
     default:
         stype = "*";
     }
@@ -282,6 +463,40 @@ static bool ddisk_stat(token_t *parm, device_t *dev)
     printf("%20" PRIu64 " %20" PRIu64 " %20" PRIu64 "\n",
             data->cmds_read, data->cmds_write, data->cmds_error);
 
+    if (data->disk_type == DISKT_COW) {
+        printf("[copied blocks     ]\n");
+        printf("%20" PRIu64 "\n", data->block_count);
+    }
+
+    return true;
+}
+
+/** Latency command implementation
+ *
+ * @param parm Command-line parameters
+ * @param dev  Device instance structure
+ *
+ * @return True if successful
+ *
+ */
+static bool ddisk_latency(token_t *parm, device_t *dev)
+{
+    disk_data_s *data = (disk_data_s *) dev->data;
+    uint64_t sector_cycles = parm_uint_next(&parm);
+    uint64_t command_cycles = 0;
+
+    if (parm_type(parm) == tt_uint) {
+        command_cycles = parm_uint(parm);
+    }
+
+    if (sector_cycles + command_cycles == 0) {
+        error("Disk transfer has to take at least one cycle");
+        return false;
+    }
+
+    data->sector_cycles = sector_cycles;
+    data->command_cycles = command_cycles;
+
     return true;
 }
 
@@ -327,22 +542,24 @@ static bool ddisk_generic(token_t *parm, device_t *dev)
     return true;
 }
 
-/** Fmap command implementation
+/** Map the disk to a file
  *
- * Map the disk to a file. The allocated memory block is disposed.
+ * The file of a copy-on-write disk is mapped read-only
+ * and it is never written.
  *
- * @param parm Command-line parameters
- * @param dev  Device instance structure
+ * @param data Disk instance data structure
+ * @param path File name
+ * @param type DISKT_FMAP or DISKT_COW
  *
  * @return True if successful
  *
  */
-static bool ddisk_fmap(token_t *parm, device_t *dev)
+static bool ddisk_map_file(disk_data_s *data, const char *path,
+        enum disk_type_e type)
 {
-    disk_data_s *data = (disk_data_s *) dev->data;
-    const char *const path = parm_str(parm);
+    bool cow = (type == DISKT_COW);
 
-    FILE *file = try_fopen(path, "rb+");
+    FILE *file = try_fopen(path, cow ? "rb" : "rb+");
     if (file == NULL) {
         return false;
     }
@@ -393,7 +610,8 @@ static bool ddisk_fmap(token_t *parm, device_t *dev)
         return false;
     }
 
-    void *ptr = mmap(0, fsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int prot = cow ? PROT_READ : (PROT_READ | PROT_WRITE);
+    void *ptr = mmap(0, fsize, prot, MAP_SHARED, fd, 0);
 
     if (ptr == MAP_FAILED) {
         io_error(path);
@@ -408,12 +626,54 @@ static bool ddisk_fmap(token_t *parm, device_t *dev)
     /* Upgrade structures and reset the device */
     ddisk_clean_up(data);
     data->size = size;
-    data->disk_type = DISKT_FMAP;
+    data->disk_type = type;
     data->img = (uint32_t *) ptr;
 
+    if (cow) {
+        uint64_t blocks = ALIGN_UP(size, COW_BLOCK_SIZE) / COW_BLOCK_SIZE;
+
+        data->blocks = (uint8_t **) safe_malloc(blocks * sizeof(uint8_t *));
+        for (uint64_t i = 0; i < blocks; i++) {
+            data->blocks[i] = NULL;
+        }
+    }
+
     return true;
 }
 
+/** Fmap command implementation
+ *
+ * Map the disk to a file. The allocated memory block is disposed.
+ *
+ * @param parm Command-line parameters
+ * @param dev  Device instance structure
+ *
+ * @return True if successful
+ *
+ */
+static bool ddisk_fmap(token_t *parm, device_t *dev)
+{
+    disk_data_s *data = (disk_data_s *) dev->data;
+    return ddisk_map_file(data, parm_str(parm), DISKT_FMAP);
+}
+
+/** Cow command implementation
+ *
+ * Map the disk to a file which is never written. The blocks
+ * written by the simulation are kept in memory instead.
+ *
+ * @param parm Command-line parameters
+ * @param dev  Device instance structure
+ *
+ * @return True if successful
+ *
+ */
+static bool ddisk_cow(token_t *parm, device_t *dev)
+{
+    disk_data_s *data = (disk_data_s *) dev->data;
+    return ddisk_map_file(data, parm_str(parm), DISKT_COW);
+}
+
 /** Fill command implementation
  *
  * Fill the disk image with a specified character (byte).
@@ -457,7 +717,14 @@ static bool ddisk_fill(token_t *parm, device_t *dev)
         return false;
     }
 
-    memset(data->img, c, data->size);
+    uint64_t offset = 0;
+    while (offset < data->size) {
+        uint64_t len;
+        uint8_t *dst = ddisk_image_write(data, offset, &len);
+        memset(dst, c, len);
+        offset += len;
+    }
+
     return true;
 }
 
@@ -514,12 +781,21 @@ static bool ddisk_load(token_t *parm, device_t *dev)
     }
 
     /* Read the file directly */
-    size_t rd = fread(data->img, 1, fsize, file);
-    if (rd != fsize) {
-        io_error(path);
-        error("%s", txt_file_read_err);
-        safe_fclose(file, path);
-        return false;
+    uint64_t offset = 0;
+    while (offset < fsize) {
+        uint64_t len;
+        uint8_t *dst = ddisk_image_write(data, offset, &len);
+        len = MIN(len, fsize - offset);
+
+        size_t rd = fread(dst, 1, len, file);
+        if (rd != len) {
+            io_error(path);
+            error("%s", txt_file_read_err);
+            safe_fclose(file, path);
+            return false;
+        }
+
+        offset += len;
     }
 
     /* Close file */
@@ -563,12 +839,20 @@ static bool ddisk_save(token_t *parm, device_t *dev)
     }
 
     /* Write data */
-    size_t wr = fwrite(data->img, 1, host_size, file);
-    if (wr != host_size) {
-        io_error(path);
-        error("%s", txt_file_write_err);
-        safe_fclose(file, path);
-        return false;
+    uint64_t offset = 0;
+    while (offset < host_size) {
+        uint64_t len;
+        const uint8_t *src = ddisk_image_read(data, offset, &len);
+
+        size_t wr = fwrite(src, 1, len, file);
+        if (wr != len) {
+            io_error(path);
+            error("%s", txt_file_write_err);
+            safe_fclose(file, path);
+            return false;
+        }
+
+        offset += len;
     }
 
     /* Close file */
@@ -629,7 +913,100 @@ static void ddisk_read32(unsigned int procno, device_t *dev, ptr36_t addr,
     case REGISTER_SIZE_HI:
         *val = (uint32_t) (data->size >> 32);
         break;
+    case REGISTER_COUNT:
+        *val = data->disk_count;
+        break;
+    }
+}
+
+/** Report an illegal command
+ *
+ * @param data Disk instance data structure
+ *
+ */
+static void ddisk_error(disk_data_s *data)
+{
+    data->disk_status = STATUS_ERROR;
+    if (!data->uses_busy_bit) {
+        data->disk_status |= STATUS_INT;
+        cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
+        data->ig = true;
+        data->intrcount++;
+    }
+    data->cmds_error++;
+}
+
+/** Check whether the sectors are within the disk
+ *
+ * @param data  Disk instance data structure
+ * @param secno First sector
+ * @param count Number of sectors
+ *
+ * @return True if there is at least one sector and all are within the disk
+ *
+ */
+static bool ddisk_sectors_valid(disk_data_s *data, uint64_t secno,
+        uint64_t count)
+{
+    return (count > 0) && ((secno + count) * 512 <= data->size);
+}
+
+/** Prepare the parts of the transfer of a command
+ *
+ * Either the sectors given by the registers or the sectors
+ * given by a descriptor list at the DMA pointer are transferred.
+ * Each descriptor consists of four words: the buffer address
+ * (bits 0 .. 31 and 32 .. 35), the first sector and the number
+ * of sectors.
+ *
+ * @param data Disk instance data structure
+ *
+ * @return False if the sectors are not valid
+ *
+ */
+static bool ddisk_prepare(disk_data_s *data)
+{
+    ASSERT(data->segments == NULL);
+
+    if (!(data->disk_command & COMMAND_LIST)) {
+        if ((!IS_ALIGNED(data->disk_ptr, 4))
+                || (!ddisk_sectors_valid(data, data->disk_secno, data->disk_count))) {
+            return false;
+        }
+
+        data->segments = safe_malloc_t(disk_segment_t);
+        data->segments[0].addr = data->disk_ptr;
+        data->segments[0].secno = data->disk_secno;
+        data->segments[0].count = data->disk_count;
+        data->segment_count = 1;
+        return true;
+    }
+
+    if ((data->disk_count == 0) || (data->disk_count > MAX_DESCRIPTORS)) {
+        return false;
+    }
+
+    data->segments = safe_malloc(data->disk_count * sizeof(disk_segment_t));
+    data->segment_count = data->disk_count;
+
+    for (size_t i = 0; i < data->segment_count; i++) {
+        ptr36_t descriptor = data->disk_ptr + i * DESCRIPTOR_SIZE;
+        disk_segment_t *segment = &data->segments[i];
+
+        segment->addr = physmem_read32(-1 /*NULL*/, descriptor + DESCRIPTOR_ADDR_LO, true);
+        segment->addr |= ((ptr36_t) physmem_read32(-1 /*NULL*/, descriptor + DESCRIPTOR_ADDR_HI, true)) << 32;
+        segment->secno = physmem_read32(-1 /*NULL*/, descriptor + DESCRIPTOR_SECNO, true);
+        segment->count = physmem_read32(-1 /*NULL*/, descriptor + DESCRIPTOR_COUNT, true);
+
+        if ((!IS_ALIGNED(segment->addr, 4))
+                || (!ddisk_sectors_valid(data, segment->secno, segment->count))) {
+            safe_free(data->segments);
+            data->segment_count = 0;
+            return false;
+        }
     }
+
+    return true;
 }
 
 /** Write command implementation
@@ -664,6 +1041,9 @@ static void ddisk_write32(unsigned int procno, device_t *dev, ptr36_t addr,
     case REGISTER_SECNO:
         data->disk_secno = val;
         break;
+    case REGISTER_COUNT:
+        data->disk_count = val;
+        break;
     case REGISTER_COMMAND:
         /* Remove unused bits */
         data->disk_command = val & COMMAND_MASK;
@@ -680,41 +1060,31 @@ static void ddisk_write32(unsigned int procno, device_t *dev, ptr36_t addr,
         /* Check general errors */
         if ((data->disk_command & COMMAND_READ) && (data->disk_command & COMMAND_WRITE)) {
             /* Simultaneous read/write command */
-            data->disk_status = STATUS_ERROR;
-            if (!data->uses_busy_bit) {
-                data->disk_status |= STATUS_INT;
-                cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
-                data->ig = true;
-                data->intrcount++;
-            }
-            data->cmds_error++;
+            ddisk_error(data);
             return;
         }
 
         if ((data->disk_command & (COMMAND_READ | COMMAND_WRITE)) && (data->action != ACTION_NONE)) {
             /* Command in progress */
-            data->disk_status = STATUS_ERROR;
-            if (!data->uses_busy_bit) {
-                data->disk_status |= STATUS_INT;
-                cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
-                data->ig = true;
-                data->intrcount++;
-            }
-            data->cmds_error++;
+            ddisk_error(data);
             return;
         }
 
         /* Check bound */
-        if (((uint64_t) data->disk_secno + 1) * 512 > data->size) {
+        if ((!(data->disk_command & COMMAND_LIST))
+                && (((uint64_t) data->disk_secno + 1) * 512 > data->size)) {
             /* Generate interrupt to indicate error */
-            data->disk_status = STATUS_ERROR;
-            if (!data->uses_busy_bit) {
-                data->disk_status |= STATUS_INT;
-                cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
-                data->ig = true;
-                data->intrcount++;
-            }
-            data->cmds_error++;
+            ddisk_error(data);
+            return;
+        }
+
+        if (!(data->disk_command & (COMMAND_READ | COMMAND_WRITE))) {
+            break;
+        }
+
+        /* Sectors to transfer */
+        if (!ddisk_prepare(data)) {
+            ddisk_error(data);
             return;
         }
 
@@ -722,8 +1092,6 @@ static void ddisk_write32(unsigned int procno, device_t *dev, ptr36_t addr,
         if (data->disk_command & COMMAND_READ) {
             /* Reading in progress */
             data->action = ACTION_READ;
-            data->cnt = 0;
-            data->secno = data->disk_secno;
             data->disk_status |= STATUS_BUSY;
             data->cmds_read++;
         }
@@ -732,61 +1100,18 @@ static void ddisk_write32(unsigned int procno, device_t *dev, ptr36_t addr,
         if (data->disk_command & COMMAND_WRITE) {
             /* Writing in progress */
             data->action = ACTION_WRITE;
-            data->cnt = 0;
-            data->secno = data->disk_secno;
             data->disk_status |= STATUS_BUSY;
             data->cmds_write++;
         }
 
-        break;
-    }
-}
-
-/** Disk implementation
- *
- * @param dev Device pointer
- *
- */
-static void ddisk_step(device_t *dev)
-{
-    disk_data_s *data = (disk_data_s *) dev->data;
-    size_t pos;
-
-    // TODO: generate SC checks on changed mem registers?
-
-    /* Reading */
-    switch (data->action) {
-    case ACTION_READ:
-        pos = data->secno * 128 + data->cnt;
-        physmem_write32(-1 /*NULL*/, data->disk_ptr, data->img[pos], true);
-
-        /* Next word */
-        data->disk_ptr += 4;
-        data->cnt++;
-        break;
-    case ACTION_WRITE:
-        pos = data->secno * 128 + data->cnt;
-        data->img[pos] = physmem_read32(-1 /*NULL*/, data->disk_ptr, true);
+        uint64_t sectors = 0;
+        for (size_t i = 0; i < data->segment_count; i++) {
+            sectors += data->segments[i].count;
+        }
 
-        /* Next word */
-        data->disk_ptr += 4;
-        data->cnt++;
+        event_schedule(&data->transfer, machine_current_cycle()
+                        + data->command_cycles + sectors * data->sector_cycles);
         break;
-    default:
-        /* No further processing */
-        return;
-    }
-
-    if (data->cnt == 128) {
-        data->action = ACTION_NONE;
-        data->disk_status &= ~STATUS_BUSY;
-
-        if (!data->uses_busy_bit) {
-            data->disk_status |= STATUS_INT;
-            cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
-            data->ig = true;
-            data->intrcount++;
-        }
     }
 }
 
@@ -836,6 +1161,23 @@ cmd_t ddisk_cmds[] = {
             "Map the memory as the file specified",
             "Map the memory as the file specified",
             REQ STR "fname/file name" END },
+    { "cow",
+            (fcmd_t) ddisk_cow,
+            DEFAULT,
+            DEFAULT,
+            "Map the file specified as a copy-on-write disk",
+            "Map the file specified as a disk which is not written, "
+            "the written blocks are kept in memory",
+            REQ STR "fname/file name" END },
+    { "latency",
+            (fcmd_t) ddisk_latency,
+            DEFAULT,
+            DEFAULT,
+            "Set the transfer timing",
+            "Set the number of cycles needed to transfer a sector "
+            "and the number of cycles a command waits before the transfer",
+            REQ INT "sector/cycles per sector" NEXT
+                    OPT INT "command/cycles per command" END },
     { "fill",
             (fcmd_t) ddisk_fill,
             DEFAULT,
@@ -872,7 +1214,6 @@ device_type_t ddisk = {
 
     /* Functions */
     .done = ddisk_done,
-    .step = ddisk_step,
     .read32 = ddisk_read32,
     .write32 = ddisk_write32,
 
@@ -64,6 +64,24 @@ const device_type_t *device_types[DEVICE_TYPE_COUNT] = {
 /* List of all devices */
 list_t device_list = LIST_INITIALIZER;
 
+/** Device bus
+ *
+ * Disjoint segments of the physical address space decoded by at least
+ * one device, sorted by their addresses. Rebuilt whenever a device is
+ * added or removed.
+ *
+ */
+static dev_bus_segment_t *bus_segments = NULL;
+static size_t bus_segment_count = 0;
+
+/** Devices matching each filter
+ *
+ * Rebuilt whenever a device is added or removed so that the devices
+ * stepped every cycle do not have to be filtered from the device list.
+ *
+ */
+static device_array_t dev_arrays[DEVICE_FILTER_COUNT];
+
 /** Search for device type and allocates device structure
  *
  * @param type_string Exact name of device type.
@@ -107,6 +125,8 @@ device_t *alloc_device(const char *type_string, const char *device_name)
     dev->type = device_type;
     dev->name = safe_strdup(device_name);
     dev->data = NULL;
+    dev->mmio_addr = 0;
+    dev->mmio_size = 0;
     item_init(&dev->item);
 
     return dev;
@@ -122,9 +142,139 @@ void free_device(device_t *dev)
     safe_free(dev);
 }
 
+static int compare_addr(const void *a, const void *b)
+{
+    ptr36_t addr_a = *((const ptr36_t *) a);
+    ptr36_t addr_b = *((const ptr36_t *) b);
+
+    if (addr_a < addr_b) {
+        return -1;
+    }
+
+    return (addr_a > addr_b) ? 1 : 0;
+}
+
+static void bus_clear(void)
+{
+    for (size_t i = 0; i < bus_segment_count; i++) {
+        safe_free(bus_segments[i].devices);
+    }
+
+    safe_free(bus_segments);
+    bus_segment_count = 0;
+}
+
+/** Rebuild the device bus from the registers of all devices
+ *
+ * Every segment lies between two neighbouring register boundaries,
+ * hence all addresses of a segment are decoded by the same devices.
+ *
+ */
+static void bus_rebuild(void)
+{
+    bus_clear();
+
+    size_t count = 0;
+    device_t *dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+        if (dev->mmio_size > 0) {
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    /* Sorted register boundaries */
+    ptr36_t *bounds = safe_malloc(2 * count * sizeof(ptr36_t));
+    size_t bound_count = 0;
+
+    dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+        if (dev->mmio_size > 0) {
+            bounds[bound_count++] = dev->mmio_addr;
+            bounds[bound_count++] = dev->mmio_addr + dev->mmio_size;
+        }
+    }
+
+    qsort(bounds, bound_count, sizeof(ptr36_t), compare_addr);
+
+    bus_segments = safe_malloc(bound_count * sizeof(dev_bus_segment_t));
+
+    for (size_t i = 0; i + 1 < bound_count; i++) {
+        ptr36_t start = bounds[i];
+        ptr36_t end = bounds[i + 1];
+
+        if (start == end) {
+            continue;
+        }
+
+        device_t **devices = safe_malloc(count * sizeof(device_t *));
+        size_t device_count = 0;
+
+        dev = NULL;
+        while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+            if ((dev->mmio_size > 0) && (dev->mmio_addr <= start)
+                    && (end <= dev->mmio_addr + dev->mmio_size)) {
+                devices[device_count++] = dev;
+            }
+        }
+
+        if (device_count == 0) {
+            safe_free(devices);
+            continue;
+        }
+
+        dev_bus_segment_t *segment = &bus_segments[bus_segment_count++];
+        segment->start = start;
+        segment->end = end;
+        segment->count = device_count;
+        segment->devices = devices;
+    }
+
+    safe_free(bounds);
+}
+
+static bool dev_match_to_filter(device_t *device, device_filter_t filter);
+
+/** Rebuild the arrays of devices matching each filter
+ *
+ */
+static void arrays_rebuild(void)
+{
+    size_t count = 0;
+    device_t *dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+        count++;
+    }
+
+    for (unsigned int filter = 0; filter < DEVICE_FILTER_COUNT; filter++) {
+        device_array_t *array = &dev_arrays[filter];
+
+        safe_free(array->devices);
+        array->count = 0;
+
+        if (count == 0) {
+            continue;
+        }
+
+        array->devices = safe_malloc(count * sizeof(device_t *));
+
+        dev = NULL;
+        while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+            if (dev_match_to_filter(dev, filter)) {
+                array->devices[array->count++] = dev;
+            }
+        }
+    }
+}
+
 void add_device(device_t *dev)
 {
     list_append(&device_list, &dev->item);
+    arrays_rebuild();
+    bus_rebuild();
 }
 
 /** Test device according to the given filter condition.
@@ -147,11 +297,11 @@ static bool dev_match_to_filter(device_t *device, device_filter_t filter)
     case DEVICE_FILTER_STEP4K:
         return device->type->step4k != NULL;
     case DEVICE_FILTER_MEMORY:
-        return (strcmp(device->type->name, "rom") == 0) || (strcmp(device->type->name, "rwm") == 0);
+        return (device->type == &drom) || (device->type == &drwm);
     case DEVICE_FILTER_R4K_PROCESSOR:
-        return (strcmp(device->type->name, "dr4kcpu") == 0);
+        return device->type == &dr4kcpu;
     case DEVICE_FILTER_RV_PROCESSOR:
-        return (strcmp(device->type->name, "drvcpu") == 0);
+        return device->type == &drvcpu;
     default:
         die(ERR_INTERN, "Unexpected device filter");
     }
@@ -191,6 +341,22 @@ bool dev_next(device_t **device, device_filter_t filter)
     return false;
 }
 
+/** Get the devices specified by the given filter
+ *
+ * Cheaper than iterating by dev_next, the returned array is valid
+ * until a device is added or removed.
+ *
+ * @param filter Used to return only a special kind of devices.
+ *
+ * @return Array of the matching devices in the order of addition.
+ *
+ */
+const device_array_t *dev_array(device_filter_t filter)
+{
+    ASSERT(filter < DEVICE_FILTER_COUNT);
+    return &dev_arrays[filter];
+}
+
 /** Return the first device type starting with the specified prefix.
  *
  * Used for getting text completion in console.
@@ -316,6 +482,53 @@ device_t *dev_by_name(const char *searched_name)
 void dev_remove(device_t *device)
 {
     list_remove(&device_list, &device->item);
+    arrays_rebuild();
+    bus_rebuild();
+}
+
+/** Set the range of physical addresses decoded by a device
+ *
+ * Memory accesses outside of the physical memory are passed only to
+ * the devices decoding the accessed address. Has to be called before
+ * the device is added to the machine.
+ *
+ * @param dev  Device decoding the range.
+ * @param addr First address of the device registers.
+ * @param size Size of the device registers.
+ *
+ */
+void dev_map_range(device_t *dev, ptr36_t addr, len36_t size)
+{
+    dev->mmio_addr = addr;
+    dev->mmio_size = size;
+}
+
+/** Find the segment of the device bus containing the given address
+ *
+ * @param addr Physical address.
+ *
+ * @return The segment or NULL if no device decodes the address.
+ *
+ */
+const dev_bus_segment_t *dev_bus_find(ptr36_t addr)
+{
+    size_t lo = 0;
+    size_t hi = bus_segment_count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const dev_bus_segment_t *segment = &bus_segments[mid];
+
+        if (addr < segment->start) {
+            hi = mid;
+        } else if (addr >= segment->end) {
+            lo = mid + 1;
+        } else {
+            return segment;
+        }
+    }
+
+    return NULL;
 }
 
 /** Generic help generation
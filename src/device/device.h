@@ -36,6 +36,22 @@ typedef struct {
     /** Called every machine cycle. */
     void (*step)(struct device *dev);
 
+    /** Simulate up to the given number of machine cycles at once
+        and return the number of simulated cycles (at least one).
+        Called instead of step when the device is the only one
+        stepped (or each device is stepped by its own thread in the
+        parallel mode) and no cycle has to be observed individually. */
+    uint64_t (*step_block)(struct device *dev, uint64_t max_cycles);
+
+    /** Return the number of the following machine cycles (at most
+        max_cycles) in which the device would only wait for an event,
+        or zero if it has to be stepped. */
+    uint64_t (*idle_cycles)(struct device *dev, uint64_t max_cycles);
+
+    /** Simulate the given number of machine cycles the device waits
+        in at once (at most the number returned by idle_cycles). */
+    void (*idle_skip)(struct device *dev, uint64_t cycles);
+
     /** Called every 4096th machine cycle. */
     void (*step4k)(struct device *dev);
 
@@ -71,8 +87,22 @@ typedef struct device {
                      Must be unique. */
     void *data; /**< Device specific pointer where
                      internal data are stored. */
+
+    ptr36_t mmio_addr; /**< First address of the registers. */
+    len36_t mmio_size; /**< Size of the registers (0 if none). */
 } device_t;
 
+/** Part of the physical address space decoded by the same devices
+ *
+ */
+typedef struct {
+    ptr36_t start; /**< First address of the segment. */
+    ptr36_t end; /**< First address after the segment. */
+
+    size_t count; /**< Number of devices decoding the segment. */
+    device_t **devices; /**< Devices in the order of addition. */
+} dev_bus_segment_t;
+
 typedef enum {
     DEVICE_FILTER_ALL,
     DEVICE_FILTER_STEP,
@@ -80,8 +110,17 @@ typedef enum {
     DEVICE_FILTER_MEMORY,
     DEVICE_FILTER_R4K_PROCESSOR,
     DEVICE_FILTER_RV_PROCESSOR,
+    DEVICE_FILTER_COUNT
 } device_filter_t;
 
+/** Devices matching a filter in the order of addition
+ *
+ */
+typedef struct {
+    size_t count;
+    device_t **devices;
+} device_array_t;
+
 /**
  * LAST_CMD is used in device sources to determine the last command. That's
  * only a null-command with all parameters NULL.
@@ -109,6 +148,10 @@ extern size_t dev_count_by_partial_name(const char *prefix_name,
         device_t **device);
 
 extern bool dev_next(device_t **dev, device_filter_t filter);
+extern const device_array_t *dev_array(device_filter_t filter);
+
+extern void dev_map_range(device_t *dev, ptr36_t addr, len36_t size);
+extern const dev_bus_segment_t *dev_bus_find(ptr36_t addr);
 
 /*
  * General utilities
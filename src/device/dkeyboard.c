@@ -102,6 +102,7 @@ static bool dkeyboard_init(token_t *parm, device_t *dev)
 
     /* Initialization */
     data->addr = addr;
+    dev_map_range(dev, addr, REGISTER_LIMIT);
     data->intno = _intno;
     data->ig = false;
     data->intrcount = 0;
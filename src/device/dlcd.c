@@ -109,6 +109,7 @@ static bool dlcd_init(token_t *parm, device_t *dev)
     memset(data->buffer, 0, rows * cols);
 
     data->addr = addr;
+    dev_map_range(dev, addr, REGISTER_LIMIT);
 
     return true;
 }
@@ -48,6 +48,7 @@ static void dnomem_access32_break(const char *operation_name, device_t *dev, ptr
     alert("Entering interactive mode because of invalid %s (at %#011" PRIx64 ", %#" PRIx64 " inside %s).",
             operation_name, addr, offset, dev->name);
     machine_interactive = true;
+    machine_instrumented = true;
 }
 
 static void dnomem_access32_halt(const char *operation_name, device_t *dev, ptr36_t addr, ptr36_t offset)
@@ -107,6 +108,7 @@ static bool dnomem_init(token_t *parm, device_t *dev)
     /* Basic structure inicialization */
     data->addr = start_addr;
     data->size = size;
+    dev_map_range(dev, start_addr, size);
     data->mode = &access_mode_warn;
     data->register_dump = false;
 
@@ -116,6 +116,7 @@ static bool dorder_init(token_t *parm, device_t *dev)
 
     /* Initialize */
     data->addr = addr;
+    dev_map_range(dev, addr, REGISTER_LIMIT);
     data->intno = _intno;
     data->cmds = 0;
 
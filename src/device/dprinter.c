@@ -68,6 +68,7 @@ static bool dprinter_init(token_t *parm, device_t *dev)
 
     /* Initialization */
     data->addr = addr;
+    dev_map_range(dev, addr, REGISTER_LIMIT);
     data->file = stdout;
     data->fname = NULL;
     data->count = 0;
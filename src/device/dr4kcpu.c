@@ -284,7 +284,7 @@ static bool dr4kcpu_break(token_t *parm, device_t *dev)
 
     breakpoint_t *bp = breakpoint_init(addr,
             BREAKPOINT_KIND_SIMULATOR);
-    list_append(&cpu->bps, &bp->item);
+    breakpoint_add(&cpu->bps, bp);
 
     return true;
 }
@@ -330,8 +330,7 @@ static bool dr4kcpu_br(token_t *parm, device_t *dev)
     for_each(cpu->bps, bp, breakpoint_t)
     {
         if (bp->pc.ptr == addr) {
-            list_remove(&cpu->bps, &bp->item);
-            safe_free(bp);
+            breakpoint_remove(&cpu->bps, bp);
             fnd = true;
             break;
         }
@@ -288,6 +288,45 @@ static bool drvcpu_set_asid_len(token_t *parm, device_t *dev)
     return true;
 }
 
+/**
+ * MTIME command implementation
+ */
+static bool drvcpu_mtime(token_t *parm, device_t *dev)
+{
+    ASSERT(dev != NULL);
+
+    const char *mode = parm_str_next(&parm);
+    rv_mtime_source_t source;
+    uint64_t period;
+
+    if (strcmp(mode, "host") == 0) {
+        source = rv_mtime_host;
+        period = RV_MTIME_HOST_PERIOD;
+    } else if (strcmp(mode, "cycles") == 0) {
+        source = rv_mtime_cycles;
+        period = RV_MTIME_CYCLES_PERIOD;
+    } else if (strcmp(mode, "skip") == 0) {
+        source = rv_mtime_skip;
+        period = RV_MTIME_CYCLES_PERIOD;
+    } else {
+        error("Unknown mtime source %s (host, cycles or skip expected)", mode);
+        return false;
+    }
+
+    if (parm_type(parm) == tt_uint) {
+        period = parm_uint_next(&parm);
+
+        if (period == 0) {
+            error("Period cannot be 0");
+            return false;
+        }
+    }
+
+    rv32_csr_set_mtime_source(get_rv(dev), source, period);
+
+    return true;
+}
+
 /**
  * Done device operation
  */
@@ -306,6 +345,30 @@ static void drvcpu_step(device_t *dev)
     rv32_cpu_step(get_rv(dev));
 }
 
+/**
+ * Block step device operation
+ */
+static uint64_t drvcpu_step_block(device_t *dev, uint64_t max_cycles)
+{
+    return rv32_cpu_step_block(get_rv(dev), max_cycles);
+}
+
+/**
+ * Idle cycles device operation
+ */
+static uint64_t drvcpu_idle_cycles(device_t *dev, uint64_t max_cycles)
+{
+    return rv32_cpu_idle_cycles(get_rv(dev), max_cycles);
+}
+
+/**
+ * Idle skip device operation
+ */
+static void drvcpu_idle_skip(device_t *dev, uint64_t cycles)
+{
+    rv32_cpu_idle_skip(get_rv(dev), cycles);
+}
+
 /**
  * Device commands specification
  */
@@ -402,7 +465,15 @@ cmd_t drvcpu_cmds[] = {
             DEFAULT,
             "Changes the bit-length of ASIDs",
             "Changes the number of usable bits in the ASID field of the SATP CSR, zeroes-out any deactivated bits and flushes the TLB.",
-            REQ INT "ASID length" END }
+            REQ INT "ASID length" END },
+    { "mtime",
+            (fcmd_t) drvcpu_mtime,
+            DEFAULT,
+            DEFAULT,
+            "Selects the source of mtime",
+            "Selects the source of mtime: host time sampled every given number of cycles and when mtime is read (host), time ticking once per given number of cycles (cycles), or the same which also skips to mtimecmp when waiting for the timer interrupt (skip).",
+            REQ STR "mode/host, cycles or skip" NEXT
+                    OPT INT "period/number of cycles" END }
 };
 
 /**
@@ -419,6 +490,9 @@ device_type_t drvcpu = {
 
     .done = drvcpu_done,
     .step = drvcpu_step,
+    .step_block = drvcpu_step_block,
+    .idle_cycles = drvcpu_idle_cycles,
+    .idle_skip = drvcpu_idle_skip,
 
     .cmds = drvcpu_cmds
 };
@@ -70,6 +70,7 @@ static bool dtime_init(token_t *parm, device_t *dev)
     dev->data = data;
 
     data->addr = addr;
+    dev_map_range(dev, addr, REGISTER_LIMIT);
 
     return true;
 }
@@ -0,0 +1,201 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Simulated time events
+ *
+ *  The pending events are kept in a binary min-heap ordered by
+ *  the machine cycle, so that devices waiting for some time to
+ *  pass do not have to be stepped every cycle.
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../assert.h"
+#include "../utils.h"
+#include "event.h"
+
+/** Initial capacity of the event queue */
+#define INITIAL_QUEUE_SIZE 16
+
+uint64_t machine_cycles = 0;
+_Thread_local uint64_t machine_block_cycles = 0;
+_Thread_local uint64_t machine_slice_cycles = 0;
+uint64_t event_next_cycle = UINT64_MAX;
+
+/** Event queue (binary min-heap) */
+static event_t **queue = NULL;
+static size_t queue_count = 0;
+static size_t queue_size = 0;
+
+/** Counter of scheduled events */
+static uint64_t schedule_order = 0;
+
+static bool event_before(const event_t *a, const event_t *b)
+{
+    if (a->cycle != b->cycle) {
+        return a->cycle < b->cycle;
+    }
+
+    return a->order < b->order;
+}
+
+static void queue_set(size_t index, event_t *event)
+{
+    queue[index] = event;
+    event->index = index;
+}
+
+static void sift_up(size_t index)
+{
+    event_t *event = queue[index];
+
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!event_before(event, queue[parent])) {
+            break;
+        }
+
+        queue_set(index, queue[parent]);
+        index = parent;
+    }
+
+    queue_set(index, event);
+}
+
+static void sift_down(size_t index)
+{
+    event_t *event = queue[index];
+
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= queue_count) {
+            break;
+        }
+
+        if ((child + 1 < queue_count) && (event_before(queue[child + 1], queue[child]))) {
+            child++;
+        }
+
+        if (!event_before(queue[child], event)) {
+            break;
+        }
+
+        queue_set(index, queue[child]);
+        index = child;
+    }
+
+    queue_set(index, event);
+}
+
+static void update_next_cycle(void)
+{
+    event_next_cycle = (queue_count > 0) ? queue[0]->cycle : UINT64_MAX;
+}
+
+/** Initialize an event
+ *
+ * @param event Event to initialize.
+ * @param fnc   Function called when the event happens.
+ * @param data  Owner specific data.
+ *
+ */
+void event_init(event_t *event, event_fnc_t fnc, void *data)
+{
+    ASSERT(event != NULL);
+    ASSERT(fnc != NULL);
+
+    event->cycle = 0;
+    event->fnc = fnc;
+    event->data = data;
+    event->index = EVENT_NOT_SCHEDULED;
+    event->order = 0;
+}
+
+/** Schedule an event
+ *
+ * An event which is already scheduled is moved to the new cycle.
+ * Events scheduled to a cycle which has already been completed
+ * happen as soon as possible.
+ *
+ * @param event Event to schedule.
+ * @param cycle Machine cycle of the event.
+ *
+ */
+void event_schedule(event_t *event, uint64_t cycle)
+{
+    ASSERT(event != NULL);
+
+    if (event_scheduled(event)) {
+        event_cancel(event);
+    }
+
+    if (queue_count == queue_size) {
+        queue_size = (queue_size == 0) ? INITIAL_QUEUE_SIZE : 2 * queue_size;
+
+        event_t **new_queue = safe_malloc(queue_size * sizeof(event_t *));
+        for (size_t i = 0; i < queue_count; i++) {
+            new_queue[i] = queue[i];
+        }
+
+        safe_free(queue);
+        queue = new_queue;
+    }
+
+    event->cycle = cycle;
+    event->order = schedule_order++;
+
+    queue_set(queue_count, event);
+    queue_count++;
+    sift_up(event->index);
+
+    update_next_cycle();
+}
+
+/** Remove an event from the queue
+ *
+ * Does nothing if the event is not scheduled.
+ *
+ */
+void event_cancel(event_t *event)
+{
+    ASSERT(event != NULL);
+
+    if (!event_scheduled(event)) {
+        return;
+    }
+
+    size_t index = event->index;
+    event->index = EVENT_NOT_SCHEDULED;
+
+    queue_count--;
+    if (index < queue_count) {
+        queue_set(index, queue[queue_count]);
+
+        if ((index > 0) && (event_before(queue[index], queue[(index - 1) / 2]))) {
+            sift_up(index);
+        } else {
+            sift_down(index);
+        }
+    }
+
+    update_next_cycle();
+}
+
+/** Fire all events of the completed machine cycles
+ *
+ * The events are fired in the order of their cycles, events
+ * of the same cycle in the order they have been scheduled.
+ *
+ */
+void event_run(void)
+{
+    while ((queue_count > 0) && (queue[0]->cycle <= machine_cycles)) {
+        event_t *event = queue[0];
+        event_cancel(event);
+        event->fnc(event);
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Simulated time events
+ *
+ */
+
+#ifndef EVENT_H_
+#define EVENT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Position of an event which is not scheduled */
+#define EVENT_NOT_SCHEDULED SIZE_MAX
+
+struct event;
+
+typedef void (*event_fnc_t)(struct event *event);
+
+/** Event to happen at a given machine cycle
+ *
+ * The event is fired when the given number of machine cycles
+ * has been completed, i.e. before the cycle with the given
+ * number is simulated.
+ *
+ */
+typedef struct event {
+    /** Machine cycle of the event */
+    uint64_t cycle;
+
+    /** Called when the event happens */
+    event_fnc_t fnc;
+
+    /** Owner specific data */
+    void *data;
+
+    /** Position in the event queue */
+    size_t index;
+
+    /** Scheduling order among the events of the same cycle */
+    uint64_t order;
+} event_t;
+
+/** Total number of machine cycles completed */
+extern uint64_t machine_cycles;
+
+/** Machine cycles completed within the running block of cycles
+ *
+ * Devices simulating several cycles at once (step_block) have to
+ * keep it up to date so that the current cycle is observed exactly.
+ *
+ */
+extern _Thread_local uint64_t machine_block_cycles;
+
+/** Machine cycles completed within the running parallel slice
+ *
+ * Each thread stepping a device in the parallel mode has its own
+ * progress within the slice.
+ *
+ */
+extern _Thread_local uint64_t machine_slice_cycles;
+
+/** Machine cycle of the earliest event (UINT64_MAX if none) */
+extern uint64_t event_next_cycle;
+
+/** Number of the machine cycle being simulated */
+static inline uint64_t machine_current_cycle(void)
+{
+    return machine_cycles + machine_slice_cycles + machine_block_cycles;
+}
+
+extern void event_init(event_t *event, event_fnc_t fnc, void *data);
+extern void event_schedule(event_t *event, uint64_t cycle);
+extern void event_cancel(event_t *event);
+extern void event_run(void);
+
+/** Check whether an event is waiting in the queue */
+static inline bool event_scheduled(const event_t *event)
+{
+    return event->index != EVENT_NOT_SCHEDULED;
+}
+
+#endif
@@ -0,0 +1,324 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Parallel execution of the processors
+ *
+ *  In the parallel mode the stepped devices (the processors) run
+ *  slices of machine cycles, each on its own host thread. The first
+ *  device is stepped by the main thread. The physical memory is shared,
+ *  the other devices are accessed under a single lock and the interrupts
+ *  raised for other processors are delivered at the end of the slice,
+ *  where also the events and the step4k functions are run.
+ *
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../assert.h"
+#include "../fault.h"
+#include "../main.h"
+#include "../physmem.h"
+#include "../utils.h"
+#include "cpu/instr_cache.h"
+#include "event.h"
+#include "parallel.h"
+
+/** Initial capacity of the deferred interrupt queue */
+#define INITIAL_DEFERRED_SIZE 16
+
+uint64_t parallel_quantum = 0;
+bool parallel_running = false;
+
+/** Thread stepping one of the devices */
+typedef struct {
+    pthread_t thread;
+
+    /** Thread number (the main thread is number zero) */
+    unsigned int number;
+
+    /** Device to step in the current slice (NULL if none) */
+    device_t *dev;
+
+    /** Cycles simulated in the current slice */
+    uint64_t cycles;
+} worker_t;
+
+/** Interrupt of another processor raised within the slice */
+typedef struct {
+    general_cpu_t *cpu;
+    unsigned int no;
+    bool up;
+} deferred_interrupt_t;
+
+static worker_t workers[MAX_CPUS];
+static size_t worker_count = 0;
+
+/** Slice coordination */
+static pthread_mutex_t slice_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t slice_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t slice_done = PTHREAD_COND_INITIALIZER;
+static unsigned int slice_number = 0;
+static size_t slice_pending = 0;
+static uint64_t slice_cycles = 0;
+
+/** Lock of the devices which are not stepped (recursive) */
+static pthread_mutex_t device_mutex;
+
+/** Interrupts delivered at the end of the slice */
+static pthread_mutex_t deferred_mutex = PTHREAD_MUTEX_INITIALIZER;
+static deferred_interrupt_t *deferred = NULL;
+static size_t deferred_count = 0;
+static size_t deferred_size = 0;
+
+/** Device stepped by the current thread within the slice */
+static _Thread_local device_t *thread_device = NULL;
+
+/** Step a device for the given number of cycles
+ *
+ * Waiting processors skip the cycles and blocks of cycles
+ * are simulated at once whenever the device supports it.
+ *
+ * @return The number of simulated cycles (less than requested
+ *         when the machine was halted).
+ *
+ */
+static uint64_t run_slice(device_t *dev, uint64_t cycles)
+{
+    thread_device = dev;
+    machine_slice_cycles = 0;
+
+    while ((machine_slice_cycles < cycles) && (!machine_halt)) {
+        uint64_t max_cycles = cycles - machine_slice_cycles;
+        uint64_t done = 0;
+
+        if (dev->type->idle_cycles != NULL) {
+            done = dev->type->idle_cycles(dev, max_cycles);
+            if (done > 0) {
+                dev->type->idle_skip(dev, done);
+            }
+        }
+
+        if (done == 0) {
+            if (dev->type->step_block != NULL) {
+                done = dev->type->step_block(dev, max_cycles);
+            } else {
+                dev->type->step(dev);
+                done = 1;
+            }
+        }
+
+        machine_slice_cycles += done;
+    }
+
+    uint64_t done = machine_slice_cycles;
+
+    machine_slice_cycles = 0;
+    thread_device = NULL;
+
+    return done;
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t *worker = (worker_t *) arg;
+    unsigned int seen = 0;
+
+    frame_valid_bit = UINT64_C(1) << worker->number;
+    instr_cache_thread_init();
+
+    pthread_mutex_lock(&slice_mutex);
+
+    while (true) {
+        while (slice_number == seen) {
+            pthread_cond_wait(&slice_start, &slice_mutex);
+        }
+
+        seen = slice_number;
+        device_t *dev = worker->dev;
+        uint64_t cycles = slice_cycles;
+
+        pthread_mutex_unlock(&slice_mutex);
+
+        if (dev != NULL) {
+            instr_cache_thread_sync();
+            worker->cycles = run_slice(dev, cycles);
+        }
+
+        pthread_mutex_lock(&slice_mutex);
+
+        if (--slice_pending == 0) {
+            pthread_cond_signal(&slice_done);
+        }
+    }
+
+    return NULL;
+}
+
+/** Start the worker threads for the given number of devices
+ *
+ */
+static void start_workers(size_t count)
+{
+    if (worker_count == 0) {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&device_mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    while (worker_count + 1 < count) {
+        worker_t *worker = &workers[worker_count];
+        worker->number = worker_count + 1;
+        worker->dev = NULL;
+
+        /* The workers wait for the next slice */
+        pthread_mutex_lock(&slice_mutex);
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            die(ERR_INTERN, "Unable to create a thread for the parallel mode");
+        }
+        worker_count++;
+        pthread_mutex_unlock(&slice_mutex);
+    }
+}
+
+/** Deliver the interrupts raised within the slice
+ *
+ */
+static void deliver_deferred(void)
+{
+    for (size_t i = 0; i < deferred_count; i++) {
+        if (deferred[i].up) {
+            cpu_interrupt_up(deferred[i].cpu, deferred[i].no);
+        } else {
+            cpu_interrupt_down(deferred[i].cpu, deferred[i].no);
+        }
+    }
+
+    deferred_count = 0;
+}
+
+/** Run a slice of machine cycles of the devices in parallel
+ *
+ * Each device is stepped by its own thread, the slice is finished
+ * when all the devices completed it (or the machine was halted).
+ *
+ * @param devices The stepped devices (at most MAX_CPUS).
+ * @param cycles  Length of the slice.
+ *
+ * @return The number of simulated cycles (the least number
+ *         of cycles simulated by a device when halted).
+ *
+ */
+uint64_t parallel_step(const device_array_t *devices, uint64_t cycles)
+{
+    ASSERT(devices->count > 0);
+    ASSERT(devices->count <= MAX_CPUS);
+    ASSERT(cycles > 0);
+
+    start_workers(devices->count);
+
+    pthread_mutex_lock(&slice_mutex);
+
+    for (size_t i = 0; i < worker_count; i++) {
+        workers[i].dev = (i + 1 < devices->count) ? devices->devices[i + 1] : NULL;
+    }
+
+    slice_cycles = cycles;
+    slice_pending = worker_count;
+    slice_number++;
+    parallel_running = true;
+
+    pthread_cond_broadcast(&slice_start);
+    pthread_mutex_unlock(&slice_mutex);
+
+    uint64_t done = run_slice(devices->devices[0], cycles);
+
+    pthread_mutex_lock(&slice_mutex);
+
+    while (slice_pending > 0) {
+        pthread_cond_wait(&slice_done, &slice_mutex);
+    }
+
+    for (size_t i = 0; i + 1 < devices->count; i++) {
+        done = MIN(done, workers[i].cycles);
+    }
+
+    parallel_running = false;
+    pthread_mutex_unlock(&slice_mutex);
+
+    deliver_deferred();
+
+    /* The halting cycle was simulated */
+    return MAX(done, 1);
+}
+
+/** Lock the devices which are not stepped
+ *
+ * The lock is recursive, it has to be held while such a device
+ * is accessed in the parallel mode.
+ *
+ */
+void parallel_device_lock(void)
+{
+    if (parallel_running) {
+        pthread_mutex_lock(&device_mutex);
+    }
+}
+
+/** Unlock the devices which are not stepped
+ *
+ */
+void parallel_device_unlock(void)
+{
+    if (parallel_running) {
+        pthread_mutex_unlock(&device_mutex);
+    }
+}
+
+/** Defer an interrupt of another processor to the end of the slice
+ *
+ * The state of a processor is changed only by the thread stepping it.
+ * The stepped devices are the processors, their data is the general
+ * processor structure.
+ *
+ * @param cpu Target processor.
+ * @param no  Interrupt number.
+ * @param up  Raise (true) or cancel (false) the interrupt.
+ *
+ * @return False if the interrupt can be delivered immediately.
+ *
+ */
+bool parallel_defer_interrupt(general_cpu_t *cpu, unsigned int no, bool up)
+{
+    if ((!parallel_running)
+            || ((thread_device != NULL) && (thread_device->data == cpu))) {
+        return false;
+    }
+
+    pthread_mutex_lock(&deferred_mutex);
+
+    if (deferred_count == deferred_size) {
+        deferred_size = (deferred_size == 0) ? INITIAL_DEFERRED_SIZE : 2 * deferred_size;
+
+        deferred_interrupt_t *new_deferred = safe_malloc(deferred_size * sizeof(deferred_interrupt_t));
+        for (size_t i = 0; i < deferred_count; i++) {
+            new_deferred[i] = deferred[i];
+        }
+
+        safe_free(deferred);
+        deferred = new_deferred;
+    }
+
+    deferred[deferred_count].cpu = cpu;
+    deferred[deferred_count].no = no;
+    deferred[deferred_count].up = up;
+    deferred_count++;
+
+    pthread_mutex_unlock(&deferred_mutex);
+    return true;
+}
@@ -0,0 +1,38 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Parallel execution of the processors
+ *
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cpu/general_cpu.h"
+#include "device.h"
+
+/** Default length of a parallel slice in machine cycles */
+#define DEFAULT_PARALLEL_QUANTUM 1024
+
+/** Maximal length of a parallel slice (the step4k period) */
+#define MAX_PARALLEL_QUANTUM 4096
+
+/** Length of a parallel slice in machine cycles (zero for lock-step mode) */
+extern uint64_t parallel_quantum;
+
+/** The processors are running in parallel right now */
+extern bool parallel_running;
+
+extern uint64_t parallel_step(const device_array_t *devices, uint64_t cycles);
+
+extern void parallel_device_lock(void);
+extern void parallel_device_unlock(void);
+
+extern bool parallel_defer_interrupt(general_cpu_t *cpu, unsigned int no,
+        bool up);
+
+#endif
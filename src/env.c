@@ -16,10 +16,13 @@
 #include "assert.h"
 #include "device/cpu/mips_r4000/cpu.h"
 #include "device/cpu/mips_r4000/debug.h"
+#include "device/cpu/instr_cache.h"
+#include "device/cpu/instr_stats.h"
 #include "device/cpu/riscv_rv32ima/debug.h"
 #include "env.h"
 #include "fault.h"
 #include "parser.h"
+#include "profile.h"
 #include "utils.h"
 
 /*
@@ -144,6 +147,14 @@ const env_t global_env[] = {
             vt_uint,
             NULL,
             NULL },
+    { "cachesize",
+            "Decoded instruction cache size",
+            "Maximal number of physical pages with decoded instructions "
+            "kept by each processor architecture. Pages which have not "
+            "been used recently are evicted when the limit is reached.",
+            vt_uint,
+            &instr_cache_capacity,
+            instr_cache_set_capacity },
     { "disassembling",
             "Disassembling features",
             NULL,
@@ -210,6 +221,47 @@ const env_t global_env[] = {
             vt_bool,
             &machine_trace,
             NULL },
+    { "profiling",
+            "Profiling features",
+            NULL,
+            vt_uint,
+            NULL,
+            NULL },
+    { "profile",
+            "Sample the executed code",
+            "Sample the program counter of each processor every "
+            "profperiod cycles. The samples are reported by the "
+            "profile command.",
+            vt_bool,
+            &profile_enabled,
+            profile_set_enabled },
+    { "profperiod",
+            "Sampling period",
+            "Number of machine cycles between two samples of the "
+            "program counters.",
+            vt_uint,
+            &profile_period,
+            profile_set_period },
+    { "profra",
+            "Sample return addresses",
+            "Sample also the return address register (ra) so that "
+            "the folded stacks contain the callers of the sampled "
+            "functions. Only in the leaf functions the register "
+            "surely points to the caller, in the other functions "
+            "it can point after their last call.",
+            vt_bool,
+            &profile_ra,
+            NULL },
+    { "istat",
+            "Count executed instructions",
+            "Count the executions, the exceptions and the accessed "
+            "memory bytes of each instruction. The decoded code is "
+            "invalidated when the variable changes. The counters are "
+            "reported by the istat command (and by stat). In the "
+            "parallel simulation the counts are approximate.",
+            vt_bool,
+            &instr_stats_enabled,
+            instr_stats_set_enabled },
     LAST_ENV
 };
 
@@ -29,12 +29,15 @@
 #include "device/cpu/mips_r4000/debug.h"
 #include "device/device.h"
 #include "device/dr4kcpu.h"
+#include "device/event.h"
+#include "device/parallel.h"
 #include "endian.h"
 #include "env.h"
 #include "fault.h"
 #include "input.h"
 #include "parser.h"
 #include "text.h"
+#include "trace.h"
 #include "utils.h"
 
 /** This is necessary evil... */
@@ -78,8 +81,8 @@ bool machine_nondet = false;
 /** Trace instructions */
 bool machine_trace = false;
 
-/** Halt the simulation */
-bool machine_halt = false;
+/** Halt the simulation (set by the parallel threads as well) */
+_Atomic bool machine_halt = false;
 
 /** Break the simulation */
 bool machine_break = false;
@@ -87,6 +90,16 @@ bool machine_break = false;
 /** Interactive mode */
 bool machine_interactive = false;
 
+/**
+ * Run the simulator loop with the tracing and debugging hooks
+ *
+ * Has to be set whenever any of the tracing or debugging modes
+ * is toggled on outside of the interactive mode. The instrumented
+ * loop clears it once none of the modes is active. Set by the parallel
+ * threads and the signal handlers as well.
+ */
+_Atomic bool machine_instrumented = true;
+
 /** Print newline on entering interactive mode */
 bool machine_newline = false;
 
@@ -105,12 +118,6 @@ bool machine_allow_interactive_without_tty = false;
  */
 uint64_t stepping = 0;
 
-/** SC-LL tracking */
-list_t sc_list;
-
-/** Total number of machine steps completed */
-static uint64_t steps = 0;
-
 /** Command line options */
 static struct option long_options[] = {
     { "trace",
@@ -153,6 +160,22 @@ static struct option long_options[] = {
             no_argument,
             0,
             'X' },
+    { "parallel",
+            optional_argument,
+            0,
+            'p' },
+    { "trace-file",
+            required_argument,
+            0,
+            'T' },
+    { "trace-thread",
+            no_argument,
+            0,
+            'F' },
+    { "trace-decode",
+            required_argument,
+            0,
+            'D' },
     { NULL, 0, NULL, 0 }
 };
 
@@ -201,14 +224,41 @@ static void setup_dap(const char *opt)
     alert("DAP debugging enabled for this session.");
 }
 
+/** Setup the parallel mode
+ *
+ */
+static void setup_parallel(const char *opt)
+{
+    parallel_quantum = DEFAULT_PARALLEL_QUANTUM;
+
+    // Quantum override
+    if (opt != NULL) {
+        char *endp = NULL;
+        const long int quantum = strtol(opt, &endp, 0);
+
+        if ((endp == opt) || (*endp != 0)) {
+            die(ERR_PARM, "Quantum expected");
+        }
+
+        if ((quantum < 1) || (quantum > MAX_PARALLEL_QUANTUM)) {
+            die(ERR_PARM, "Invalid quantum");
+        }
+
+        parallel_quantum = quantum;
+    }
+}
+
 static bool parse_cmdline(int argc, char *args[])
 {
     opterr = 0;
 
+    char *trace_file = NULL;
+    bool trace_thread = false;
+
     while (true) {
         int option_index = 0;
 
-        int c = getopt_long(argc, args, "tVic:hg:d::nXI",
+        int c = getopt_long(argc, args, "tVic:hg:d::nXIp::T:D:",
                 long_options, &option_index);
 
         if (c == -1) {
@@ -250,6 +300,23 @@ static bool parse_cmdline(int argc, char *args[])
         case 'X':
             machine_specific_instructions = false;
             break;
+        case 'p':
+            setup_parallel(optarg);
+            break;
+        case 'T':
+            if (trace_file) {
+                safe_free(trace_file);
+            }
+            trace_file = safe_strdup(optarg);
+            break;
+        case 'F':
+            trace_thread = true;
+            break;
+        case 'D':
+            if (!trace_decode(optarg)) {
+                die(ERR_IO, "Cannot decode the binary trace");
+            }
+            return false;
         case '?':
             die(ERR_PARM, "Unknown parameter or argument required");
             break;
@@ -262,6 +329,14 @@ static bool parse_cmdline(int argc, char *args[])
         die(ERR_PARM, "Unexpected arguments");
     }
 
+    if (trace_file) {
+        if (!trace_open(trace_file, trace_thread)) {
+            die(ERR_IO, "Cannot create the binary trace");
+        }
+
+        safe_free(trace_file);
+    }
+
     return true;
 }
 
@@ -312,100 +387,272 @@ static void dap_startup(void)
     }
 }
 
+/** Test whether each cycle has to be observed individually
+ *
+ * This is the case when tracing (also into a binary trace), with
+ * breakpoints, debugging or stepping.
+ *
+ */
+static bool machine_cycles_observed(void)
+{
+    return (machine_trace) || (trace_enabled) || (machine_interactive)
+            || (stepping > 0)
+            || (remote_gdb) || (dap_enabled)
+            || (!is_empty(&physmem_breakpoints));
+}
+
+/** Find the device which can be stepped in blocks of cycles
+ *
+ * Blocks can be simulated only if there is a single device
+ * to step.
+ *
+ * @return The device or NULL if the cycles have to be
+ *         simulated one by one.
+ *
+ */
+static device_t *machine_block_device(void)
+{
+    const device_array_t *step_devices = dev_array(DEVICE_FILTER_STEP);
+    if (step_devices->count != 1) {
+        return NULL;
+    }
+
+    device_t *dev = step_devices->devices[0];
+    return (dev->type->step_block != NULL) ? dev : NULL;
+}
+
+/** Skip the machine cycles all the stepped devices wait in
+ *
+ * The devices (the RISC-V processors in wfi) wait for an interrupt,
+ * which is raised either by the devices themselves (timers) or by
+ * an event or a step4k device function.
+ *
+ * @param max_cycles The maximal number of cycles to skip.
+ *
+ * @return The number of skipped cycles or zero if any
+ *         of the devices has to be stepped.
+ *
+ */
+static uint64_t machine_idle_skip(uint64_t max_cycles)
+{
+    const device_array_t *step_devices = dev_array(DEVICE_FILTER_STEP);
+    for (size_t i = 0; (i < step_devices->count) && (max_cycles > 0); i++) {
+        device_t *dev = step_devices->devices[i];
+
+        if (dev->type->idle_cycles == NULL) {
+            return 0;
+        }
+
+        max_cycles = dev->type->idle_cycles(dev, max_cycles);
+    }
+
+    if (max_cycles == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < step_devices->count; i++) {
+        device_t *dev = step_devices->devices[i];
+        dev->type->idle_skip(dev, max_cycles);
+    }
+
+    return max_cycles;
+}
+
+/** Test whether the stepped devices can run in parallel
+ *
+ * The parallel mode has to be enabled and there have to be
+ * more devices to step. Code breakpoints are checked only
+ * between the cycles.
+ *
+ */
+static bool machine_parallel(void)
+{
+    return (parallel_quantum > 0)
+            && (dev_array(DEVICE_FILTER_STEP)->count > 1)
+            && (!breakpoint_any_code_breakpoint());
+}
+
 /** Run 4096 machine cycles
+ *
+ * @param observed Each cycle has to be observed individually.
  *
  */
-static void machine_step(void)
+static void machine_step(bool observed)
 {
-    /* Execute device cycles */
+    uint64_t cycles = 0;
     device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_STEP)) {
-        dev->type->step(dev);
+
+    if (!observed) {
+        /* Do not skip over the step4k cycle nor any event */
+        uint64_t max_cycles = 4096 - (machine_cycles % 4096);
+        if (event_next_cycle <= machine_cycles) {
+            max_cycles = 1;
+        } else {
+            max_cycles = MIN(max_cycles, event_next_cycle - machine_cycles);
+        }
+
+        cycles = machine_idle_skip(max_cycles);
+
+        if ((cycles == 0) && (machine_parallel())) {
+            cycles = parallel_step(dev_array(DEVICE_FILTER_STEP),
+                    MIN(max_cycles, parallel_quantum));
+        }
+
+        if ((cycles == 0) && ((dev = machine_block_device()) != NULL)) {
+            cycles = dev->type->step_block(dev, max_cycles);
+        }
+    }
+
+    if (cycles == 0) {
+        /* Execute device cycles */
+        const device_array_t *step_devices = dev_array(DEVICE_FILTER_STEP);
+        for (size_t i = 0; i < step_devices->count; i++) {
+            dev = step_devices->devices[i];
+            dev->type->step(dev);
+        }
+
+        cycles = 1;
     }
 
     /* Increase machine cycle counter */
-    steps++;
+    machine_cycles += cycles;
+
+    /* Fire the events of the completed cycles */
+    if (event_next_cycle <= machine_cycles) {
+        event_run();
+    }
 
     /* Every 4096th cycle execute
        the step4k device functions */
-    if ((steps % 4096) == 0) {
-        dev = NULL;
-        while (dev_next(&dev, DEVICE_FILTER_STEP4K)) {
+    if ((machine_cycles % 4096) == 0) {
+        const device_array_t *step4k_devices = dev_array(DEVICE_FILTER_STEP4K);
+        for (size_t i = 0; i < step4k_devices->count; i++) {
+            dev = step4k_devices->devices[i];
             dev->type->step4k(dev);
         }
     }
 }
 
-/** Main simulator loop
+/** Test whether the simulator loop has to be instrumented
+ *
+ * This is the case when the cycles are observed individually
+ * or when the code breakpoints are checked between them.
  *
  */
-static void machine_run(void)
+static bool machine_instrumentation_needed(void)
 {
-    while (!machine_halt) {
-        /*
-         * Check for code breakpoints. Interactive
-         * or gdb flags will be set if a breakpoint
-         * is hit.
-         */
-        breakpoint_check_for_code_breakpoints();
-
-        /*
-         * If the remote GDB debugging is allowed and the
-         * connection has not been opened yet, then wait
-         * for the connection from the remote GDB.
-         */
-
-        if ((remote_gdb) && (!remote_gdb_conn)) {
-            machine_interactive = !gdb_startup();
-        }
+    return (machine_cycles_observed()) || (breakpoint_any_code_breakpoint());
+}
 
-        /*
-         * If the simulation was stopped due to the remote
-         * GDB debugging session, then read a command from
-         * the remote GDB. The read is blocking.
-         */
-        if ((remote_gdb) && (remote_gdb_conn) && (remote_gdb_listen)) {
-            remote_gdb_listen = false;
-            gdb_session();
-        }
+/** Simulator loop without any tracing or debugging hooks
+ *
+ * Runs until the machine halts or any of the tracing
+ * or debugging modes is toggled on.
+ *
+ */
+static void machine_run_plain(void)
+{
+    while ((!machine_halt) && (!machine_instrumented)) {
+        machine_step(false);
+    }
+}
 
-        // DAP
-        if (dap_enabled) {
-            // Startup DAP if enabled & not connected yet
-            if (dap_state == DAP_READY) {
-                dap_startup();
-            }
+/** Single iteration of the instrumented simulator loop
+ *
+ */
+static void machine_run_instrumented(void)
+{
+    /*
+     * Check for code breakpoints. Interactive
+     * or gdb flags will be set if a breakpoint
+     * is hit.
+     */
+    breakpoint_check_for_code_breakpoints();
 
-            // Process new DAP events
-            if (dap_state == DAP_CONNECTED) {
-                dap_process();
-            }
+    /*
+     * If the remote GDB debugging is allowed and the
+     * connection has not been opened yet, then wait
+     * for the connection from the remote GDB.
+     */
 
-            // TODO: avoid busy wait
-            if (dap_state != DAP_RUNNING && dap_state != DAP_DONE) {
-                continue;
-            }
+    if ((remote_gdb) && (!remote_gdb_conn)) {
+        machine_interactive = !gdb_startup();
+    }
+
+    /*
+     * If the simulation was stopped due to the remote
+     * GDB debugging session, then read a command from
+     * the remote GDB. The read is blocking.
+     */
+    if ((remote_gdb) && (remote_gdb_conn) && (remote_gdb_listen)) {
+        remote_gdb_listen = false;
+        gdb_session();
+    }
+
+    // DAP
+    if (dap_enabled) {
+        // Startup DAP if enabled & not connected yet
+        if (dap_state == DAP_READY) {
+            dap_startup();
         }
 
-        /* Stepping check */
-        if (stepping > 0) {
-            stepping--;
+        // Process new DAP events
+        if (dap_state == DAP_CONNECTED) {
+            dap_process();
+        }
 
-            if (stepping == 0) {
-                machine_interactive = true;
-            }
+        // TODO: avoid busy wait
+        if (dap_state != DAP_RUNNING && dap_state != DAP_DONE) {
+            return;
         }
+    }
 
-        /* Interactive mode control */
-        if (machine_interactive) {
-            interactive_control();
+    /* Stepping check */
+    if (stepping > 0) {
+        stepping--;
+
+        if (stepping == 0) {
+            machine_interactive = true;
         }
+    }
 
-        /*
-         * Continue with the simulation
-         */
-        if (!machine_halt) {
-            machine_step();
+    /* Interactive mode control */
+    if (machine_interactive) {
+        interactive_control();
+    }
+
+    /*
+     * Return to the plain loop if none of the modes is active.
+     * The flag is cleared before the test so that a mode toggled
+     * on asynchronously (by a signal) is not missed.
+     */
+    machine_instrumented = false;
+    if (machine_instrumentation_needed()) {
+        machine_instrumented = true;
+    }
+
+    /*
+     * Continue with the simulation
+     */
+    if (!machine_halt) {
+        machine_step(machine_cycles_observed());
+    }
+}
+
+/** Main simulator loop
+ *
+ * The plain loop is specialised for the simulation without
+ * any tracing or debugging, the instrumented one is switched
+ * to only when some of these modes is toggled on.
+ *
+ */
+static void machine_run(void)
+{
+    while (!machine_halt) {
+        if (machine_instrumented) {
+            machine_run_instrumented();
+        } else {
+            machine_run_plain();
         }
     }
 }
@@ -471,8 +718,8 @@ int main(int argc, char *args[])
      * Finalization
      */
     input_back();
-    if (steps > 0) {
-        printf("\nCycles: %" PRIu64 "\n", steps);
+    if (machine_cycles > 0) {
+        printf("\nCycles: %" PRIu64 "\n", machine_cycles);
     }
 
     cleanup();
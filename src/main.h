@@ -76,9 +76,10 @@ extern dap_state_t dap_state;
 /** General simulator behaviour */
 extern bool machine_nondet;
 extern bool machine_trace;
-extern bool machine_halt;
+extern _Atomic bool machine_halt;
 extern bool machine_break;
 extern bool machine_interactive;
+extern _Atomic bool machine_instrumented;
 extern bool machine_newline;
 extern bool machine_undefined;
 extern bool machine_specific_instructions;
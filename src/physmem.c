@@ -9,6 +9,7 @@
  *
  */
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,7 +17,9 @@
 #include "assert.h"
 #include "debug/breakpoint.h"
 #include "device/cpu/general_cpu.h"
+#include "device/cpu/instr_cache.h"
 #include "device/device.h"
+#include "device/parallel.h"
 #include "endian.h"
 #include "list.h"
 #include "physmem.h"
@@ -26,22 +29,10 @@
  *
  */
 
-#define FTL2_WIDTH 12
-#define FTL1_WIDTH 12
+/** The main thread has the first bit */
+_Thread_local uint64_t frame_valid_bit = 1;
 
-#define FTL2_COUNT (1 << FTL2_WIDTH)
-#define FTL1_COUNT (1 << FTL1_WIDTH)
-
-#define FTL2_SHIFT (FRAME_WIDTH)
-#define FTL1_SHIFT (FRAME_WIDTH + FTL2_WIDTH)
-
-#define FTL2_MASK (FTL2_COUNT - 1)
-#define FTL1_MASK (FTL1_COUNT - 1)
-
-typedef frame_t *ftl1_t[FTL2_COUNT];
-typedef ftl1_t *ftl0_t[FTL1_COUNT];
-
-static ftl0_t ftl0 = {
+ftl0_t ftl0 = {
     NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
     NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
     NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
@@ -300,6 +291,11 @@ static ftl0_t ftl0 = {
     NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
 };
 
+_Static_assert(MAX_CPUS <= 32, "Reservation masks cannot hold all processors");
+
+/** Frames of the LL-SC reservations (NULL if the processor holds none) */
+static frame_t *sc_frames[MAX_CPUS];
+
 void physmem_wire(physmem_area_t *area)
 {
     ASSERT(area != NULL);
@@ -334,8 +330,19 @@ void physmem_wire(physmem_area_t *area)
         frame->area = area;
         frame->data = area->data + FRAMES2SIZE(pfn);
         // frame->trans = area->trans + SIZE2INSTRS(FRAMES2SIZE(pfn));
-        frame->valid = false;
+        frame->valid = 0;
+        frame->breakpoints = 0;
+
+        physmem_breakpoint_t *breakpoint;
+        for_each(physmem_breakpoints, breakpoint, physmem_breakpoint_t)
+        {
+            if (AREAS_OVERLAP(breakpoint->addr, breakpoint->size, addr, FRAME_SIZE)) {
+                frame->breakpoints++;
+            }
+        }
     }
+
+    instr_cache_invalidate();
 }
 
 void physmem_unwire(physmem_area_t *area)
@@ -357,6 +364,13 @@ void physmem_unwire(physmem_area_t *area)
         frame_t **frame_ref = &((*ftl1)[(addr >> FTL2_SHIFT) & FTL2_MASK]);
         ASSERT(*frame_ref != NULL);
 
+        /* Drop the reservations in the frame */
+        for (unsigned int procno = 0; procno < MAX_CPUS; procno++) {
+            if (sc_frames[procno] == *frame_ref) {
+                sc_frames[procno] = NULL;
+            }
+        }
+
         /* Remove frame */
         safe_free(*frame_ref);
 
@@ -372,48 +386,90 @@ void physmem_unwire(physmem_area_t *area)
 
         if (ftl1_empty) {
             safe_free(ftl1);
+            ftl0[(addr >> FTL1_SHIFT) & FTL1_MASK] = NULL;
         }
     }
+
+    instr_cache_invalidate();
 }
 
-frame_t *physmem_find_frame(ptr36_t addr)
+/** Invalidate the binary translations of all frames
+ *
+ * The cached pages are decoded again on their next execution.
+ *
+ */
+void physmem_invalidate_all(void)
 {
-    ftl1_t *ftl1 = ftl0[(addr >> FTL1_SHIFT) & FTL1_MASK];
-    if (ftl1 != NULL) {
-        frame_t *frame = (*ftl1)[(addr >> FTL2_SHIFT) & FTL2_MASK];
-        if (frame != NULL) {
-            return frame;
+    for (size_t i = 0; i < FTL1_COUNT; i++) {
+        ftl1_t *ftl1 = ftl0[i];
+        if (ftl1 == NULL) {
+            continue;
+        }
+
+        for (size_t j = 0; j < FTL2_COUNT; j++) {
+            if ((*ftl1)[j] != NULL) {
+                frame_invalidate((*ftl1)[j]);
+            }
         }
     }
 
-    return NULL;
+    instr_cache_invalidate();
+}
+
+/** Update the breakpoint counts of the frames overlapping a memory breakpoint
+ *
+ * Accesses to the frames without breakpoints skip the breakpoint search.
+ * Frames wired later count the breakpoints when they are wired.
+ *
+ * @param addr Address of the breakpoint.
+ * @param size Size of the breakpoint area.
+ * @param add  True if the breakpoint is added, false if removed.
+ *
+ */
+void physmem_mark_breakpoint(ptr36_t addr, len36_t size, bool add)
+{
+    ptr36_t frame_addr = ALIGN_DOWN(addr, FRAME_SIZE);
+
+    while (frame_addr < addr + size) {
+        frame_t *frame = physmem_find_frame(frame_addr);
+
+        if (frame != NULL) {
+            if (add) {
+                frame->breakpoints++;
+            } else {
+                ASSERT(frame->breakpoints > 0);
+                frame->breakpoints--;
+            }
+        }
+
+        frame_addr += FRAME_SIZE;
+    }
 }
 
 /** Find an activated memory breakpoint
  *
  * Find an activated memory breakpoint which would be hit for specified
- * memory address and access conditions.
- *
- * @param addr         Address, where the breakpoint can be hit.
- * @param size         Size of the access operation.
- * @param access_flags Specifies the access condition, under the breakpoint
- *                     will be hit.
+ * memory address and access conditions and fire it. The breakpoints are
+ * searched only if the frame contains any.
  *
- * @return Found breakpoint structure or NULL if there is not any.
+ * @param frame       Frame of the accessed memory.
+ * @param addr        Address, where the breakpoint can be hit.
+ * @param size        Size of the access operation.
+ * @param access_type Specifies the access operation.
  *
  */
-static void physmem_breakpoint_find(ptr36_t addr, len36_t size,
-        access_t access_type)
+static void physmem_breakpoint_find(frame_t *frame, ptr36_t addr,
+        len36_t size, access_t access_type)
 {
+    if (frame->breakpoints == 0) {
+        return;
+    }
+
     physmem_breakpoint_t *breakpoint;
 
     for_each(physmem_breakpoints, breakpoint, physmem_breakpoint_t)
     {
-        if (breakpoint->addr + breakpoint->size < addr) {
-            continue;
-        }
-
-        if (breakpoint->addr > addr + breakpoint->size) {
+        if (!AREAS_OVERLAP(breakpoint->addr, breakpoint->size, addr, size)) {
             continue;
         }
 
@@ -428,14 +484,23 @@ static uint8_t devmem_read8(unsigned int procno, ptr36_t addr)
 {
     uint32_t val = (uint32_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return val;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->read32) {
             dev->type->read32(procno, dev, addr, &val);
         }
     }
 
+    parallel_device_unlock();
+
     return val;
 }
 
@@ -443,14 +508,23 @@ static uint16_t devmem_read16(unsigned int procno, ptr36_t addr)
 {
     uint32_t val = (uint32_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return val;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->read32) {
             dev->type->read32(procno, dev, addr, &val);
         }
     }
 
+    parallel_device_unlock();
+
     return val;
 }
 
@@ -458,14 +532,23 @@ static uint32_t devmem_read32(unsigned int procno, ptr36_t addr)
 {
     uint32_t val = (uint32_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return val;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->read32) {
             dev->type->read32(procno, dev, addr, &val);
         }
     }
 
+    parallel_device_unlock();
+
     return val;
 }
 
@@ -473,14 +556,23 @@ static uint64_t devmem_read64(unsigned int procno, ptr36_t addr)
 {
     uint64_t val = (uint64_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return val;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->read64) {
             dev->type->read64(procno, dev, addr, &val);
         }
     }
 
+    parallel_device_unlock();
+
     return val;
 }
 
@@ -513,7 +605,7 @@ uint8_t physmem_read8(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 1, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 1, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -551,7 +643,7 @@ uint16_t physmem_read16(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 2, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 2, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -589,7 +681,7 @@ uint32_t physmem_read32(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 4, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 4, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -627,7 +719,7 @@ uint64_t physmem_read64(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 8, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 8, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -640,15 +732,24 @@ static bool devmem_write8(unsigned int procno, ptr36_t addr, uint8_t val)
 {
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return written;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->write32) {
             dev->type->write32(procno, dev, addr, val);
             written = true;
         }
     }
 
+    parallel_device_unlock();
+
     return written;
 }
 
@@ -656,15 +757,24 @@ static bool devmem_write16(unsigned int procno, ptr36_t addr, uint16_t val)
 {
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return written;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->write32) {
             dev->type->write32(procno, dev, addr, val);
             written = true;
         }
     }
 
+    parallel_device_unlock();
+
     return written;
 }
 
@@ -672,15 +782,24 @@ static bool devmem_write32(unsigned int procno, ptr36_t addr, uint32_t val)
 {
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return written;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->write32) {
             dev->type->write32(procno, dev, addr, val);
             written = true;
         }
     }
 
+    parallel_device_unlock();
+
     return written;
 }
 
@@ -688,86 +807,138 @@ static bool devmem_write64(unsigned int procno, ptr36_t addr, uint64_t val)
 {
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Only the devices decoding the address */
+    const dev_bus_segment_t *segment = dev_bus_find(addr);
+    if (segment == NULL) {
+        return written;
+    }
+
+    parallel_device_lock();
+
+    for (size_t i = 0; i < segment->count; i++) {
+        device_t *dev = segment->devices[i];
         if (dev->type->write64) {
             dev->type->write64(procno, dev, addr, val);
             written = true;
         }
     }
 
+    parallel_device_unlock();
+
     return written;
 }
 
 /** SC-LL tracking
+ *
+ * Each frame keeps a mask of the processors holding a reservation in it,
+ * so that writes to frames without reservations skip the tracking and
+ * writes to reserved frames check only the processors holding them.
  *
  */
 
-typedef struct {
-    item_t item;
-    unsigned int procno;
-} sc_item_t;
+/** Lock of the LL-SC tracking in the parallel mode */
+static pthread_mutex_t sc_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void sc_lock(void)
+{
+    if (parallel_running) {
+        pthread_mutex_lock(&sc_mutex);
+    }
+}
 
-static list_t sc_list = LIST_INITIALIZER;
+static void sc_unlock(void)
+{
+    if (parallel_running) {
+        pthread_mutex_unlock(&sc_mutex);
+    }
+}
 
-/** Register current processor in LL-SC tracking list
+/** Drop the reservation of a processor (with the tracking locked)
  *
  */
-void sc_register(unsigned int procno)
+static void sc_drop(unsigned int procno)
 {
-    /* Ignore if already registered. */
-    sc_item_t *sc_item;
+    frame_t *frame = sc_frames[procno];
 
-    for_each(sc_list, sc_item, sc_item_t)
-    {
-        if (sc_item->procno == procno) {
-            return;
-        }
+    if (frame != NULL) {
+        __atomic_and_fetch(&frame->reservations, ~(UINT32_C(1) << procno),
+                __ATOMIC_RELAXED);
+        sc_frames[procno] = NULL;
+    }
+}
+
+/** Register the reservation of a processor in LL-SC tracking
+ *
+ * Any previous reservation of the processor is replaced.
+ * Reservations outside of memory frames are not tracked,
+ * since only the memory writes are reported.
+ *
+ * @param procno Id of the processor.
+ * @param addr   Physical address of the reservation.
+ *
+ */
+void sc_register(unsigned int procno, ptr36_t addr)
+{
+    ASSERT(procno < MAX_CPUS);
+
+    frame_t *frame = physmem_find_frame(addr);
+
+    sc_lock();
+    sc_drop(procno);
+
+    if (frame != NULL) {
+        __atomic_or_fetch(&frame->reservations, UINT32_C(1) << procno,
+                __ATOMIC_RELAXED);
+        sc_frames[procno] = frame;
     }
 
-    sc_item = safe_malloc_t(sc_item_t);
-    item_init(&sc_item->item);
-    sc_item->procno = procno;
-    list_append(&sc_list, &sc_item->item);
+    sc_unlock();
 }
 
-/** Remove current processor from the LL-SC tracking list
+/** Remove the reservation of a processor from the LL-SC tracking
  *
  */
 void sc_unregister(unsigned int procno)
 {
-    sc_item_t *sc_item;
+    ASSERT(procno < MAX_CPUS);
 
-    for_each(sc_list, sc_item, sc_item_t)
-    {
-        if (sc_item->procno == procno) {
-            list_remove(&sc_list, &sc_item->item);
-            safe_free(sc_item);
-            break;
-        }
+    /* Only the processor itself registers its reservation */
+    if (__atomic_load_n(&sc_frames[procno], __ATOMIC_RELAXED) == NULL) {
+        return;
     }
+
+    sc_lock();
+    sc_drop(procno);
+    sc_unlock();
 }
 
 /** Load Linked and Store Conditional control
+ *
+ * Break the reservations of the processors hit by a write
+ * to the frame.
  *
  */
-static void sc_control(ptr36_t addr, int size)
+static void sc_control(frame_t *frame, ptr36_t addr, int size)
 {
-    sc_item_t *sc_item = (sc_item_t *) sc_list.head;
+    if (!frame_reserved(frame)) {
+        return;
+    }
 
-    while (sc_item != NULL) {
+    sc_lock();
 
-        if (cpu_sc_access(get_cpu(sc_item->procno), addr, size)) {
-            sc_item_t *tmp = sc_item;
-            sc_item = (sc_item_t *) sc_item->item.next;
+    uint32_t reservations = frame->reservations;
 
-            list_remove(&sc_list, &tmp->item);
-            safe_free(tmp);
-        } else {
-            sc_item = (sc_item_t *) sc_item->item.next;
+    for (unsigned int procno = 0; reservations != 0; procno++, reservations >>= 1) {
+        if ((reservations & 1) == 0) {
+            continue;
+        }
+
+        if (cpu_sc_access(get_cpu(procno), addr, size)) {
+            sc_drop(procno);
         }
     }
+
+    sc_unlock();
 }
 
 /** Physical memory write (8 bits)
@@ -804,19 +975,19 @@ bool physmem_write8(unsigned int procno, ptr36_t addr, uint8_t val, bool protect
         return false;
     }
 
-    sc_control(addr, 1);
+    sc_control(frame, addr, 1);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 1, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 1, ACCESS_WRITE);
     }
 
-    /* Invalidate binary translation */
-    frame->valid = false;
-
     uint8_t *data = frame->data + (addr & FRAME_MASK);
     *data = convert_uint8_t_endian(val);
 
+    /* Invalidate binary translation */
+    frame_invalidate(frame);
+
     return true;
 }
 
@@ -854,19 +1025,19 @@ bool physmem_write16(unsigned int procno, ptr36_t addr, uint16_t val, bool prote
         return false;
     }
 
-    sc_control(addr, 2);
+    sc_control(frame, addr, 2);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 2, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 2, ACCESS_WRITE);
     }
 
-    /* Invalidate binary translation */
-    frame->valid = false;
-
     uint16_t *data = (uint16_t *) (frame->data + (addr & FRAME_MASK));
     *data = convert_uint16_t_endian(val);
 
+    /* Invalidate binary translation */
+    frame_invalidate(frame);
+
     return true;
 }
 
@@ -904,19 +1075,19 @@ bool physmem_write32(unsigned int procno, ptr36_t addr, uint32_t val, bool prote
         return false;
     }
 
-    sc_control(addr, 4);
+    sc_control(frame, addr, 4);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 4, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 4, ACCESS_WRITE);
     }
 
-    /* Invalidate binary translation */
-    frame->valid = false;
-
     uint32_t *data = (uint32_t *) (frame->data + (addr & FRAME_MASK));
     *data = convert_uint32_t_endian(val);
 
+    /* Invalidate binary translation */
+    frame_invalidate(frame);
+
     return true;
 }
 
@@ -954,18 +1125,201 @@ bool physmem_write64(unsigned int procno, ptr36_t addr, uint64_t val, bool prote
         return false;
     }
 
-    sc_control(addr, 8);
+    sc_control(frame, addr, 8);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 8, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 8, ACCESS_WRITE);
+    }
+
+    uint64_t *data = (uint64_t *) (frame->data + (addr & FRAME_MASK));
+    *data = convert_uint64_t_endian(val);
+
+    /* Invalidate binary translation */
+    frame_invalidate(frame);
+
+    return true;
+}
+
+/** Physical memory compare and swap (32 bits)
+ *
+ * Atomically write 32 bits of data to memory if it holds the expected
+ * value, which implements the atomic operations of the processors running
+ * in parallel. Devices and ROM are written as by physmem_write32()
+ * (the value is not compared).
+ *
+ * @param procno   Id of processor which wants to write.
+ * @param addr     Address of the memory.
+ * @param expected Expected value of the memory.
+ * @param val      Data to be written.
+ *
+ * @return False if the memory did not hold the expected value.
+ *
+ */
+bool physmem_cas32(unsigned int procno, ptr36_t addr, uint32_t expected, uint32_t val)
+{
+    frame_t *frame = physmem_find_frame(addr);
+
+    if ((frame == NULL) || (!frame->area->writable)) {
+        physmem_write32(procno, addr, val, true);
+        return true;
+    }
+
+    uint32_t *data = (uint32_t *) (frame->data + (addr & FRAME_MASK));
+    uint32_t old = convert_uint32_t_endian(expected);
+
+    if (!__atomic_compare_exchange_n(data, &old, convert_uint32_t_endian(val),
+                false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        return false;
     }
 
+    sc_control(frame, addr, 4);
+    physmem_breakpoint_find(frame, addr, 4, ACCESS_WRITE);
+
     /* Invalidate binary translation */
-    frame->valid = false;
+    frame_invalidate(frame);
+
+    return true;
+}
+
+/** Physical memory compare and swap (64 bits)
+ *
+ * Atomically write 64 bits of data to memory if it holds the expected
+ * value, which implements the atomic operations of the processors running
+ * in parallel. Devices and ROM are written as by physmem_write64()
+ * (the value is not compared).
+ *
+ * @param procno   Id of processor which wants to write.
+ * @param addr     Address of the memory.
+ * @param expected Expected value of the memory.
+ * @param val      Data to be written.
+ *
+ * @return False if the memory did not hold the expected value.
+ *
+ */
+bool physmem_cas64(unsigned int procno, ptr36_t addr, uint64_t expected, uint64_t val)
+{
+    frame_t *frame = physmem_find_frame(addr);
+
+    if ((frame == NULL) || (!frame->area->writable)) {
+        physmem_write64(procno, addr, val, true);
+        return true;
+    }
 
     uint64_t *data = (uint64_t *) (frame->data + (addr & FRAME_MASK));
-    *data = convert_uint64_t_endian(val);
+    uint64_t old = convert_uint64_t_endian(expected);
+
+    if (!__atomic_compare_exchange_n(data, &old, convert_uint64_t_endian(val),
+                false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+
+    sc_control(frame, addr, 8);
+    physmem_breakpoint_find(frame, addr, 8, ACCESS_WRITE);
+
+    /* Invalidate binary translation */
+    frame_invalidate(frame);
 
     return true;
 }
+
+/** Size of the blocks checked for LL-SC reservations by DMA */
+#define DMA_SC_BLOCK 64
+
+/** Notify the LL-SC tracking about a DMA write
+ *
+ * Reservations are checked by aligned blocks, since some processors
+ * track whole cache lines only.
+ *
+ */
+static void sc_control_block(frame_t *frame, ptr36_t addr, len36_t size)
+{
+    while ((size > 0) && (frame_reserved(frame))) {
+        len36_t block = MIN(size, DMA_SC_BLOCK - (addr & (DMA_SC_BLOCK - 1)));
+        sc_control(frame, addr, (int) block);
+
+        addr += block;
+        size -= block;
+    }
+}
+
+/** Copy a block of data to the physical memory (DMA)
+ *
+ * Memory frames are looked up once per frame and copied as a whole.
+ * Parts of the block which are not memory are written to the devices
+ * by words. ROM is not written, like with protected writes. Frames
+ * with memory breakpoints are written by words.
+ *
+ * @param addr Physical address of the block (aligned to 4 bytes).
+ * @param src  Data to write in the byte order of the memory.
+ * @param size Size of the block (multiple of 4 bytes).
+ *
+ */
+void physmem_dma_write(ptr36_t addr, const void *src, len36_t size)
+{
+    ASSERT(IS_ALIGNED(addr, 4));
+    ASSERT(IS_ALIGNED(size, 4));
+
+    const uint8_t *data = (const uint8_t *) src;
+    while (size > 0) {
+        len36_t chunk = MIN(size, FRAME_SIZE - (addr & FRAME_MASK));
+        frame_t *frame = physmem_find_frame(addr);
+
+        if ((frame == NULL) || (frame->breakpoints > 0)) {
+            for (len36_t offset = 0; offset < chunk; offset += 4) {
+                uint32_t val;
+                memcpy(&val, data + offset, sizeof(val));
+                physmem_write32(-1 /*NULL*/, addr + offset,
+                        convert_uint32_t_endian(val), true);
+            }
+        } else if (frame->area->writable) {
+            sc_control_block(frame, addr, chunk);
+
+            memcpy(frame->data + (addr & FRAME_MASK), data, chunk);
+
+            /* Invalidate binary translation */
+            frame_invalidate(frame);
+        }
+
+        addr += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+/** Copy a block of data from the physical memory (DMA)
+ *
+ * Memory frames are looked up once per frame and copied as a whole.
+ * Parts of the block which are not memory are read from the devices
+ * by words. Frames with memory breakpoints are read by words.
+ *
+ * @param addr Physical address of the block (aligned to 4 bytes).
+ * @param dst  Buffer for the data in the byte order of the memory.
+ * @param size Size of the block (multiple of 4 bytes).
+ *
+ */
+void physmem_dma_read(ptr36_t addr, void *dst, len36_t size)
+{
+    ASSERT(IS_ALIGNED(addr, 4));
+    ASSERT(IS_ALIGNED(size, 4));
+
+    uint8_t *data = (uint8_t *) dst;
+    while (size > 0) {
+        len36_t chunk = MIN(size, FRAME_SIZE - (addr & FRAME_MASK));
+        frame_t *frame = physmem_find_frame(addr);
+
+        if ((frame == NULL) || (frame->breakpoints > 0)) {
+            for (len36_t offset = 0; offset < chunk; offset += 4) {
+                uint32_t val = convert_uint32_t_endian(
+                        physmem_read32(-1 /*NULL*/, addr + offset, true));
+                memcpy(data + offset, &val, sizeof(val));
+            }
+        } else {
+            memcpy(data, frame->data + (addr & FRAME_MASK), chunk);
+        }
+
+        addr += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
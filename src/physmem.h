@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include "endian.h"
 #include "list.h"
 #include "main.h"
 #include "utils.h"
@@ -41,6 +42,18 @@
 
 #define DEFAULT_MEMORY_VALUE UINT64_C(0xffffffffffffffff)
 
+#define FTL2_WIDTH 12
+#define FTL1_WIDTH 12
+
+#define FTL2_COUNT (1 << FTL2_WIDTH)
+#define FTL1_COUNT (1 << FTL1_WIDTH)
+
+#define FTL2_SHIFT (FRAME_WIDTH)
+#define FTL1_SHIFT (FRAME_WIDTH + FTL2_WIDTH)
+
+#define FTL2_MASK (FTL2_COUNT - 1)
+#define FTL1_MASK (FTL1_COUNT - 1)
+
 typedef enum {
     MEMT_NONE = 0, /**< Uninitialized */
     MEMT_MEM = 1, /**< Generic */
@@ -69,15 +82,81 @@ typedef struct frame {
     /* Frame data (with displacement) */
     uint8_t *data;
 
-    /* Binary translation valid flag */
-    bool valid;
+    /* Binary translation valid flags (a bit per simulator thread) */
+    uint64_t valid;
+
+    /* Processors with an LL-SC reservation in the frame (a bit per processor) */
+    uint32_t reservations;
+
+    /* Number of memory breakpoints within the frame */
+    uint32_t breakpoints;
 } frame_t;
 
+typedef frame_t *ftl1_t[FTL2_COUNT];
+typedef ftl1_t *ftl0_t[FTL1_COUNT];
+
+/** Frame table (two levels indexed by the physical frame number) */
+extern ftl0_t ftl0;
+
+/** Bit of the current thread in the binary translation valid flags */
+extern _Thread_local uint64_t frame_valid_bit;
+
+/** Check whether the binary translation of the current thread is valid */
+static inline bool frame_valid(frame_t *frame)
+{
+    return (__atomic_load_n(&frame->valid, __ATOMIC_RELAXED) & frame_valid_bit) != 0;
+}
+
+/** Mark the binary translation of the current thread valid
+ *
+ * Has to be called before the frame is translated, so that
+ * a concurrent write is either seen by the translation or
+ * invalidates it afterwards.
+ *
+ */
+static inline void frame_validate(frame_t *frame)
+{
+    __atomic_fetch_or(&frame->valid, frame_valid_bit, __ATOMIC_SEQ_CST);
+}
+
+/** Invalidate the binary translations of all threads
+ *
+ * Has to be called after the frame is written.
+ *
+ */
+static inline void frame_invalidate(frame_t *frame)
+{
+    __atomic_store_n(&frame->valid, 0, __ATOMIC_RELEASE);
+}
+
+/** Check whether any processor holds an LL-SC reservation in the frame
+ *
+ * Writes to frames without reservations do not have to be
+ * reported to the LL-SC tracking.
+ *
+ */
+static inline bool frame_reserved(frame_t *frame)
+{
+    return __atomic_load_n(&frame->reservations, __ATOMIC_RELAXED) != 0;
+}
+
 /** Physical memory management */
 extern void physmem_wire(physmem_area_t *area);
 extern void physmem_unwire(physmem_area_t *area);
+extern void physmem_invalidate_all(void);
+
+/** Find the memory frame containing the address (NULL if none) */
+static inline frame_t *physmem_find_frame(ptr36_t addr)
+{
+    ftl1_t *ftl1 = ftl0[(addr >> FTL1_SHIFT) & FTL1_MASK];
+    if (ftl1 == NULL) {
+        return NULL;
+    }
 
-extern frame_t *physmem_find_frame(ptr36_t addr);
+    return (*ftl1)[(addr >> FTL2_SHIFT) & FTL2_MASK];
+}
+
+extern void physmem_mark_breakpoint(ptr36_t addr, len36_t size, bool add);
 
 /** Physical memory access */
 extern uint8_t physmem_read8(unsigned int cpu, ptr36_t addr, bool protected);
@@ -94,8 +173,65 @@ extern bool physmem_write32(unsigned int cpu, ptr36_t addr, uint32_t val,
 extern bool physmem_write64(unsigned int cpu, ptr36_t addr, uint64_t val,
         bool protected);
 
+extern bool physmem_cas32(unsigned int cpu, ptr36_t addr, uint32_t expected,
+        uint32_t val);
+extern bool physmem_cas64(unsigned int cpu, ptr36_t addr, uint64_t expected,
+        uint64_t val);
+
+/** Inline physical memory access of the processors
+ *
+ * Protected accesses to plain memory are done inline. The other
+ * accesses are passed to the complete accessors above: accesses
+ * outside of memory frames, to frames with memory breakpoints,
+ * writes to ROM and writes to frames with LL-SC reservations.
+ * The endianness conversion is void on little-endian hosts.
+ *
+ * The binary translation of the written frame is invalidated
+ * unconditionally, since checking the valid flags first would
+ * race with the translation by other threads in parallel mode.
+ *
+ */
+#define PHYSMEM_FAST_ACCESSORS(bits) \
+    static inline uint##bits##_t physmem_fast_read##bits(unsigned int procno, \
+            ptr36_t addr) \
+    { \
+        frame_t *frame = physmem_find_frame(addr); \
+        if ((frame == NULL) || (frame->breakpoints > 0)) { \
+            return physmem_read##bits(procno, addr, true); \
+        } \
+\
+        uint##bits##_t *data = (uint##bits##_t *) (frame->data + (addr & FRAME_MASK)); \
+        return convert_uint##bits##_t_endian(*data); \
+    } \
+\
+    static inline bool physmem_fast_write##bits(unsigned int procno, \
+            ptr36_t addr, uint##bits##_t val) \
+    { \
+        frame_t *frame = physmem_find_frame(addr); \
+        if ((frame == NULL) || (!frame->area->writable) \
+                || (frame->breakpoints > 0) || (frame_reserved(frame))) { \
+            return physmem_write##bits(procno, addr, val, true); \
+        } \
+\
+        uint##bits##_t *data = (uint##bits##_t *) (frame->data + (addr & FRAME_MASK)); \
+        *data = convert_uint##bits##_t_endian(val); \
+        frame_invalidate(frame); \
+        return true; \
+    }
+
+PHYSMEM_FAST_ACCESSORS(8)
+PHYSMEM_FAST_ACCESSORS(16)
+PHYSMEM_FAST_ACCESSORS(32)
+PHYSMEM_FAST_ACCESSORS(64)
+
+#undef PHYSMEM_FAST_ACCESSORS
+
+/** Direct memory access */
+extern void physmem_dma_write(ptr36_t addr, const void *src, len36_t size);
+extern void physmem_dma_read(ptr36_t addr, void *dst, len36_t size);
+
 /** Store-conditional control */
-extern void sc_register(unsigned int procno);
+extern void sc_register(unsigned int procno, ptr36_t addr);
 extern void sc_unregister(unsigned int procno);
 
 #endif /* PHYSMEM_H_ */
@@ -0,0 +1,768 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Sampling profiler of the simulated code
+ *
+ *  Every profile_period machine cycles the program counter of each
+ *  processor (and optionally its return address register) is added
+ *  to a histogram. The sampling is a simulated time event, so the
+ *  processors are not slowed down between the samples.
+ *
+ *  The sampled addresses are mapped to functions by the symbol table
+ *  of an ELF file. The reports are a flat profile of the functions and
+ *  the folded stacks (caller;function count) for the flame graph tools.
+ *
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "device/cpu/mips_r4000/cpu.h"
+#include "device/cpu/riscv_rv32ima/cpu.h"
+#include "device/device.h"
+#include "device/dr4kcpu.h"
+#include "device/drvcpu.h"
+#include "device/event.h"
+#include "fault.h"
+#include "main.h"
+#include "profile.h"
+#include "utils.h"
+
+/** Return address of the samples without one */
+#define PROFILE_NO_RA UINT64_MAX
+
+/** Initial number of the histogram slots (has to be a power of two) */
+#define PROFILE_INITIAL_SLOTS 1024
+
+/** Return address register of the MIPS R4000 (ra) */
+#define R4K_RA_REG 31
+
+/** Return address register of the RISC-V (ra) */
+#define RV_RA_REG 1
+
+/* ELF constants */
+#define ELF_CLASS_32 1
+#define ELF_CLASS_64 2
+#define ELF_DATA_LSB 1
+#define ELF_DATA_MSB 2
+#define ELF_SHT_SYMTAB 2
+#define ELF_SHT_DYNSYM 11
+#define ELF_STT_NOTYPE 0
+#define ELF_STT_FUNC 2
+#define ELF_SHN_UNDEF 0
+#define ELF_SHN_LORESERVE 0xff00
+
+/** Histogram slot of a sampled address */
+typedef struct {
+    uint64_t pc;
+    uint64_t ra;
+    uint64_t count; /**< Zero for an empty slot */
+} profile_slot_t;
+
+/** Function symbol */
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    bool func;
+    char *name;
+} profile_symbol_t;
+
+/** Function containing a sampled address
+ *
+ * The address of the symbol or the sampled
+ * address itself if there is no symbol.
+ *
+ */
+typedef struct {
+    const profile_symbol_t *symbol;
+    uint64_t addr;
+} profile_func_t;
+
+/** Samples aggregated for a report */
+typedef struct {
+    profile_func_t func;
+    profile_func_t caller;
+    bool has_caller;
+    uint64_t count;
+} profile_entry_t;
+
+/** ELF file being read */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    bool is64;
+    bool msb;
+} elf_file_t;
+
+bool profile_enabled = false;
+unsigned int profile_period = PROFILE_DEFAULT_PERIOD;
+bool profile_ra = false;
+
+/** Sampling event */
+static event_t sample_event;
+
+/** Histogram of the sampled addresses (open addressing) */
+static profile_slot_t *slots = NULL;
+static size_t slot_count = 0;
+static size_t slot_used = 0;
+
+/** Sample counts */
+static uint64_t sample_total = 0;
+static uint64_t sample_standby = 0;
+
+/** Function symbols sorted by address */
+static profile_symbol_t *symbols = NULL;
+static size_t symbol_count = 0;
+static bool symbols_32 = false;
+
+/************************************************************************/
+/* Sampling                                                             */
+/************************************************************************/
+
+static size_t slot_index(uint64_t pc, uint64_t ra)
+{
+    uint64_t hash = (pc ^ (ra * UINT64_C(0x9e3779b97f4a7c15)))
+            * UINT64_C(0x9e3779b97f4a7c15);
+    return (size_t) (hash >> 32) & (slot_count - 1);
+}
+
+/** Find the slot of a sampled address or an empty one
+ *
+ */
+static profile_slot_t *slot_find(uint64_t pc, uint64_t ra)
+{
+    size_t index = slot_index(pc, ra);
+
+    while (slots[index].count > 0) {
+        if ((slots[index].pc == pc) && (slots[index].ra == ra)) {
+            break;
+        }
+
+        index = (index + 1) & (slot_count - 1);
+    }
+
+    return &slots[index];
+}
+
+/** Double the number of the histogram slots
+ *
+ */
+static void slots_grow(void)
+{
+    profile_slot_t *old_slots = slots;
+    size_t old_count = slot_count;
+
+    slot_count = (old_count == 0) ? PROFILE_INITIAL_SLOTS : 2 * old_count;
+    slots = safe_malloc(slot_count * sizeof(profile_slot_t));
+    memset(slots, 0, slot_count * sizeof(profile_slot_t));
+
+    for (size_t i = 0; i < old_count; i++) {
+        if (old_slots[i].count > 0) {
+            *slot_find(old_slots[i].pc, old_slots[i].ra) = old_slots[i];
+        }
+    }
+
+    safe_free(old_slots);
+}
+
+/** Add a sample of a running processor
+ *
+ */
+static void sample_record(uint64_t pc, uint64_t ra)
+{
+    /* Keep the histogram at most half full */
+    if (2 * (slot_used + 1) > slot_count) {
+        slots_grow();
+    }
+
+    profile_slot_t *slot = slot_find(pc, ra);
+    if (slot->count == 0) {
+        slot->pc = pc;
+        slot->ra = ra;
+        slot_used++;
+    }
+
+    slot->count++;
+    sample_total++;
+}
+
+/** Sample all the processors
+ *
+ */
+static void profile_sample(event_t *event)
+{
+    const device_array_t *r4k_devices = dev_array(DEVICE_FILTER_R4K_PROCESSOR);
+    for (size_t i = 0; i < r4k_devices->count; i++) {
+        const r4k_cpu_t *cpu = get_r4k(r4k_devices->devices[i]);
+
+        if (cpu->stdby) {
+            sample_standby++;
+            sample_total++;
+        } else {
+            sample_record(cpu->pc.ptr,
+                    profile_ra ? cpu->regs[R4K_RA_REG].val : PROFILE_NO_RA);
+        }
+    }
+
+    const device_array_t *rv_devices = dev_array(DEVICE_FILTER_RV_PROCESSOR);
+    for (size_t i = 0; i < rv_devices->count; i++) {
+        const rv32_cpu_t *cpu = get_rv(rv_devices->devices[i]);
+
+        if (cpu->stdby) {
+            sample_standby++;
+            sample_total++;
+        } else {
+            sample_record(cpu->pc,
+                    profile_ra ? cpu->regs[RV_RA_REG] : PROFILE_NO_RA);
+        }
+    }
+
+    event_schedule(event, event->cycle + profile_period);
+}
+
+/** Change the profile variable
+ *
+ * @return true if successful
+ *
+ */
+bool profile_set_enabled(bool enabled)
+{
+    if ((enabled) && (!profile_enabled)) {
+        event_init(&sample_event, profile_sample, NULL);
+        event_schedule(&sample_event, machine_cycles + profile_period);
+    } else if ((!enabled) && (profile_enabled)) {
+        event_cancel(&sample_event);
+    }
+
+    profile_enabled = enabled;
+    return true;
+}
+
+/** Change the profperiod variable
+ *
+ * @return true if successful
+ *
+ */
+bool profile_set_period(unsigned int period)
+{
+    if (period == 0) {
+        error("Sampling period has to be at least one cycle");
+        return false;
+    }
+
+    profile_period = period;
+
+    if (profile_enabled) {
+        event_schedule(&sample_event, machine_cycles + profile_period);
+    }
+
+    return true;
+}
+
+/** Discard all the samples
+ *
+ */
+void profile_reset(void)
+{
+    safe_free(slots);
+    slot_count = 0;
+    slot_used = 0;
+    sample_total = 0;
+    sample_standby = 0;
+}
+
+/************************************************************************/
+/* Symbols                                                              */
+/************************************************************************/
+
+/** Check that a part of the ELF file is present
+ *
+ */
+static bool elf_range(const elf_file_t *elf, uint64_t offset, uint64_t size)
+{
+    return (offset <= elf->size) && (size <= elf->size - offset);
+}
+
+/** Read a value of the given size in the byte order of the ELF file
+ *
+ */
+static uint64_t elf_get(const elf_file_t *elf, uint64_t offset, unsigned int size)
+{
+    uint64_t val = 0;
+
+    for (unsigned int i = 0; i < size; i++) {
+        unsigned int shift = elf->msb ? (size - 1 - i) * 8 : i * 8;
+        val |= ((uint64_t) elf->data[offset + i]) << shift;
+    }
+
+    return val;
+}
+
+/** Order the symbols by address, functions and larger ones first
+ *
+ */
+static int symbol_compare(const void *a, const void *b)
+{
+    const profile_symbol_t *sa = (const profile_symbol_t *) a;
+    const profile_symbol_t *sb = (const profile_symbol_t *) b;
+
+    if (sa->addr != sb->addr) {
+        return (sa->addr < sb->addr) ? -1 : 1;
+    }
+
+    if (sa->func != sb->func) {
+        return sa->func ? -1 : 1;
+    }
+
+    if (sa->size != sb->size) {
+        return (sa->size > sb->size) ? -1 : 1;
+    }
+
+    return strcmp(sa->name, sb->name);
+}
+
+/** Free all the symbols
+ *
+ */
+static void symbols_free(void)
+{
+    for (size_t i = 0; i < symbol_count; i++) {
+        safe_free(symbols[i].name);
+    }
+
+    safe_free(symbols);
+    symbol_count = 0;
+}
+
+/** Read the function symbols of a symbol table section
+ *
+ * @return False if the section is corrupted.
+ *
+ */
+static bool elf_read_symtab(const elf_file_t *elf, uint64_t shoff,
+        uint64_t shentsize, uint64_t shnum, uint64_t sh)
+{
+    uint64_t sh_offset = elf_get(elf, sh + (elf->is64 ? 0x18 : 0x10), elf->is64 ? 8 : 4);
+    uint64_t sh_size = elf_get(elf, sh + (elf->is64 ? 0x20 : 0x14), elf->is64 ? 8 : 4);
+    uint64_t sh_link = elf_get(elf, sh + (elf->is64 ? 0x28 : 0x18), 4);
+    uint64_t entsize = elf->is64 ? 24 : 16;
+
+    if ((sh_link >= shnum) || (!elf_range(elf, sh_offset, sh_size))) {
+        return false;
+    }
+
+    /* Associated string table */
+    uint64_t str = shoff + sh_link * shentsize;
+    uint64_t str_offset = elf_get(elf, str + (elf->is64 ? 0x18 : 0x10), elf->is64 ? 8 : 4);
+    uint64_t str_size = elf_get(elf, str + (elf->is64 ? 0x20 : 0x14), elf->is64 ? 8 : 4);
+
+    if (!elf_range(elf, str_offset, str_size)) {
+        return false;
+    }
+
+    const char *strtab = (const char *) elf->data + str_offset;
+    size_t count = sh_size / entsize;
+
+    symbols = safe_malloc(MAX(count, 1) * sizeof(profile_symbol_t));
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t sym = sh_offset + i * entsize;
+
+        uint64_t name = elf_get(elf, sym, 4);
+        unsigned int info = elf_get(elf, sym + (elf->is64 ? 4 : 12), 1);
+        uint64_t shndx = elf_get(elf, sym + (elf->is64 ? 6 : 14), 2);
+        uint64_t value = elf_get(elf, sym + (elf->is64 ? 8 : 4), elf->is64 ? 8 : 4);
+        uint64_t size = elf_get(elf, sym + (elf->is64 ? 16 : 8), elf->is64 ? 8 : 4);
+
+        unsigned int type = info & 0x0f;
+        if (((type != ELF_STT_FUNC) && (type != ELF_STT_NOTYPE))
+                || (shndx == ELF_SHN_UNDEF) || (shndx >= ELF_SHN_LORESERVE)) {
+            continue;
+        }
+
+        if ((name >= str_size)
+                || (memchr(strtab + name, 0, str_size - name) == NULL)) {
+            return false;
+        }
+
+        /* Skip the unnamed, mapping and local assembler symbols */
+        const char *sym_name = strtab + name;
+        if ((sym_name[0] == 0) || (sym_name[0] == '$') || (prefix(".L", sym_name))) {
+            continue;
+        }
+
+        symbols[symbol_count].addr = value;
+        symbols[symbol_count].size = size;
+        symbols[symbol_count].func = (type == ELF_STT_FUNC);
+        symbols[symbol_count].name = safe_strdup(sym_name);
+        symbol_count++;
+    }
+
+    return true;
+}
+
+/** Read the function symbols of an ELF file
+ *
+ * @return False if the file is not an ELF file or it is corrupted.
+ *
+ */
+static bool elf_read_symbols(const elf_file_t *elf)
+{
+    uint64_t shoff = elf_get(elf, elf->is64 ? 0x28 : 0x20, elf->is64 ? 8 : 4);
+    uint64_t shentsize = elf_get(elf, elf->is64 ? 0x3a : 0x2e, 2);
+    uint64_t shnum = elf_get(elf, elf->is64 ? 0x3c : 0x30, 2);
+
+    if ((shentsize < (elf->is64 ? 0x40U : 0x28U))
+            || (!elf_range(elf, shoff, shentsize * shnum))) {
+        return false;
+    }
+
+    /* Prefer the complete symbol table to the dynamic one */
+    uint64_t symtab = 0;
+    bool found = false;
+
+    for (uint64_t i = 0; i < shnum; i++) {
+        uint64_t sh = shoff + i * shentsize;
+        uint64_t type = elf_get(elf, sh + 4, 4);
+
+        if (type == ELF_SHT_SYMTAB) {
+            symtab = sh;
+            found = true;
+            break;
+        }
+
+        if ((type == ELF_SHT_DYNSYM) && (!found)) {
+            symtab = sh;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return true;
+    }
+
+    return elf_read_symtab(elf, shoff, shentsize, shnum, symtab);
+}
+
+/** Load the function symbols from an ELF file
+ *
+ * The symbols replace the previously loaded ones.
+ *
+ * @return False if the file cannot be read or parsed.
+ *
+ */
+bool profile_load_symbols(const char *filename)
+{
+    ASSERT(filename != NULL);
+
+    FILE *file = try_fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    size_t size;
+    if ((!try_fseek(file, 0, SEEK_END, filename))
+            || (!try_ftell(file, filename, &size))
+            || (!try_fseek(file, 0, SEEK_SET, filename))) {
+        safe_fclose(file, filename);
+        return false;
+    }
+
+    uint8_t *data = safe_malloc(MAX(size, 1));
+    if (fread(data, 1, size, file) != size) {
+        io_error(filename);
+        safe_fclose(file, filename);
+        safe_free(data);
+        return false;
+    }
+
+    safe_fclose(file, filename);
+
+    elf_file_t elf = {
+        .data = data,
+        .size = size,
+    };
+
+    bool ok = (size >= 0x40) && (memcmp(data, "\177ELF", 4) == 0)
+            && ((data[4] == ELF_CLASS_32) || (data[4] == ELF_CLASS_64))
+            && ((data[5] == ELF_DATA_LSB) || (data[5] == ELF_DATA_MSB));
+
+    symbols_free();
+
+    if (ok) {
+        elf.is64 = (data[4] == ELF_CLASS_64);
+        elf.msb = (data[5] == ELF_DATA_MSB);
+        ok = elf_read_symbols(&elf);
+    }
+
+    safe_free(data);
+
+    if (!ok) {
+        symbols_free();
+        error("Not an ELF file or corrupted symbol table (%s)", filename);
+        return false;
+    }
+
+    qsort(symbols, symbol_count, sizeof(profile_symbol_t), symbol_compare);
+
+    /* Keep a single symbol for each address */
+    size_t unique = 0;
+    for (size_t i = 0; i < symbol_count; i++) {
+        if ((unique > 0) && (symbols[unique - 1].addr == symbols[i].addr)) {
+            safe_free(symbols[i].name);
+        } else {
+            symbols[unique] = symbols[i];
+            unique++;
+        }
+    }
+
+    symbol_count = unique;
+    symbols_32 = !elf.is64;
+
+    alert("Loaded %zu symbols from %s", symbol_count, filename);
+    return true;
+}
+
+/** Find the function containing an address
+ *
+ * A symbol without a size extends up to the following one.
+ *
+ */
+static profile_func_t func_find(uint64_t addr)
+{
+    profile_func_t func = {
+        .symbol = NULL,
+        .addr = addr
+    };
+
+    /* The 32-bit addresses are sign-extended by the processors */
+    if (symbols_32) {
+        addr &= UINT32_MAX;
+    }
+
+    /* The last symbol not above the address */
+    size_t lo = 0;
+    size_t hi = symbol_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (symbols[mid].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        return func;
+    }
+
+    const profile_symbol_t *symbol = &symbols[lo - 1];
+    if ((symbol->size != 0) && (addr - symbol->addr >= symbol->size)) {
+        return func;
+    }
+
+    func.symbol = symbol;
+    func.addr = symbol->addr;
+    return func;
+}
+
+/************************************************************************/
+/* Reports                                                              */
+/************************************************************************/
+
+static int func_compare(const profile_func_t *a, const profile_func_t *b)
+{
+    if ((a->symbol == NULL) != (b->symbol == NULL)) {
+        return (a->symbol != NULL) ? -1 : 1;
+    }
+
+    if (a->addr != b->addr) {
+        return (a->addr < b->addr) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/** Order the entries by their functions
+ *
+ */
+static int entry_compare_func(const void *a, const void *b)
+{
+    const profile_entry_t *ea = (const profile_entry_t *) a;
+    const profile_entry_t *eb = (const profile_entry_t *) b;
+
+    int cmp = func_compare(&ea->func, &eb->func);
+    if (cmp != 0) {
+        return cmp;
+    }
+
+    if (ea->has_caller != eb->has_caller) {
+        return ea->has_caller ? 1 : -1;
+    }
+
+    return ea->has_caller ? func_compare(&ea->caller, &eb->caller) : 0;
+}
+
+/** Order the entries by decreasing count
+ *
+ */
+static int entry_compare_count(const void *a, const void *b)
+{
+    const profile_entry_t *ea = (const profile_entry_t *) a;
+    const profile_entry_t *eb = (const profile_entry_t *) b;
+
+    if (ea->count != eb->count) {
+        return (ea->count > eb->count) ? -1 : 1;
+    }
+
+    return entry_compare_func(a, b);
+}
+
+/** Aggregate the samples by the functions
+ *
+ * @param callers Distinguish the callers of the functions.
+ * @param count   Number of the returned entries.
+ *
+ * @return Entries sorted by decreasing count.
+ *
+ */
+static profile_entry_t *entries_collect(bool callers, size_t *count)
+{
+    profile_entry_t *entries = safe_malloc(MAX(slot_used, 1) * sizeof(profile_entry_t));
+    size_t entry_count = 0;
+
+    for (size_t i = 0; i < slot_count; i++) {
+        const profile_slot_t *slot = &slots[i];
+        if (slot->count == 0) {
+            continue;
+        }
+
+        profile_entry_t *entry = &entries[entry_count];
+        entry->func = func_find(slot->pc);
+        entry->has_caller = (callers) && (slot->ra != PROFILE_NO_RA);
+        if (entry->has_caller) {
+            entry->caller = func_find(slot->ra);
+        }
+
+        entry->count = slot->count;
+        entry_count++;
+    }
+
+    qsort(entries, entry_count, sizeof(profile_entry_t), entry_compare_func);
+
+    size_t merged = 0;
+    for (size_t i = 0; i < entry_count; i++) {
+        if ((merged > 0)
+                && (entry_compare_func(&entries[merged - 1], &entries[i]) == 0)) {
+            entries[merged - 1].count += entries[i].count;
+        } else {
+            entries[merged] = entries[i];
+            merged++;
+        }
+    }
+
+    qsort(entries, merged, sizeof(profile_entry_t), entry_compare_count);
+
+    *count = merged;
+    return entries;
+}
+
+static void func_print(FILE *file, const profile_func_t *func)
+{
+    if (func->symbol != NULL) {
+        fprintf(file, "%s", func->symbol->name);
+    } else {
+        fprintf(file, "0x%" PRIx64, func->addr);
+    }
+}
+
+/** Print the flat profile
+ *
+ * @param count Number of the functions to print, zero for all.
+ *
+ */
+void profile_print_flat(unsigned int count)
+{
+    printf("Profile of %" PRIu64 " samples, one every %u cycles\n",
+            sample_total, profile_period);
+
+    if (sample_total == 0) {
+        return;
+    }
+
+    size_t entry_count;
+    profile_entry_t *entries = entries_collect(false, &entry_count);
+
+    if ((count > 0) && (count < entry_count)) {
+        entry_count = count;
+    }
+
+    printf("  Samples  Percent  Function\n");
+
+    if (sample_standby > 0) {
+        printf("%9" PRIu64 "  %6.2f%%  [standby]\n", sample_standby,
+                100.0 * sample_standby / sample_total);
+    }
+
+    for (size_t i = 0; i < entry_count; i++) {
+        printf("%9" PRIu64 "  %6.2f%%  ", entries[i].count,
+                100.0 * entries[i].count / sample_total);
+        func_print(stdout, &entries[i].func);
+        printf("\n");
+    }
+
+    safe_free(entries);
+}
+
+/** Write the folded stacks for the flame graph tools
+ *
+ * Each line contains the caller (if the return addresses
+ * are sampled), the function and the number of samples.
+ *
+ * @param filename Output file, NULL for the standard output.
+ *
+ * @return False if the file cannot be written.
+ *
+ */
+bool profile_write_folded(const char *filename)
+{
+    FILE *file = stdout;
+
+    if (filename != NULL) {
+        file = try_fopen(filename, "w");
+        if (file == NULL) {
+            return false;
+        }
+    }
+
+    size_t entry_count;
+    profile_entry_t *entries = entries_collect(true, &entry_count);
+
+    if (sample_standby > 0) {
+        fprintf(file, "[standby] %" PRIu64 "\n", sample_standby);
+    }
+
+    for (size_t i = 0; i < entry_count; i++) {
+        if (entries[i].has_caller) {
+            func_print(file, &entries[i].caller);
+            fprintf(file, ";");
+        }
+
+        func_print(file, &entries[i].func);
+        fprintf(file, " %" PRIu64 "\n", entries[i].count);
+    }
+
+    safe_free(entries);
+
+    if (filename != NULL) {
+        safe_fclose(file, filename);
+    }
+
+    return true;
+}
@@ -0,0 +1,37 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Sampling profiler of the simulated code
+ *
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdbool.h>
+
+/** Default sampling period in machine cycles */
+#define PROFILE_DEFAULT_PERIOD 1000
+
+/** Default number of functions in the flat profile */
+#define PROFILE_DEFAULT_FLAT_COUNT 20
+
+/** The program counters are sampled */
+extern bool profile_enabled;
+
+/** Sampling period in machine cycles */
+extern unsigned int profile_period;
+
+/** The return address register is sampled as well */
+extern bool profile_ra;
+
+extern bool profile_set_enabled(bool enabled);
+extern bool profile_set_period(unsigned int period);
+extern void profile_reset(void);
+
+extern bool profile_load_symbols(const char *filename);
+extern void profile_print_flat(unsigned int count);
+extern bool profile_write_folded(const char *filename);
+
+#endif
@@ -81,9 +81,13 @@ const char txt_help[] = "  -V, --version               display version info\n"
                         "  -c, --config=file_name      configuration file name\n"
                         "  -i, --interactive           enter interactive mode\n"
                         "  -t, --trace                 enter trace mode\n"
+                        "  -T, --trace-file=file       write a binary trace of the instructions\n"
+                        "      --trace-thread          write the binary trace from a thread\n"
+                        "  -D, --trace-decode=file     print a binary trace file and quit\n"
                         "  -g, --remote-gdb=port       enter gdb mode\n"
                         "  -d, --dap[port]            enter DAP mode (default: 10505)\n"
                         "  -n, --non-deterministic     enable non-deterministic behaviour\n"
-                        "  -X, --no-extra-instructions disable MSIM-specific instructions\n";
+                        "  -X, --no-extra-instructions disable MSIM-specific instructions\n"
+                        "  -p, --parallel[=quantum]    run processors in parallel (default: 1024)\n";
 
 const char hexchar[] = "0123456789abcdef";
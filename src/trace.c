@@ -0,0 +1,488 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Binary trace of the executed instructions
+ *
+ *  Each executed instruction is recorded with its address, opcode,
+ *  the registers it changed and the stores it did. The records are
+ *  put into a ring buffer, which is written to the trace file either
+ *  when it gets full or by a background thread. All the values are
+ *  stored in little-endian byte order:
+ *
+ *    u8 arch, u8 procno, u8 register count, u8 store count,
+ *    u32 opcode, u64 address,
+ *    register count times: u8 register, u64 value,
+ *    store count times: u64 address, u8 size, u64 value
+ *
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "device/cpu/mips_r4000/debug.h"
+#include "device/cpu/riscv_rv32ima/debug.h"
+#include "fault.h"
+#include "main.h"
+#include "trace.h"
+#include "utils.h"
+
+/** Size of the fixed part of a record */
+#define TRACE_RECORD_HEADER 16
+
+/** Size of a register change in a record */
+#define TRACE_RECORD_REG 9
+
+/** Size of a store in a record */
+#define TRACE_RECORD_STORE 17
+
+/** Maximal size of a record */
+#define TRACE_RECORD_MAX \
+    (TRACE_RECORD_HEADER + TRACE_MAX_REGS * TRACE_RECORD_REG \
+            + TRACE_MAX_STORES * TRACE_RECORD_STORE)
+
+/** Store done by the instruction being executed */
+typedef struct {
+    uint64_t addr;
+    uint64_t value;
+    unsigned int size;
+} trace_store_t;
+
+bool trace_enabled = false;
+
+static FILE *trace_file = NULL;
+static char *trace_filename = NULL;
+
+/** Ring buffer, the positions only increase */
+static uint8_t *buffer = NULL;
+static size_t buffer_head = 0; /**< Written by the simulation */
+static size_t buffer_tail = 0; /**< Written by the flushing */
+
+/** Background flushing */
+static bool thread_running = false;
+static bool thread_closing = false;
+static pthread_t flusher;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t data_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t space_ready = PTHREAD_COND_INITIALIZER;
+
+/** Registers of the processors as of their last record */
+static uint64_t last_regs[MAX_CPUS][TRACE_MAX_REGS];
+
+/** Stores of the instruction being executed */
+static trace_store_t stores[TRACE_MAX_STORES];
+static unsigned int store_count = 0;
+
+static void put8(uint8_t **pos, uint8_t value)
+{
+    **pos = value;
+    (*pos)++;
+}
+
+static void put32(uint8_t **pos, uint32_t value)
+{
+    for (unsigned int i = 0; i < 4; i++) {
+        put8(pos, (uint8_t) (value >> (i * 8)));
+    }
+}
+
+static void put64(uint8_t **pos, uint64_t value)
+{
+    for (unsigned int i = 0; i < 8; i++) {
+        put8(pos, (uint8_t) (value >> (i * 8)));
+    }
+}
+
+static uint32_t get32(const uint8_t *pos)
+{
+    uint32_t value = 0;
+    for (unsigned int i = 0; i < 4; i++) {
+        value |= ((uint32_t) pos[i]) << (i * 8);
+    }
+
+    return value;
+}
+
+static uint64_t get64(const uint8_t *pos)
+{
+    uint64_t value = 0;
+    for (unsigned int i = 0; i < 8; i++) {
+        value |= ((uint64_t) pos[i]) << (i * 8);
+    }
+
+    return value;
+}
+
+/** Write a part of the buffer to the trace file
+ *
+ * @param from First position to write.
+ * @param to   Position after the last one to write.
+ *
+ */
+static void buffer_write(size_t from, size_t to)
+{
+    while (from < to) {
+        size_t offset = from & (TRACE_BUFFER_SIZE - 1);
+        size_t len = MIN(to - from, (size_t) TRACE_BUFFER_SIZE - offset);
+
+        if (fwrite(buffer + offset, 1, len, trace_file) != len) {
+            io_die(ERR_IO, trace_filename);
+        }
+
+        from += len;
+    }
+}
+
+/** Number of bytes in the buffer */
+static size_t buffer_used(void)
+{
+    return __atomic_load_n(&buffer_head, __ATOMIC_ACQUIRE)
+            - __atomic_load_n(&buffer_tail, __ATOMIC_ACQUIRE);
+}
+
+/** Background flushing of the buffer
+ *
+ * The buffer is written when it gets at least half full.
+ *
+ */
+static void *flush_thread(void *arg)
+{
+    while (true) {
+        pthread_mutex_lock(&mutex);
+
+        while ((buffer_used() < TRACE_BUFFER_SIZE / 2) && (!thread_closing)) {
+            pthread_cond_wait(&data_ready, &mutex);
+        }
+
+        bool closing = thread_closing;
+        pthread_mutex_unlock(&mutex);
+
+        size_t head = __atomic_load_n(&buffer_head, __ATOMIC_ACQUIRE);
+        buffer_write(buffer_tail, head);
+
+        pthread_mutex_lock(&mutex);
+        __atomic_store_n(&buffer_tail, head, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&space_ready);
+        pthread_mutex_unlock(&mutex);
+
+        if (closing) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/** Make space for a record in the buffer
+ *
+ */
+static void buffer_reserve(size_t size)
+{
+    if (buffer_used() + size <= TRACE_BUFFER_SIZE) {
+        return;
+    }
+
+    if (!thread_running) {
+        buffer_write(buffer_tail, buffer_head);
+        buffer_tail = buffer_head;
+        return;
+    }
+
+    pthread_mutex_lock(&mutex);
+    pthread_cond_signal(&data_ready);
+
+    while (buffer_used() + size > TRACE_BUFFER_SIZE) {
+        pthread_cond_wait(&space_ready, &mutex);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/** Put a record to the buffer
+ *
+ */
+static void buffer_put(const uint8_t *data, size_t size)
+{
+    buffer_reserve(size);
+
+    size_t head = buffer_head;
+    size_t offset = head & (TRACE_BUFFER_SIZE - 1);
+    size_t len = MIN(size, (size_t) TRACE_BUFFER_SIZE - offset);
+
+    memcpy(buffer + offset, data, len);
+    memcpy(buffer, data + len, size - len);
+
+    size_t used = buffer_used();
+    __atomic_store_n(&buffer_head, head + size, __ATOMIC_RELEASE);
+
+    /* Wake up the flushing when the buffer gets half full */
+    if ((thread_running) && (used < TRACE_BUFFER_SIZE / 2)
+            && (used + size >= TRACE_BUFFER_SIZE / 2)) {
+        pthread_mutex_lock(&mutex);
+        pthread_cond_signal(&data_ready);
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+/** Start writing the binary trace
+ *
+ * @param filename Name of the trace file.
+ * @param thread   Write the trace file from a background thread.
+ *
+ * @return True if the trace file was created.
+ *
+ */
+bool trace_open(const char *filename, bool thread)
+{
+    ASSERT(filename != NULL);
+    ASSERT(trace_file == NULL);
+
+    trace_file = try_fopen(filename, "wb");
+    if (trace_file == NULL) {
+        return false;
+    }
+
+    trace_filename = safe_strdup(filename);
+    buffer = safe_malloc(TRACE_BUFFER_SIZE);
+    buffer_head = 0;
+    buffer_tail = 0;
+    memset(last_regs, 0, sizeof(last_regs));
+    store_count = 0;
+
+    if (fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, trace_file) != TRACE_MAGIC_SIZE) {
+        io_die(ERR_IO, filename);
+    }
+
+    if (thread) {
+        thread_closing = false;
+        if (pthread_create(&flusher, NULL, flush_thread, NULL) != 0) {
+            die(ERR_INTERN, "Cannot create the trace thread");
+        }
+
+        thread_running = true;
+    }
+
+    trace_enabled = true;
+    atexit(trace_close);
+    return true;
+}
+
+/** Write the rest of the trace and close the trace file
+ *
+ */
+void trace_close(void)
+{
+    if (trace_file == NULL) {
+        return;
+    }
+
+    trace_enabled = false;
+
+    if (thread_running) {
+        pthread_mutex_lock(&mutex);
+        thread_closing = true;
+        pthread_cond_signal(&data_ready);
+        pthread_mutex_unlock(&mutex);
+
+        pthread_join(flusher, NULL);
+        thread_running = false;
+    }
+
+    buffer_write(buffer_tail, buffer_head);
+    buffer_tail = buffer_head;
+
+    safe_fclose(trace_file, trace_filename);
+    trace_file = NULL;
+
+    safe_free(trace_filename);
+    safe_free(buffer);
+}
+
+/** Record a store of the instruction being executed
+ *
+ * @param procno Processor doing the store.
+ * @param addr   Virtual address of the store.
+ * @param size   Size of the store in bytes.
+ * @param value  Stored value.
+ *
+ */
+void trace_store(unsigned int procno, uint64_t addr, unsigned int size,
+        uint64_t value)
+{
+    if (store_count == TRACE_MAX_STORES) {
+        return;
+    }
+
+    stores[store_count].addr = addr;
+    stores[store_count].value = value;
+    stores[store_count].size = size;
+    store_count++;
+}
+
+/** Record an executed instruction
+ *
+ * Only the registers changed since the previous record of the processor
+ * are recorded together with the stores done by the instruction.
+ *
+ * @param arch   Architecture of the processor.
+ * @param procno Processor number.
+ * @param pc     Virtual address of the instruction.
+ * @param raw    Instruction opcode.
+ * @param regs   Register values after the instruction.
+ * @param count  Number of the registers.
+ *
+ */
+void trace_instr(trace_arch_t arch, unsigned int procno, uint64_t pc,
+        uint32_t raw, const uint64_t *regs, unsigned int count)
+{
+    ASSERT(procno < MAX_CPUS);
+    ASSERT(count <= TRACE_MAX_REGS);
+
+    uint8_t record[TRACE_RECORD_MAX];
+    uint8_t *pos = record + TRACE_RECORD_HEADER;
+    uint64_t *last = last_regs[procno];
+    unsigned int changed = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (regs[i] != last[i]) {
+            last[i] = regs[i];
+            put8(&pos, i);
+            put64(&pos, regs[i]);
+            changed++;
+        }
+    }
+
+    for (unsigned int i = 0; i < store_count; i++) {
+        put64(&pos, stores[i].addr);
+        put8(&pos, stores[i].size);
+        put64(&pos, stores[i].value);
+    }
+
+    size_t size = pos - record;
+
+    pos = record;
+    put8(&pos, arch);
+    put8(&pos, procno);
+    put8(&pos, changed);
+    put8(&pos, store_count);
+    put32(&pos, raw);
+    put64(&pos, pc);
+
+    store_count = 0;
+    buffer_put(record, size);
+}
+
+/** Print the name of a traced register
+ *
+ */
+static const char *reg_name(trace_arch_t arch, unsigned int reg)
+{
+    if (arch == TRACE_ARCH_R4K) {
+        switch (reg) {
+        case 32:
+            return "lo";
+        case 33:
+            return "hi";
+        default:
+            return r4k_regname[reg];
+        }
+    }
+
+    return rv_regnames[reg];
+}
+
+/** Print a binary trace file as text
+ *
+ * The instructions are disassembled as with the trace mode,
+ * each is followed by the registers it changed and its stores.
+ *
+ * @return True if the whole trace file was read.
+ *
+ */
+bool trace_decode(const char *filename)
+{
+    ASSERT(filename != NULL);
+
+    FILE *file = try_fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    char magic[TRACE_MAGIC_SIZE];
+    if ((fread(magic, 1, TRACE_MAGIC_SIZE, file) != TRACE_MAGIC_SIZE)
+            || (memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0)) {
+        error("Not a binary trace file (%s)", filename);
+        safe_fclose(file, filename);
+        return false;
+    }
+
+    uint8_t record[TRACE_RECORD_MAX];
+    bool ok = true;
+
+    while (true) {
+        size_t rd = fread(record, 1, TRACE_RECORD_HEADER, file);
+        if (rd == 0) {
+            break;
+        }
+
+        trace_arch_t arch = record[0];
+        unsigned int procno = record[1];
+        unsigned int changed = record[2];
+        unsigned int store_cnt = record[3];
+        uint32_t raw = get32(record + 4);
+        uint64_t pc = get64(record + 8);
+
+        size_t size = changed * TRACE_RECORD_REG + store_cnt * TRACE_RECORD_STORE;
+
+        if ((rd != TRACE_RECORD_HEADER)
+                || ((arch != TRACE_ARCH_R4K) && (arch != TRACE_ARCH_RV32))
+                || (changed > TRACE_MAX_REGS) || (store_cnt > TRACE_MAX_STORES)
+                || (fread(record, 1, size, file) != size)) {
+            error("Truncated or corrupted binary trace file (%s)", filename);
+            ok = false;
+            break;
+        }
+
+        if (arch == TRACE_ARCH_R4K) {
+            ptr64_t addr;
+            addr.ptr = pc;
+
+            r4k_instr_t instr;
+            instr.val = raw;
+
+            r4k_idump_procno(procno, addr, instr);
+        } else {
+            rv_instr_t instr;
+            instr.val = raw;
+
+            rv32_idump_procno(procno, (uint32_t) pc, instr);
+        }
+
+        const uint8_t *pos = record;
+        for (unsigned int i = 0; i < changed; i++) {
+            unsigned int reg = pos[0];
+            uint64_t value = get64(pos + 1);
+
+            if (reg < ((arch == TRACE_ARCH_R4K) ? TRACE_MAX_REGS : RV_REG_COUNT)) {
+                printf("      %s: %#" PRIx64 "\n", reg_name(arch, reg), value);
+            }
+
+            pos += TRACE_RECORD_REG;
+        }
+
+        for (unsigned int i = 0; i < store_cnt; i++) {
+            printf("      [%#" PRIx64 "]: %#" PRIx64 " (%u bytes)\n",
+                    get64(pos), get64(pos + 9), pos[8]);
+            pos += TRACE_RECORD_STORE;
+        }
+    }
+
+    safe_fclose(file, filename);
+    return ok;
+}
@@ -0,0 +1,47 @@
+/*
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Binary trace of the executed instructions
+ *
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Trace file identification */
+#define TRACE_MAGIC "MSIMTRC1"
+#define TRACE_MAGIC_SIZE 8
+
+/** Size of the trace buffer (has to be a power of two) */
+#define TRACE_BUFFER_SIZE (4 * 1024 * 1024)
+
+/** Maximal number of registers of a traced processor */
+#define TRACE_MAX_REGS 34
+
+/** Maximal number of stores recorded for a single instruction */
+#define TRACE_MAX_STORES 4
+
+/** Architectures of the traced processors */
+typedef enum {
+    TRACE_ARCH_R4K = 1,
+    TRACE_ARCH_RV32 = 2
+} trace_arch_t;
+
+/** The binary trace is written */
+extern bool trace_enabled;
+
+extern bool trace_open(const char *filename, bool thread);
+extern void trace_close(void);
+
+extern void trace_store(unsigned int procno, uint64_t addr, unsigned int size,
+        uint64_t value);
+extern void trace_instr(trace_arch_t arch, unsigned int procno, uint64_t pc,
+        uint32_t raw, const uint64_t *regs, unsigned int count);
+
+extern bool trace_decode(const char *filename);
+
+#endif
@@ -21,6 +21,9 @@
 
 #include "main.h"
 
+/** Inline even when the compiler would not */
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
 #define STRINGIFY(a) STRINGIFY_(a)
 #define STRINGIFY_(a) #a
 
@@ -0,0 +1,5 @@
+#!/bin/bash
+riscv32-unknown-elf-gcc -march=rv32ima -msmall-data-limit=0 -mstrict-align -fno-pic -fno-builtin -ffreestanding -nostdlib -nostdinc -c -o main.raw main.S
+riscv32-unknown-elf-objdump -d -C -S main.raw > main.dis
+riscv32-unknown-elf-objcopy -O binary main.raw main.bin
+python3 -c 'import sys; sys.stdout.buffer.write(b"".join(bytes([0x10 + i]) * 512 for i in range(16)))' > disk.img
@@ -17,6 +17,10 @@ TESTS = [
     "amo",
     "lr-sc",
     "scyclecmp",
+    "blocks",
+    "ddisk",
+    "ddisk-multi",
+    "ddisk-cow",
     "exceptions/simple",
     "exceptions/delegated",
     "exceptions/not_delegated",
@@ -28,7 +32,11 @@ TESTS = [
     "external-SEIP",
     "m-mode-STIP",
     "mprv-fetch",
-    "tlb"
+    "tlb",
+    "data-tlb",
+    "hpm-counters",
+    "mtime",
+    "idle"
 ]
 
 MSIM_PATH = "../../msim"
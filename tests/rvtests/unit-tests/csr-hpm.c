@@ -0,0 +1,69 @@
+#include <stdint.h>
+#include <pcut/pcut.h>
+
+#include "common.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(csr_hpm);
+
+rv_cpu_t cpu_hpm;
+
+static rv_instr_t csr_instr(csr_num_t csr, unsigned int rs1, unsigned int rd)
+{
+    rv_instr_t instr = { .val = ((uint32_t) csr << 20) | (rs1 << 15) | (rd << 7) | rv_opcSYSTEM };
+    return instr;
+}
+
+PCUT_TEST_BEFORE
+{
+    rv_cpu_init(&cpu_hpm, 0);
+}
+
+PCUT_TEST(mhpmevent_set_all_ones_ignored)
+{
+    cpu_hpm.regs[5] = (uxlen_t) -1;
+
+    rv_exc_t ex = rv_csrrs_instr(&cpu_hpm, csr_instr(csr_mhpmevent3, 5, 0));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+
+    ex = rv_csrrs_instr(&cpu_hpm, csr_instr(csr_mhpmevent3, 0, 6));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+    PCUT_ASSERT_INT_EQUALS(0, cpu_hpm.regs[6]);
+
+    cpu_hpm.regs[6] = 1;
+    ex = rv_csrrs_instr(&cpu_hpm, csr_instr(csr_mhpmcounter3, 0, 6));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+    PCUT_ASSERT_INT_EQUALS(0, cpu_hpm.regs[6]);
+}
+
+PCUT_TEST(mhpmevent_write_all_ones_ignored)
+{
+    cpu_hpm.regs[5] = (uxlen_t) -1;
+
+    rv_exc_t ex = rv_csrrw_instr(&cpu_hpm, csr_instr(csr_mhpmevent4, 5, 0));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+
+    cpu_hpm.regs[6] = 1;
+    ex = rv_csrrs_instr(&cpu_hpm, csr_instr(csr_mhpmcounter4, 0, 6));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+    PCUT_ASSERT_INT_EQUALS(0, cpu_hpm.regs[6]);
+}
+
+PCUT_TEST(mhpmevent_clear_keeps_valid_event)
+{
+    cpu_hpm.regs[5] = 1;
+
+    rv_exc_t ex = rv_csrrw_instr(&cpu_hpm, csr_instr(csr_mhpmevent5, 5, 0));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+
+    ex = rv_csrrc_instr(&cpu_hpm, csr_instr(csr_mhpmevent5, 5, 6));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+    PCUT_ASSERT_INT_EQUALS(1, cpu_hpm.regs[6]);
+
+    ex = rv_csrrs_instr(&cpu_hpm, csr_instr(csr_mhpmevent5, 0, 6));
+    PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
+    PCUT_ASSERT_INT_EQUALS(0, cpu_hpm.regs[6]);
+}
+
+PCUT_EXPORT(csr_hpm);
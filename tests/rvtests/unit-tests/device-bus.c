@@ -0,0 +1,165 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <pcut/pcut.h>
+
+#include "../../../src/device/device.h"
+#include "../../../src/physmem.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(device_bus);
+
+static unsigned int reads;
+static unsigned int writes;
+
+static void counting_read32(unsigned int procno, device_t *dev, ptr36_t addr,
+        uint32_t *val)
+{
+    reads++;
+    *val = (uint32_t) addr;
+}
+
+static void counting_write32(unsigned int procno, device_t *dev, ptr36_t addr,
+        uint32_t val)
+{
+    writes++;
+}
+
+static const device_type_t counting_type = {
+    .name = "counting",
+    .read32 = counting_read32,
+    .write32 = counting_write32
+};
+
+static const device_type_t read_only_type = {
+    .name = "read-only",
+    .read32 = counting_read32
+};
+
+static void dummy_step(device_t *dev)
+{
+}
+
+static const device_type_t stepped_type = {
+    .name = "stepped",
+    .step = dummy_step
+};
+
+static device_t devices[3];
+
+static device_t *add(const device_type_t *type, ptr36_t addr, len36_t size)
+{
+    for (size_t i = 0; i < sizeof(devices) / sizeof(devices[0]); i++) {
+        if (devices[i].type == NULL) {
+            devices[i].type = type;
+            item_init(&devices[i].item);
+            dev_map_range(&devices[i], addr, size);
+            add_device(&devices[i]);
+            return &devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+PCUT_TEST_BEFORE
+{
+    reads = 0;
+    writes = 0;
+}
+
+PCUT_TEST_AFTER
+{
+    for (size_t i = 0; i < sizeof(devices) / sizeof(devices[0]); i++) {
+        if (devices[i].type != NULL) {
+            dev_remove(&devices[i]);
+            devices[i].type = NULL;
+        }
+    }
+}
+
+PCUT_TEST(no_devices)
+{
+    PCUT_ASSERT_NULL(dev_bus_find(0x1000));
+    PCUT_ASSERT_FALSE(physmem_write32(0, 0x1000, 1, true));
+}
+
+PCUT_TEST(access_reaches_decoding_device)
+{
+    add(&counting_type, 0x1000, 8);
+
+    PCUT_ASSERT_INT_EQUALS(0x1004, physmem_read32(0, 0x1004, true));
+    PCUT_ASSERT_TRUE(physmem_write32(0, 0x1000, 1, true));
+    PCUT_ASSERT_INT_EQUALS(1, reads);
+    PCUT_ASSERT_INT_EQUALS(1, writes);
+}
+
+PCUT_TEST(access_outside_devices)
+{
+    add(&counting_type, 0x1000, 8);
+    add(&counting_type, 0x3000, 4);
+
+    PCUT_ASSERT_NULL(dev_bus_find(0xffc));
+    PCUT_ASSERT_NULL(dev_bus_find(0x1008));
+    PCUT_ASSERT_NULL(dev_bus_find(0x3004));
+
+    PCUT_ASSERT_INT_EQUALS((uint32_t) DEFAULT_MEMORY_VALUE, physmem_read32(0, 0x2000, true));
+    PCUT_ASSERT_FALSE(physmem_write32(0, 0x2000, 1, true));
+    PCUT_ASSERT_INT_EQUALS(0, reads);
+    PCUT_ASSERT_INT_EQUALS(0, writes);
+}
+
+PCUT_TEST(read_only_device_is_not_written)
+{
+    add(&read_only_type, 0x1000, 8);
+
+    PCUT_ASSERT_FALSE(physmem_write32(0, 0x1000, 1, true));
+}
+
+PCUT_TEST(overlapping_devices)
+{
+    device_t *outer = add(&counting_type, 0x1000, 0x100);
+    device_t *inner = add(&read_only_type, 0x1010, 8);
+
+    const dev_bus_segment_t *segment = dev_bus_find(0x1014);
+    PCUT_ASSERT_NOT_NULL(segment);
+    PCUT_ASSERT_INT_EQUALS(2, segment->count);
+    PCUT_ASSERT_EQUALS(outer, segment->devices[0]);
+    PCUT_ASSERT_EQUALS(inner, segment->devices[1]);
+
+    segment = dev_bus_find(0x1018);
+    PCUT_ASSERT_NOT_NULL(segment);
+    PCUT_ASSERT_INT_EQUALS(1, segment->count);
+    PCUT_ASSERT_EQUALS(outer, segment->devices[0]);
+
+    physmem_read32(0, 0x1010, true);
+    PCUT_ASSERT_INT_EQUALS(2, reads);
+}
+
+PCUT_TEST(removed_device_is_not_decoded)
+{
+    device_t *dev = add(&counting_type, 0x1000, 8);
+    dev_remove(dev);
+    dev->type = NULL;
+
+    PCUT_ASSERT_NULL(dev_bus_find(0x1000));
+}
+
+PCUT_TEST(step_array_follows_devices)
+{
+    add(&counting_type, 0x1000, 8);
+    device_t *stepped = add(&stepped_type, 0, 0);
+
+    const device_array_t *array = dev_array(DEVICE_FILTER_STEP);
+    PCUT_ASSERT_INT_EQUALS(1, array->count);
+    PCUT_ASSERT_EQUALS(stepped, array->devices[0]);
+    PCUT_ASSERT_INT_EQUALS(2, dev_array(DEVICE_FILTER_ALL)->count);
+    PCUT_ASSERT_NULL(dev_bus_find(0));
+
+    dev_remove(stepped);
+    stepped->type = NULL;
+
+    PCUT_ASSERT_INT_EQUALS(0, dev_array(DEVICE_FILTER_STEP)->count);
+}
+
+PCUT_EXPORT(device_bus);
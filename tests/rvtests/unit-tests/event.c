@@ -0,0 +1,96 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <pcut/pcut.h>
+
+#include "../../../src/device/event.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(event);
+
+#define EVENT_COUNT 8
+
+static event_t events[EVENT_COUNT];
+static unsigned int fired[EVENT_COUNT];
+static unsigned int fired_count;
+
+static void record(event_t *event)
+{
+    fired[fired_count++] = (unsigned int) (event - events);
+}
+
+PCUT_TEST_BEFORE
+{
+    machine_cycles = 0;
+    fired_count = 0;
+
+    for (unsigned int i = 0; i < EVENT_COUNT; i++) {
+        event_init(&events[i], record, NULL);
+    }
+}
+
+PCUT_TEST_AFTER
+{
+    for (unsigned int i = 0; i < EVENT_COUNT; i++) {
+        event_cancel(&events[i]);
+    }
+}
+
+PCUT_TEST(fired_in_cycle_order)
+{
+    event_schedule(&events[0], 30);
+    event_schedule(&events[1], 10);
+    event_schedule(&events[2], 20);
+
+    PCUT_ASSERT_INT_EQUALS(10, event_next_cycle);
+
+    machine_cycles = 9;
+    event_run();
+    PCUT_ASSERT_INT_EQUALS(0, fired_count);
+
+    machine_cycles = 25;
+    event_run();
+    PCUT_ASSERT_INT_EQUALS(2, fired_count);
+    PCUT_ASSERT_INT_EQUALS(1, fired[0]);
+    PCUT_ASSERT_INT_EQUALS(2, fired[1]);
+    PCUT_ASSERT_FALSE(event_scheduled(&events[1]));
+    PCUT_ASSERT_TRUE(event_scheduled(&events[0]));
+    PCUT_ASSERT_INT_EQUALS(30, event_next_cycle);
+}
+
+PCUT_TEST(same_cycle_in_schedule_order)
+{
+    for (unsigned int i = 0; i < EVENT_COUNT; i++) {
+        event_schedule(&events[EVENT_COUNT - 1 - i], 5);
+    }
+
+    machine_cycles = 5;
+    event_run();
+
+    PCUT_ASSERT_INT_EQUALS(EVENT_COUNT, fired_count);
+    for (unsigned int i = 0; i < EVENT_COUNT; i++) {
+        PCUT_ASSERT_INT_EQUALS(EVENT_COUNT - 1 - i, fired[i]);
+    }
+    PCUT_ASSERT_INT_EQUALS(UINT64_MAX, event_next_cycle);
+}
+
+PCUT_TEST(cancel_and_reschedule)
+{
+    event_schedule(&events[0], 10);
+    event_schedule(&events[1], 20);
+    event_schedule(&events[2], 30);
+
+    event_cancel(&events[0]);
+    event_schedule(&events[2], 5);
+
+    PCUT_ASSERT_INT_EQUALS(5, event_next_cycle);
+
+    machine_cycles = 100;
+    event_run();
+
+    PCUT_ASSERT_INT_EQUALS(2, fired_count);
+    PCUT_ASSERT_INT_EQUALS(2, fired[0]);
+    PCUT_ASSERT_INT_EQUALS(1, fired[1]);
+}
+
+PCUT_EXPORT(event);
@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <pcut/pcut.h>
+
+#include "../../../src/device/cpu/instr_cache.h"
+#include "../../../src/physmem.h"
+#include "../../../src/utils.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(instr_cache);
+
+instr_cache_t cache = INSTR_CACHE_INITIALIZER;
+
+static instr_cache_item_t *add_page(ptr36_t addr)
+{
+    instr_cache_item_t *item = safe_malloc_t(instr_cache_item_t);
+    instr_cache_insert(&cache, item, addr);
+    return item;
+}
+
+PCUT_TEST_BEFORE
+{
+    instr_cache_set_capacity(DEFAULT_INSTR_CACHE_CAPACITY);
+}
+
+PCUT_TEST_AFTER
+{
+    instr_cache_flush(&cache);
+}
+
+PCUT_TEST(find_inserted_page)
+{
+    instr_cache_item_t *item = add_page(0x1234);
+
+    PCUT_ASSERT_EQUALS(item, instr_cache_find(&cache, 0x1000));
+    PCUT_ASSERT_EQUALS(item, instr_cache_find(&cache, 0x1ffc));
+    PCUT_ASSERT_INT_EQUALS(0x1000, item->addr);
+    PCUT_ASSERT_NULL(instr_cache_find(&cache, 0x2000));
+}
+
+PCUT_TEST(many_pages)
+{
+    for (ptr36_t i = 0; i < 1000; i++) {
+        add_page(FRAME2ADDR(i * 7));
+    }
+
+    for (ptr36_t i = 0; i < 1000; i++) {
+        instr_cache_item_t *item = instr_cache_find(&cache, FRAME2ADDR(i * 7));
+        PCUT_ASSERT_NOT_NULL(item);
+        PCUT_ASSERT_INT_EQUALS(FRAME2ADDR(i * 7), item->addr);
+    }
+
+    PCUT_ASSERT_INT_EQUALS(1000, cache.count);
+}
+
+PCUT_TEST(evict_when_full)
+{
+    instr_cache_set_capacity(2);
+
+    add_page(0x1000);
+    add_page(0x2000);
+    add_page(0x3000);
+
+    PCUT_ASSERT_INT_EQUALS(2, cache.count);
+    PCUT_ASSERT_NULL(instr_cache_find(&cache, 0x1000));
+    PCUT_ASSERT_NOT_NULL(instr_cache_find(&cache, 0x2000));
+    PCUT_ASSERT_NOT_NULL(instr_cache_find(&cache, 0x3000));
+}
+
+PCUT_TEST(referenced_page_survives)
+{
+    instr_cache_set_capacity(2);
+
+    add_page(0x1000);
+    add_page(0x2000);
+
+    /* Second chance for the older page */
+    instr_cache_find(&cache, 0x1000);
+    add_page(0x3000);
+
+    PCUT_ASSERT_NOT_NULL(instr_cache_find(&cache, 0x1000));
+    PCUT_ASSERT_NULL(instr_cache_find(&cache, 0x2000));
+    PCUT_ASSERT_NOT_NULL(instr_cache_find(&cache, 0x3000));
+}
+
+PCUT_TEST(shrink_capacity)
+{
+    for (ptr36_t i = 0; i < 10; i++) {
+        add_page(FRAME2ADDR(i));
+    }
+
+    PCUT_ASSERT_FALSE(instr_cache_set_capacity(0));
+    PCUT_ASSERT_TRUE(instr_cache_set_capacity(4));
+    add_page(FRAME2ADDR(10));
+
+    PCUT_ASSERT_INT_EQUALS(4, cache.count);
+    PCUT_ASSERT_NOT_NULL(instr_cache_find(&cache, FRAME2ADDR(10)));
+}
+
+PCUT_EXPORT(instr_cache);
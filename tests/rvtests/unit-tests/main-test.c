@@ -26,9 +26,10 @@ bool machine_nondet = false;
 
 // set to true for debugging
 bool machine_trace = false;
-bool machine_halt = false;
+_Atomic bool machine_halt = false;
 bool machine_break = false;
 bool machine_interactive = false;
+_Atomic bool machine_instrumented = true;
 bool machine_newline = false;
 bool machine_undefined = false;
 bool machine_specific_instructions = true;
@@ -42,5 +43,11 @@ PCUT_IMPORT(instruction_decoding);
 PCUT_IMPORT(instruction_exceptions);
 PCUT_IMPORT(tlb);
 PCUT_IMPORT(asid_len);
+PCUT_IMPORT(instr_cache);
+PCUT_IMPORT(device_bus);
+PCUT_IMPORT(event);
+PCUT_IMPORT(physmem_dma);
+PCUT_IMPORT(physmem_wire);
+PCUT_IMPORT(csr_hpm);
 
 PCUT_MAIN()
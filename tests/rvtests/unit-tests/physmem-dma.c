@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pcut/pcut.h>
+
+#include "../../../src/physmem.h"
+#include "../../../src/utils.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(physmem_dma);
+
+/* Two frames of RAM followed by a frame of ROM at 0x100000 */
+#define RAM_ADDR 0x100000
+#define ROM_ADDR (RAM_ADDR + 2 * FRAME_SIZE)
+
+static uint8_t ram_data[2 * FRAME_SIZE];
+static uint8_t rom_data[FRAME_SIZE];
+
+static physmem_area_t ram = {
+    .type = MEMT_MEM,
+    .writable = true,
+    .start = ADDR2FRAME(RAM_ADDR),
+    .count = 2,
+    .data = ram_data
+};
+
+static physmem_area_t rom = {
+    .type = MEMT_MEM,
+    .writable = false,
+    .start = ADDR2FRAME(ROM_ADDR),
+    .count = 1,
+    .data = rom_data
+};
+
+static uint8_t buffer[3 * FRAME_SIZE];
+
+PCUT_TEST_BEFORE
+{
+    static bool wired = false;
+
+    if (!wired) {
+        physmem_wire(&ram);
+        physmem_wire(&rom);
+        wired = true;
+    }
+
+    memset(ram_data, 0, sizeof(ram_data));
+    memset(rom_data, 0, sizeof(rom_data));
+
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t) i;
+    }
+}
+
+PCUT_TEST(write_across_frames)
+{
+    physmem_find_frame(RAM_ADDR)->valid = true;
+    physmem_find_frame(RAM_ADDR + FRAME_SIZE)->valid = true;
+
+    physmem_dma_write(RAM_ADDR + FRAME_SIZE - 8, buffer, 16);
+
+    PCUT_ASSERT_INT_EQUALS(0, memcmp(ram_data + FRAME_SIZE - 8, buffer, 16));
+    PCUT_ASSERT_INT_EQUALS(0, ram_data[FRAME_SIZE - 9]);
+    PCUT_ASSERT_INT_EQUALS(0, ram_data[FRAME_SIZE + 8]);
+    PCUT_ASSERT_FALSE(physmem_find_frame(RAM_ADDR)->valid);
+    PCUT_ASSERT_FALSE(physmem_find_frame(RAM_ADDR + FRAME_SIZE)->valid);
+}
+
+PCUT_TEST(write_keeps_byte_order)
+{
+    physmem_dma_write(RAM_ADDR, buffer, 4);
+
+    PCUT_ASSERT_INT_EQUALS(0x03020100, physmem_read32(0, RAM_ADDR, false));
+}
+
+PCUT_TEST(rom_is_not_written)
+{
+    physmem_dma_write(ROM_ADDR - 4, buffer, 8);
+
+    PCUT_ASSERT_INT_EQUALS(0, memcmp(ram_data + 2 * FRAME_SIZE - 4, buffer, 4));
+    PCUT_ASSERT_INT_EQUALS(0, rom_data[0]);
+}
+
+PCUT_TEST(read_across_frames)
+{
+    memcpy(ram_data, buffer, sizeof(ram_data));
+    memcpy(rom_data, buffer, sizeof(rom_data));
+
+    uint8_t data[2 * FRAME_SIZE];
+    physmem_dma_read(RAM_ADDR + FRAME_SIZE, data, sizeof(data));
+
+    PCUT_ASSERT_INT_EQUALS(0, memcmp(data, buffer + FRAME_SIZE, FRAME_SIZE));
+    PCUT_ASSERT_INT_EQUALS(0, memcmp(data + FRAME_SIZE, buffer, FRAME_SIZE));
+}
+
+PCUT_TEST(read_outside_memory)
+{
+    uint32_t data[2];
+    physmem_dma_read(ROM_ADDR + FRAME_SIZE, data, sizeof(data));
+
+    PCUT_ASSERT_INT_EQUALS(UINT32_MAX, data[0]);
+    PCUT_ASSERT_INT_EQUALS(UINT32_MAX, data[1]);
+}
+
+PCUT_EXPORT(physmem_dma);
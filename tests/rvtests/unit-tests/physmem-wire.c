@@ -0,0 +1,48 @@
+#include <stdint.h>
+#include <pcut/pcut.h>
+
+#include "../../../src/physmem.h"
+#include "../../../src/utils.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(physmem_wire);
+
+/* A single frame, alone in its frame table */
+#define AREA_ADDR 0x3000000
+
+static uint8_t area_data[FRAME_SIZE];
+
+static physmem_area_t area = {
+    .type = MEMT_MEM,
+    .writable = true,
+    .start = ADDR2FRAME(AREA_ADDR),
+    .count = 1,
+    .data = area_data
+};
+
+PCUT_TEST(unwire_removes_empty_frame_table)
+{
+    physmem_wire(&area);
+    PCUT_ASSERT_NOT_NULL(physmem_find_frame(AREA_ADDR));
+
+    physmem_unwire(&area);
+    PCUT_ASSERT_NULL(physmem_find_frame(AREA_ADDR));
+
+    /* No frame of the freed table is visited */
+    physmem_invalidate_all();
+}
+
+PCUT_TEST(wire_again_after_unwire)
+{
+    physmem_wire(&area);
+    physmem_unwire(&area);
+    physmem_wire(&area);
+
+    physmem_write32(0, AREA_ADDR, 0x12345678, false);
+    PCUT_ASSERT_INT_EQUALS(0x12345678, physmem_read32(0, AREA_ADDR, false));
+
+    physmem_unwire(&area);
+}
+
+PCUT_EXPORT(physmem_wire);
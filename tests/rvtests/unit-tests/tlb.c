@@ -393,4 +393,91 @@ PCUT_TEST(flush_by_asid_and_addr_ignores_global)
     PCUT_ASSERT_EQUALS(true, success);
 }
 
+PCUT_TEST(lru_entry_evicted)
+{
+    unsigned asid = 1;
+    sv32_pte_t added_pte = { 0 };
+
+    rv32_tlb_resize(&tlb, 2);
+
+    rv32_tlb_add_mapping(&tlb, asid, 0x1000, added_pte, false, false);
+    rv32_tlb_add_mapping(&tlb, asid, 0x2000, added_pte, false, false);
+
+    sv32_pte_t pte;
+    bool megapage;
+
+    // Make the first mapping the most recently used one
+    rv32_tlb_get_mapping(&tlb, asid, 0x1000, &pte, &megapage, true);
+
+    rv32_tlb_add_mapping(&tlb, asid, 0x3000, added_pte, false, false);
+
+    PCUT_ASSERT_EQUALS(true, rv32_tlb_get_mapping(&tlb, asid, 0x1000, &pte, &megapage, true));
+    PCUT_ASSERT_EQUALS(false, rv32_tlb_get_mapping(&tlb, asid, 0x2000, &pte, &megapage, true));
+    PCUT_ASSERT_EQUALS(true, rv32_tlb_get_mapping(&tlb, asid, 0x3000, &pte, &megapage, true));
+
+    PCUT_ASSERT_INT_EQUALS(3, tlb.hits);
+    PCUT_ASSERT_INT_EQUALS(1, tlb.misses);
+    PCUT_ASSERT_INT_EQUALS(1, tlb.evictions);
+}
+
+PCUT_TEST(most_recent_mapping_used)
+{
+    uint32_t virt = 0x00400000;
+    unsigned asid = 1;
+
+    sv32_pte_t megapage_pte = { 0 };
+    megapage_pte.ppn = 0x1000;
+    sv32_pte_t page_pte = { 0 };
+    page_pte.ppn = 0x2000;
+
+    rv32_tlb_add_mapping(&tlb, asid, virt, megapage_pte, true, false);
+    rv32_tlb_add_mapping(&tlb, asid, virt, page_pte, false, false);
+
+    sv32_pte_t pte;
+    bool megapage;
+
+    bool success = rv32_tlb_get_mapping(&tlb, asid, virt, &pte, &megapage, false);
+
+    PCUT_ASSERT_EQUALS(true, success);
+    PCUT_ASSERT_EQUALS(false, megapage);
+    PCUT_ASSERT_INT_EQUALS(0x2000, pte.ppn);
+
+    rv32_tlb_remove_mapping(&tlb, asid, virt);
+    success = rv32_tlb_get_mapping(&tlb, asid, virt, &pte, &megapage, false);
+
+    PCUT_ASSERT_EQUALS(true, success);
+    PCUT_ASSERT_EQUALS(true, megapage);
+    PCUT_ASSERT_INT_EQUALS(0x1000, pte.ppn);
+    PCUT_ASSERT_INT_EQUALS(0, tlb.hits);
+}
+
+PCUT_TEST(many_entries)
+{
+    unsigned asid = 1;
+    sv32_pte_t added_pte = { 0 };
+
+    rv32_tlb_resize(&tlb, 1024);
+
+    for (uint32_t i = 0; i < 1024; i++) {
+        added_pte.ppn = i;
+        rv32_tlb_add_mapping(&tlb, asid, i << 12, added_pte, false, false);
+    }
+
+    rv32_tlb_flush_by_addr(&tlb, 512 << 12);
+
+    sv32_pte_t pte;
+    bool megapage;
+
+    for (uint32_t i = 0; i < 1024; i++) {
+        bool success = rv32_tlb_get_mapping(&tlb, asid, i << 12, &pte, &megapage, true);
+
+        PCUT_ASSERT_EQUALS(i != 512, success);
+        if (success) {
+            PCUT_ASSERT_INT_EQUALS(i, pte.ppn);
+        }
+    }
+
+    PCUT_ASSERT_INT_EQUALS(0, tlb.evictions);
+}
+
 PCUT_EXPORT(tlb);
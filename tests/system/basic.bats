@@ -97,3 +97,47 @@ load "common"
     exit_success=false \
     msim_command_check
 }
+
+@test "Profile without samples" {
+    config="
+        add dr4kcpu mips
+        set profile
+        set profperiod = 100
+        profile flat
+        profile folded
+    " \
+    expected="
+        Profile of 0 samples, one every 100 cycles
+    " \
+    msim_command_check
+}
+
+@test "Profile symbols from a file which is not ELF" {
+    config="
+        profile symbols \"msim.conf\"
+    " \
+    expected="
+        <msim> Error in msim.conf on line 1:
+        Not an ELF file or corrupted symbol table (msim.conf)
+        <msim> Fault in msim.conf on line 1:
+        Error in configuration file
+    " \
+    exit_success=false \
+    msim_command_check
+}
+
+@test "Instruction statistics without executions" {
+    config="
+        add dr4kcpu mips
+        set istat
+        istat
+        istat csv
+        istat json
+    " \
+    expected="
+        Statistics of 0 executed instructions
+        arch,instruction,executed,exceptions,bytes
+        []
+    " \
+    msim_command_check
+}
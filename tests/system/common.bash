@@ -95,7 +95,13 @@ msim_run_code() {
         sed 's:.*:#  | &:' "$MSIM_TEST_TMPDIR/msim.conf"
     } >&2
 
-    run bash -c "cd '$MSIM_TEST_TMPDIR' && '$MSIM' "$@" </dev/null"
+    # Commands for the interactive mode are read from the input file
+    local input_file="/dev/null"
+    if [ -n "${input:-}" ]; then
+        input_file="$test_dir/$input"
+    fi
+
+    run bash -c "cd '$MSIM_TEST_TMPDIR' && '$MSIM' "$@" <'$input_file'"
     {
         echo
         echo "# MSIM output (stdout and stderr interleaved)"
@@ -106,7 +112,7 @@ msim_run_code() {
         fail "MSIM failed with exit code $status."
     fi
 
-    output="$( echo "$output" | sed 's#^\[msim\] $#[msim]#' )"
+    output="$( echo "$output" | sed -e 's#^\[msim\] $#[msim]#' -e "${host_filter:-}" )"
 
     if [ "$output" != "$expected_from_simulator" ]; then
         {
@@ -29,3 +29,27 @@ load "common"
 @test "MIPS32: Register dumps" {
     msim_run_code "mips32-rd"
 }
+
+@test "MIPS32: LL/SC on multiple processors" {
+    msim_run_code "mips32-llsc"
+}
+
+@test "MIPS32: Pre-decoded fields, delay slots and modified code" {
+    msim_run_code "mips32-predecode"
+}
+
+@test "MIPS32: Pre-decoded fields, delay slots and modified code with trace" {
+    expected=host-trace.expected msim_run_code "mips32-predecode" -t
+}
+
+@test "MIPS32: TLB lookup after replacement, ASID change and with ERL" {
+    msim_run_code "mips32-tlb"
+}
+
+@test "MIPS32: TLB lookup after replacement, ASID change and with ERL with trace" {
+    expected=host-trace.expected msim_run_code "mips32-tlb" -t
+}
+
+@test "MIPS32: Instruction statistics turned on and off" {
+    input=commands msim_run_code "mips32-istat" --allow-xint-without-tty
+}
@@ -9,3 +9,55 @@ load "common"
 @test "RISC-V32: Simple with trace" {
     expected=host-trace.expected msim_run_code "riscv32-simple" -t
 }
+
+@test "RISC-V32: Simple with binary trace" {
+    msim_run_code "riscv32-simple" --trace-file=trace.bin
+
+    local expected_trace="$( cat "$( dirname "$BATS_TEST_FILENAME" )/riscv32-simple/trace-decoded.expected" )"
+    run "$MSIM" -D "$MSIM_TEST_TMPDIR/trace.bin"
+
+    if [ "$status" -ne 0 ]; then
+        fail "MSIM failed to decode the trace with exit code $status."
+    fi
+
+    if [ "$output" != "$expected_trace" ]; then
+        {
+            echo "Failure: unexpected decoded trace."
+            echo "-- Expected --"
+            echo "$expected_trace"
+            echo "-- Actual --"
+            echo "$output"
+            echo "--"
+        } | fail
+    fi
+}
+
+@test "RISC-V32: Memory breakpoint is hit only by overlapping access" {
+    msim_run_code "riscv32-break"
+}
+
+@test "RISC-V32: dnomem device in halt mode" {
+    msim_run_code "riscv32-dnomem-halt"
+}
+
+@test "RISC-V32: dnomem device in break mode" {
+    msim_run_code "riscv32-dnomem-break"
+}
+
+@test "RISC-V32: Atomics on multiple harts" {
+    msim_run_code "riscv32-parallel"
+}
+
+@test "RISC-V32: Atomics on multiple harts in parallel" {
+    expected=host-parallel.expected host_filter='s#^Cycles: [0-9]*$#Cycles: N#' \
+        msim_run_code "riscv32-parallel" --parallel=16
+}
+
+@test "RISC-V32: Instruction statistics turned on and off" {
+    input=commands msim_run_code "riscv32-istat" --allow-xint-without-tty
+}
+
+@test "RISC-V32: Profile of every cycle with the callers" {
+    cp "$( dirname "$BATS_TEST_FILENAME" )/riscv32-profile/boot.raw" "$MSIM_TEST_TMPDIR/"
+    input=commands msim_run_code "riscv32-profile" --allow-xint-without-tty
+}